@@ -41,6 +41,7 @@
 #include <Urho3D/Graphics/Texture2D.h>
 #include <Urho3D/Scene/Scene.h>
 #include <Urho3D/Graphics/Camera.h>
+#include <Urho3D/Graphics/DebugRenderer.h>
 #include <Urho3D/Graphics/Geometry.h>
 #include <Urho3D/Graphics/Graphics.h>
 #include <Urho3D/Graphics/IndexBuffer.h>
@@ -75,16 +76,26 @@
 #include "imgui.h"
 
 #include "Application.h"
-#include "PodVehicle.h"
+#include "PodResource.h"
 #include "PodCircuit.h"
 #include "VehicleComponent.h"
 #include "CircuitComponent.h"
+#include "DebugCircuitComponent.h"
+#include "CompetitorAIComponent.h"
+#include "PodCircuitLoader.h"
 #include "LoadBindings.h"
+#include "PodBenchmark.h"
 
 #include <Urho3D/DebugNew.h>
 
 URHO3D_DEFINE_APPLICATION_MAIN(PodApplication);
 
+/// Time the main thread spends per frame creating the GPU resources of a loading circuit.
+static constexpr long long CIRCUIT_UPLOAD_BUDGET_USEC = 4000;
+
+/// Vehicle file of the player.
+static const char* PLAYER_VEHICLE = "Io/DATA/BINARY/VOITURES/GAMMA.BV4";
+
 PodApplication* GetApplication()
 {
     return g_app;
@@ -92,12 +103,19 @@ PodApplication* GetApplication()
 
 PodApplication::PodApplication(Context* context) :
     Application(context),
-    commandLineRead_(false)
+    commandLineRead_(false),
+    useCircuitCache_(true),
+    useSectorCulling_(true),
+    sectorChunkSize_(0.0f),
+    nativeRGB565Textures_(false)
 {
     g_app = this;
     // Register factory and attributes for the Vehicle component so it can be created via CreateComponent, and loaded / saved
     VehicleComponent::RegisterObject(context);
     CircuitComponent::RegisterObject(context);
+    CompetitorAIComponent::RegisterObject(context);
+    PodVehicleResource::RegisterObject(context);
+    PodCircuitResource::RegisterObject(context);
 }
 
 void PodApplication::Setup()
@@ -113,6 +131,34 @@ void PodApplication::Setup()
     engineParameters_[EP_WINDOW_HEIGHT] = 760;
     engineParameters_[EP_WINDOW_RESIZABLE] = true;
 
+    // Check for a micro-benchmark to run instead of the editor
+    const Vector<String>& arguments = GetArguments();
+    for (unsigned i = 0; i < arguments.Size(); ++i)
+    {
+        if (arguments[i] == "-benchmark" && i + 1 < arguments.Size())
+            benchmarkName_ = arguments[++i];
+        else if (arguments[i] == "-nocircuitcache")
+            useCircuitCache_ = false;
+        else if (arguments[i] == "-nosectorculling")
+            useSectorCulling_ = false;
+        else if (arguments[i] == "-rgb565")
+            nativeRGB565Textures_ = true;
+        else if (arguments[i] == "-batchsectors" && i + 1 < arguments.Size())
+            sectorChunkSize_ = ToFloat(arguments[++i]);
+        else if (arguments[i] == "-simulate" && i + 1 < arguments.Size())
+            simulation_.CircuitFile = arguments[++i];
+        else if (arguments[i] == "-vehicles" && i + 1 < arguments.Size())
+            simulation_.NumVehicles = ToUInt(arguments[++i]);
+        else if (arguments[i] == "-steps" && i + 1 < arguments.Size())
+            simulation_.NumSteps = ToUInt(arguments[++i]);
+        else if (arguments[i] == "-simoutput" && i + 1 < arguments.Size())
+            simulation_.OutputFile = arguments[++i];
+        else if (arguments[i] == "-simai")
+            simulation_.UseAI = true;
+    }
+    if (!benchmarkName_.Empty() || !simulation_.CircuitFile.Empty())
+        engineParameters_[EP_HEADLESS] = true;
+
     // Construct a search path to find the resource prefix with two entries:
     // The first entry is an empty path which will be substituted with program/bin directory -- this entry is for binary when it is still in build tree
     // The second and third entries are possible relative paths from the installed program/bin directory to the asset directory -- these entries are for binary when it is in the Urho3D SDK installation location
@@ -122,6 +168,23 @@ void PodApplication::Setup()
 
 void PodApplication::Start()
 {
+    if (!benchmarkName_.Empty())
+    {
+        if (!RunPodBenchmark(context_, benchmarkName_))
+            ErrorExit("Unknown benchmark: " + benchmarkName_);
+        engine_->Exit();
+        return;
+    }
+
+    if (!simulation_.CircuitFile.Empty())
+    {
+        simulation_.UseCache = useCircuitCache_;
+        if (!RunPodSimulation(context_, simulation_))
+            ErrorExit("Simulation failed for circuit " + simulation_.CircuitFile);
+        engine_->Exit();
+        return;
+    }
+
     imgui_ = new ImGuiIntegration(context_);
     SubscribeToEvent(E_IMGUI_NEWFRAME, URHO3D_HANDLER(PodApplication, HandleImGuiFrame));
 
@@ -150,14 +213,19 @@ void PodApplication::Start()
     debugHud_ = engine_->CreateDebugHud();
     debugHud_->SetDefaultStyle(style);
 
-    podv_ = new PodVehicle(context_, "Io/DATA/BINARY/VOITURES/GAMMA.BV4");
-    podv_->Load();
-    printf("%s\n", podv_->GetName().CString());
+    podv_ = cache->GetResource<PodVehicleResource>(PLAYER_VEHICLE);
+    if (!podv_)
+    {
+        ErrorExit(String("Could not load vehicle ") + PLAYER_VEHICLE);
+        return;
+    }
+    PodVehicle* podv = podv_->GetVehicle();
+    printf("%s\n", podv->GetName().CString());
 
-    auto model = podv_->GetChassisModel(VC_GOOD);
+    auto model = podv->GetChassisModel(VC_GOOD);
 
     auto* img = uiRoot_->CreateChild<Sprite>();
-    auto* tex = podv_->GetChassisMaterials(VC_GOOD)[0]->GetTexture(TU_DIFFUSE);
+    auto* tex = podv->GetChassisMaterials(VC_GOOD)[0]->GetTexture(TU_DIFFUSE);
     img->SetTexture(tex);
     img->SetSize(tex->GetWidth(), tex->GetHeight());
     //img->SetBlendMode(BLEND_ADD);
@@ -226,6 +294,7 @@ void PodApplication::CreateScene()
     // Create scene subsystem components
     scene_->CreateComponent<Octree>();
     scene_->CreateComponent<PhysicsWorld>();
+    scene_->CreateComponent<DebugRenderer>();
 
     // Create camera and define viewport. We will be doing load / save, so it's convenient to create the camera outside the scene,
     // so that it won't be destroyed and recreated, and we don't have to redefine the viewport on load
@@ -430,6 +499,7 @@ void PodApplication::HandleUpdate(StringHash eventType, VariantMap& eventData)
 
     float timeStep = eventData[P_TIMESTEP].GetFloat();
 
+    UpdateCircuitLoaders();
     MoveCamera(timeStep);
     camPosText_->SetText("Camera Pos: " + String(cameraNode_->GetPosition()));
 
@@ -486,10 +556,41 @@ void PodApplication::LoadCircuit(const String& fileName)
 {
     if (fileName.Empty()) return;
 
-    circ_ = new PodCircuit(context_, fileName);
-    if (!circ_->Load())
+    // A load still in progress is abandoned, the last requested circuit wins
+    SharedPtr<PodCircuitLoader> loader(new PodCircuitLoader(context_, fileName));
+    loader->SetUseCache(useCircuitCache_);
+    loader->SetNativeRGB565Textures(nativeRGB565Textures_);
+    loader->SetSectorChunkSize(sectorChunkSize_);
+    loader->Start();
+    circuitLoaders_.Push(loader);
+}
+
+void PodApplication::UpdateCircuitLoaders()
+{
+    // Abandoned loaders are released once their worker is done
+    for (unsigned i = 0; i + 1 < circuitLoaders_.Size();)
+    {
+        if (circuitLoaders_[i]->IsWorking())
+            ++i;
+        else
+            circuitLoaders_.Erase(i);
+    }
+
+    if (circuitLoaders_.Empty() || !circuitLoaders_.Back()->Update(CIRCUIT_UPLOAD_BUDGET_USEC))
         return;
 
+    SharedPtr<PodCircuitLoader> loader = circuitLoaders_.Back();
+    circuitLoaders_.Pop();
+    if (loader->IsLoaded())
+        SetCircuit(loader->DetachCircuit());
+}
+
+void PodApplication::SetCircuit(PodCircuit* circ)
+{
+    // The nodes of the old circuit point into its models and collision meshes, keep it until they are removed
+    UniquePtr<PodCircuit> oldCirc(circ_.Detach());
+    circ_ = circ;
+
     if (!circObject_)
     {
         auto circNode = scene_->CreateChild("Circuit");
@@ -501,7 +602,11 @@ void PodApplication::LoadCircuit(const String& fileName)
         auto circNode = scene_->GetChild("Circuit");
         circObject_ = circNode->GetComponent<CircuitComponent>();
     }
+    circObject_->SetSectorBatching(sectorChunkSize_);
     circObject_->SetPodCircuit(circ_.Get());
+    circObject_->SetVisibilityViewer(useSectorCulling_ ? cameraNode_.Get() : nullptr);
+    if (vehicle_)
+        circObject_->AddCollisionActivator(vehicle_->GetNode());
 }
 
 static void ImGuiSliderRotation(const Matrix3& mat)
@@ -748,7 +853,6 @@ static void ImGuiDifficulty(PodCircuit::Difficulty& d)
     if (ImGui::Button("Set Current To Visualize"))
     {
         debug_enabledDifficulty = d.Path.Name;
-        debug_reloadObjects = true;
     }
     ImGui::Text("Name: %s", d.Name.CString());
     ImGui::Text("PathName: %s", d.Path.Name.CString());
@@ -776,7 +880,6 @@ static void ImGuiDifficulty(PodCircuit::Difficulty& d)
                 enabledPointLists[pi] = 0;
             else
                 enabledPointLists[pi] = 1;
-            debug_reloadObjects = true;
         }
 
         if (ImGui::TreeNode("Points"))
@@ -821,7 +924,6 @@ static void ImGuiDifficulty(PodCircuit::Difficulty& d)
     if (ImGui::Button(alltext.CString()))
     {
         debug_enabledAllPositions[d.Path.Name] = !debug_enabledAllPositions[d.Path.Name];
-        debug_reloadObjects = true;
         for (int& enabled : enabledPointLists)
         {
             if (debug_enabledAllPositions[d.Path.Name]) enabled = 0;
@@ -968,7 +1070,10 @@ void PodApplication::HandleImGuiFrame(StringHash eventType, VariantMap& eventDat
         debug_reloadObjects = true;
 
     if (debug_reloadObjects)
+    {
+        circObject_->SetSectorBatching(sectorChunkSize_);
         circObject_->SetPodCircuit(circ_.Get());
+    }
 
     debug_reloadObjects = false;
 
@@ -976,6 +1081,37 @@ void PodApplication::HandleImGuiFrame(StringHash eventType, VariantMap& eventDat
     if (ImGui::Button("Reload"))
         LoadCircuit(circ_->GetFileName());
 
+    auto* debugCircuit = circObject_->GetComponent<DebugCircuitComponent>();
+    if (debugCircuit && ImGui::CollapsingHeader("Debug Overlay"))
+    {
+        unsigned categories = debugCircuit->GetCategories();
+        ImGui::CheckboxFlags("Decorations", &categories, DCC_DECORATIONS);
+        ImGui::CheckboxFlags("Lights", &categories, DCC_LIGHTS);
+        ImGui::CheckboxFlags("Sounds", &categories, DCC_SOUNDS);
+        ImGui::CheckboxFlags("Repair Zones", &categories, DCC_REPAIRZONES);
+        ImGui::CheckboxFlags("Starts", &categories, DCC_STARTS);
+        ImGui::CheckboxFlags("Designations", &categories, DCC_DESIGNATIONS);
+        ImGui::CheckboxFlags("Difficulty", &categories, DCC_DIFFICULTY);
+        ImGui::CheckboxFlags("Labels", &categories, DCC_LABELS);
+        if (categories != debugCircuit->GetCategories())
+            debugCircuit->SetCategories(categories);
+    }
+
+    if (vehicle_ && ImGui::CollapsingHeader("Vehicle Damage"))
+    {
+        static const char* regionNames[MAX_VEHICLE_REGIONS] = {
+            "Front Right", "Side Right", "Rear Right", "Front Left", "Side Left", "Rear Left"
+        };
+        static const char* conditionNames[MAX_VEHICLE_CONDITIONS] = { "Good", "Damaged", "Ruined" };
+        for (int i = 0; i < MAX_VEHICLE_REGIONS; i++)
+        {
+            auto region = (PodVehicleRegion)i;
+            int condition = vehicle_->GetCondition(region);
+            if (ImGui::Combo(regionNames[i], &condition, conditionNames, MAX_VEHICLE_CONDITIONS))
+                vehicle_->SetCondition(region, (PodVehicleCondition)condition);
+        }
+    }
+
     ImGui::Spacing(); ImGui::Separator(); ImGui::Spacing();
     ImGui::Text("Name: %s", circ_->trackName_.CString());
     ImGui::Text("ProjectName: %s", circ_->projectName_.CString());
@@ -1240,6 +1376,9 @@ void PodApplication::HandleImGuiFrame(StringHash eventType, VariantMap& eventDat
 
 void PodApplication::Stop()
 {
+    // Cancel the circuit loads in progress while the work queue still runs them
+    circuitLoaders_.Clear();
+
     auto* luaScript = GetSubsystem<LuaScript>();
     if (luaScript && luaScript->GetFunction("Stop", true))
         luaScript->ExecuteFunction("Stop");
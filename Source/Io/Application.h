@@ -26,9 +26,11 @@
 
 #include <Urho3D/Engine/Application.h>
 #include "ImGuiIntegration.h"
+#include "PodSimulation.h"
 
-class PodVehicle;
+class PodVehicleResource;
 class PodCircuit;
+class PodCircuitLoader;
 class VehicleComponent;
 class CircuitComponent;
 class PodApplication;
@@ -83,12 +85,31 @@ public:
 
     void HandleImGuiFrame(StringHash eventType, VariantMap& eventData);
 
+    /// Start loading a circuit in the background. It replaces the current circuit once loaded.
     void LoadCircuit(const String& fileName);
 
+    /// Advance the circuit loads, called every frame.
+    void UpdateCircuitLoaders();
+
+    /// Replace the current circuit and create its scene content.
+    void SetCircuit(PodCircuit* circ);
+
     /// Script file name.
     String scriptFileName_;
     /// Flag whether CommandLine.txt was already successfully read.
     bool commandLineRead_;
+    /// Micro-benchmark to run instead of the editor, from the -benchmark command line option.
+    String benchmarkName_;
+    /// Headless race simulation to run instead of the editor, from the -simulate <circuit> option.
+    PodSimulationSettings simulation_;
+    /// Whether circuits are loaded through their baked cache, disabled with the -nocircuitcache option.
+    bool useCircuitCache_;
+    /// Whether circuit sectors are culled with their precomputed visibility, disabled with -nosectorculling.
+    bool useSectorCulling_;
+    /// Chunk size of the merged sector geometry, from the -batchsectors <size> option. Zero draws each sector.
+    float sectorChunkSize_;
+    /// Whether circuit textures are uploaded as RGB565 instead of RGBA, enabled with the -rgb565 option.
+    bool nativeRGB565Textures_;
 
     SharedPtr<UIElement> uiRoot_;
 
@@ -102,10 +123,14 @@ public:
 
     SharedPtr<DebugHud> debugHud_;
 
-    PodVehicle* podv_;
+    /// Vehicle of the player, shared through the resource cache.
+    SharedPtr<PodVehicleResource> podv_;
 
     UniquePtr<PodCircuit> circ_;
 
+    /// Circuit loads in progress, the last one is the requested circuit.
+    Vector<SharedPtr<PodCircuitLoader>> circuitLoaders_;
+
     SharedPtr<CircuitComponent> circObject_;
 
     SharedPtr<Text> camPosText_;
@@ -24,16 +24,21 @@
 #include <Urho3D/Graphics/Material.h>
 #include <Urho3D/Graphics/Model.h>
 #include <Urho3D/Graphics/StaticModel.h>
+#include <Urho3D/Graphics/StaticModelGroup.h>
 #include <Urho3D/Resource/ResourceCache.h>
 #include <Urho3D/Scene/Scene.h>
-#include <Urho3D/Scene/ValueAnimation.h>
 #include <Urho3D/Physics/CollisionShape.h>
+#include <Urho3D/Physics/PhysicsUtils.h>
 #include <Urho3D/Physics/RigidBody.h>
+#include <Bullet/BulletCollision/CollisionShapes/btScaledBvhTriangleMeshShape.h>
 
 #include "PodVehicle.h"
 #include "CircuitComponent.h"
 #include "DebugCircuitComponent.h"
 
+/// Distance around the sector bounds within which an activator enables the sector collision. Covers the distance a
+/// fast vehicle travels before the next update.
+static constexpr float COLLISION_ACTIVATION_MARGIN = 20.0f;
 
 class SectorComponent : public LogicComponent
 {
@@ -50,88 +55,50 @@ public:
         context->RegisterFactory<SectorComponent>();
     }
 
-    void SetInfo(PodCircuit* c, int sectorIndex)
+    /// Set the model generator of the sector, or of the chunk of merged sectors, drawn by this node.
+    void SetInfo(PodModelGen* modelGen)
     {
-        circ_ = c;
-        sectorIndex_ = sectorIndex;
+        modelGen_ = modelGen;
     }
 
     void PostUpdate(float dt) override
     {
-        auto& modelGen = circ_->GetSectorModelGen(sectorIndex_);
-        modelGen.UpdateTexCoords();
+        modelGen_->UpdateTexCoords();
     }
 
 private:
-    int sectorIndex_;
-    PodCircuit* circ_;
+    PodModelGen* modelGen_;
 };
 
-class FaceAnimComponent : public LogicComponent
+SectorCollisionShape::SectorCollisionShape(Context* context) :
+    CollisionShape(context),
+    collision_(nullptr),
+    sectorCollision_(nullptr)
 {
-    URHO3D_OBJECT(FaceAnimComponent, LogicComponent)
-
-public:
-    /// Construct.
-    explicit FaceAnimComponent(Context* context)
-        : LogicComponent(context) {}
-
-    /// Register object factory and attributes.
-    static void RegisterObject(Context* context)
-    {
-        context->RegisterFactory<FaceAnimComponent>();
-
-        URHO3D_ATTRIBUTE("TexIndex", int, texIndex_, 0.0f, AM_DEFAULT);
-        URHO3D_ATTRIBUTE("TexCoord", Matrix4, texCoord_, Matrix4(), AM_DEFAULT);
-        URHO3D_ATTRIBUTE("FlagUpdate", bool, flagUpdate_, false, AM_DEFAULT);
-    }
+}
 
-    void SetInfo(PodCircuit* c, int sectorIndex, int faceIndex, int faceType)
-    {
-        circ_ = c;
-        sectorIndex_ = sectorIndex;
-        faceIndex_ = faceIndex;
-        faceType_ = faceType;
-        prevFlagUpdate_ = flagUpdate_;
-    }
+void SectorCollisionShape::RegisterObject(Context* context)
+{
+    context->RegisterFactory<SectorCollisionShape>();
+}
 
-    void Update(float dt) override
-    {
-        if (flagUpdate_ != prevFlagUpdate_)
-        {
-            auto& sector = circ_->GetSector(sectorIndex_);
-            FaceData* face;
-            if (faceType_ == 3)
-                face = sector.Object.TriFaces[faceIndex_];
-            else
-                face = sector.Object.QuadFaces[faceIndex_];
-
-            face->UseAnimTexCoord = true;
-            face->AnimTexCoord[0] = Vector2(texCoord_.m00_, texCoord_.m01_);
-            face->AnimTexCoord[1] = Vector2(texCoord_.m10_, texCoord_.m11_);
-            face->AnimTexCoord[2] = Vector2(texCoord_.m20_, texCoord_.m21_);
-            face->AnimTexCoord[3] = Vector2(texCoord_.m30_, texCoord_.m31_);
-
-            auto& modelGen = circ_->GetSectorModelGen(sectorIndex_);
-            modelGen.InvalidateTexCoords();
-        }
-        prevFlagUpdate_ = flagUpdate_;
-    }
+void SectorCollisionShape::SetSectorCollision(PodCircuitCollision* collision, int sectorIdx)
+{
+    collision_ = collision;
+    sectorCollision_ = &collision->GetSector(sectorIdx);
+    SetShapeType((ShapeType)SHAPE_PODSECTOR);
+}
 
-private:
-    Matrix4 texCoord_;
-    int texIndex_;
-    int sectorIndex_;
-    int faceIndex_;
-    int faceType_;
-    PodCircuit* circ_;
-    float time_ = 0;
-    bool flagUpdate_ = false;
-    bool prevFlagUpdate_ = false;
-};
+btCollisionShape* SectorCollisionShape::UpdateDerivedShape(int shapeType, const Vector3& newWorldScale)
+{
+    if (shapeType != SHAPE_PODSECTOR || !sectorCollision_ || !sectorCollision_->GetShape())
+        return nullptr;
 
+    // The BVH is shared, the scaled shape only references it
+    return new btScaledBvhTriangleMeshShape(sectorCollision_->GetShape(), ToBtVector3(newWorldScale));
+}
 
-static void CreateLight(const SharedPtr<Node>& parent, const PodCircuit::Light& data)
+static Light* CreateLight(const SharedPtr<Node>& parent, const PodCircuit::Light& data)
 {
     auto node = parent->CreateChild();
     node->SetPosition(data.Position);
@@ -154,10 +121,12 @@ static void CreateLight(const SharedPtr<Node>& parent, const PodCircuit::Light&
     }
     
     light->SetColor(Color::RED); // TODO: color param?
+    return light;
 }
 
 CircuitComponent::CircuitComponent(Context* context) :
-    LogicComponent(context)
+    LogicComponent(context),
+    circ_(nullptr)
 {
     // Only the physics update event is needed: unsubscribe from the rest for optimization
     // SetUpdateEventMask(USE_FIXEDUPDATE);
@@ -168,7 +137,156 @@ void CircuitComponent::RegisterObject(Context* context)
     context->RegisterFactory<CircuitComponent>();
     DebugCircuitComponent::RegisterObject(context);
     SectorComponent::RegisterObject(context);
-    FaceAnimComponent::RegisterObject(context);
+    SectorCollisionShape::RegisterObject(context);
+}
+
+void CircuitComponent::Update(float timeStep)
+{
+    textureAnimator_.Update(timeStep);
+    UpdateVisibility();
+    UpdateCollision();
+}
+
+void CircuitComponent::SetVisibilityViewer(Node* viewer)
+{
+    visibilityViewer_ = viewer;
+    if (!viewer)
+        SetVisibleSectors(-1);
+}
+
+void CircuitComponent::UpdateVisibility()
+{
+    if (!visibilityViewer_ || !circ_)
+        return;
+
+    Vector3 position = GetNode()->WorldToLocal(visibilityViewer_->GetWorldPosition());
+    int sector = circ_->FindSector(position, viewerSector_);
+    if (sector != viewerSector_)
+        SetVisibleSectors(sector);
+}
+
+void CircuitComponent::SetVisibleSectors(int viewerSector)
+{
+    viewerSector_ = viewerSector;
+
+    // Outside of all sectors, or without visibility data, everything stays visible
+    const PodCircuit::Visibility* visibility = circ_ ? circ_->GetSectorVisibility(viewerSector) : nullptr;
+    PODVector<bool> visible(cullDrawables_.Size());
+    for (unsigned i = 0; i < visible.Size(); i++)
+        visible[i] = !visibility;
+
+    if (visibility)
+    {
+        // A drawable shared by several sectors is visible when any of them is
+        for (unsigned index : sectorDrawables_[viewerSector])
+            visible[index] = true;
+        for (int i = 0; i < visibility->Count; i++)
+        {
+            int sector = visibility->VisibleSectorIndices.Get()[i];
+            if (sector < 0 || sector >= (int)sectorDrawables_.Size())
+                continue;
+            for (unsigned index : sectorDrawables_[sector])
+                visible[index] = true;
+        }
+    }
+
+    for (unsigned i = 0; i < cullDrawables_.Size(); i++)
+        cullDrawables_[i]->SetEnabled(visible[i]);
+}
+
+void CircuitComponent::AddSectorDrawable(Drawable* drawable, const PODVector<unsigned>& sectors)
+{
+    for (unsigned sector : sectors)
+        sectorDrawables_[sector].Push(cullDrawables_.Size());
+    cullDrawables_.Push(drawable);
+}
+
+void CircuitComponent::AddCollisionActivator(Node* activator)
+{
+    WeakPtr<Node> node(activator);
+    if (!collisionActivators_.Contains(node))
+        collisionActivators_.Push(node);
+}
+
+void CircuitComponent::CreateCollision()
+{
+    collisionNodes_.Clear();
+    collisionBounds_.Clear();
+
+    PodCircuitCollision& collision = circ_->GetCollision();
+    for (unsigned i = 0; i < collision.GetNumSectors(); i++)
+    {
+        PodSectorCollision& sectorCollision = collision.GetSector(i);
+        BoundingBox bounds = circ_->GetSectorBounds(i);
+        if (sectorCollision.GetNumTriangles())
+            bounds.Merge(sectorCollision.GetBounds());
+        bounds.min_ -= Vector3::ONE * COLLISION_ACTIVATION_MARGIN;
+        bounds.max_ += Vector3::ONE * COLLISION_ACTIVATION_MARGIN;
+        collisionBounds_.Push(bounds);
+
+        if (!sectorCollision.GetShape())
+        {
+            collisionNodes_.Push(nullptr);
+            continue;
+        }
+
+        // Created disabled, the bodies are only in the physics world while activated
+        auto node = circObjectsGroup_->CreateChild("SectorCollision");
+        node->SetTemporary(true);
+        node->SetEnabled(false);
+        node->CreateComponent<RigidBody>()->SetCollisionLayer(2);
+        node->CreateComponent<SectorCollisionShape>()->SetSectorCollision(&collision, i);
+        collisionNodes_.Push(node);
+    }
+}
+
+void CircuitComponent::UpdateCollision()
+{
+    if (collisionNodes_.Empty())
+        return;
+
+    PODVector<Vector3> positions;
+    for (unsigned i = 0; i < collisionActivators_.Size();)
+    {
+        if (!collisionActivators_[i])
+        {
+            collisionActivators_.Erase(i);
+            continue;
+        }
+        positions.Push(GetNode()->WorldToLocal(collisionActivators_[i]->GetWorldPosition()));
+        ++i;
+    }
+
+    for (unsigned i = 0; i < collisionNodes_.Size(); i++)
+    {
+        Node* node = collisionNodes_[i];
+        if (!node)
+            continue;
+
+        bool active = false;
+        for (const Vector3& position : positions)
+        {
+            if (collisionBounds_[i].IsInside(position) != OUTSIDE)
+            {
+                active = true;
+                break;
+            }
+        }
+        if (node->IsEnabled() != active)
+            node->SetEnabled(active);
+    }
+}
+
+void CircuitComponent::SetSectorBatching(float chunkSize)
+{
+    chunkSize_ = chunkSize;
+}
+
+static void SetModelMaterials(StaticModel* modelObj, const Vector<SharedPtr<Material>>& materials)
+{
+    int i = 0;
+    for (const auto& mat : materials)
+        modelObj->SetMaterial(i++, mat);
 }
 
 void CircuitComponent::SetPodCircuit(PodCircuit* circ)
@@ -180,40 +298,88 @@ void CircuitComponent::SetPodCircuit(PodCircuit* circ)
 
     circObjectsGroup_->RemoveAllChildren();
     sectors_.Clear();
+    cullDrawables_.Clear();
+    sectorDrawables_.Clear();
+    sectorDrawables_.Resize(circ->GetSectors().Size());
+    viewerSector_ = -1;
 
-    for (unsigned int i = 0; i < circ->GetSectors().Size(); i++)
+    bool batched = chunkSize_ > 0.0f;
+    if (batched)
     {
-        auto node = circObjectsGroup_->CreateChild();
-        node->SetPosition(Vector3(0.0f, 0.0f, 0.0f));
+        // The chunks may already be built and generated by the circuit loader
+        if (!circ->GetNumSectorChunks())
+            circ->BuildSectorChunks(chunkSize_);
+        for (unsigned i = 0; i < circ->GetNumSectorChunks(); i++)
+        {
+            auto node = circObjectsGroup_->CreateChild();
 
-        auto modelObj = node->CreateComponent<StaticModel>();
-        modelObj->SetModel(circ->GetSectorModel(i));
-        //modelObj->SetCastShadows(true);
+            auto modelObj = node->CreateComponent<StaticModel>();
+            modelObj->SetModel(circ->GetChunkModel(i));
+            SetModelMaterials(modelObj, circ->GetChunkMaterials(i));
+            AddSectorDrawable(modelObj, circ->GetChunkSectors(i));
 
-        int mi = 0;
-        for (const auto& mat : circ->GetSectorMaterials(i))
-            modelObj->SetMaterial(mi++, mat);
+            auto sector = node->CreateComponent<SectorComponent>();
+            sector->SetInfo(&circ->GetChunkModelGen(i));
+            sectors_.Push(sector);
+        }
+    }
+
+    for (unsigned int i = 0; i < circ->GetSectors().Size(); i++)
+    {
+        PODVector<unsigned> sectorList(1, i);
 
-        // Create collision
-        //node->CreateComponent<RigidBody>()->SetCollisionLayer(2);
-        //auto colObj = node->CreateComponent<CollisionShape>();
-        //colObj->SetTriangleMesh(circ->GetSectorModel(i));
+        if (!batched)
+        {
+            auto node = circObjectsGroup_->CreateChild();
+            node->SetPosition(Vector3(0.0f, 0.0f, 0.0f));
+
+            auto modelObj = node->CreateComponent<StaticModel>();
+            modelObj->SetModel(circ->GetSectorModel(i));
+            //modelObj->SetCastShadows(true);
+            SetModelMaterials(modelObj, circ->GetSectorMaterials(i));
+            AddSectorDrawable(modelObj, sectorList);
+
+            auto sector = node->CreateComponent<SectorComponent>();
+            sector->SetInfo(&circ->GetSectorModelGen(i));
+            sectors_.Push(sector);
+        }
 
         // Create sector lights
         auto lights = circ->GetSectorLights(i);
         if (lights)
         {
             for (const auto& light : *lights)
-                CreateLight(circObjectsGroup_, light);
+                AddSectorDrawable(CreateLight(circObjectsGroup_, light), sectorList);
         }
-
-        auto sector = node->CreateComponent<SectorComponent>();
-        sector->SetInfo(circ_, i);
-        sectors_.Push(sector);
     }
 
+    // Batched decorations are grouped by decoration and chunk, and drawn instanced
+    HashMap<IntVector2, StaticModelGroup*> decorationGroups;
     for (const auto& dec : circ->GetDecorationInstances())
     {
+        // Decorations outside of all sectors are never culled by sector visibility
+        int sector = circ->FindSector(dec.Position);
+
+        if (batched)
+        {
+            int chunk = sector >= 0 ? circ->GetSectorChunk(sector) : -1;
+            StaticModelGroup*& group = decorationGroups[IntVector2(dec.Index, chunk)];
+            if (!group)
+            {
+                group = circObjectsGroup_->CreateChild()->CreateComponent<StaticModelGroup>();
+                group->SetModel(circ->GetDecorationModel(dec.Index));
+                SetModelMaterials(group, circ->GetDecorationMaterials(dec.Index));
+                if (chunk >= 0)
+                    AddSectorDrawable(group, circ->GetChunkSectors(chunk));
+            }
+
+            auto node = group->GetNode()->CreateChild();
+            node->SetPosition(dec.Position);
+            node->Rotate(Quaternion(dec.Rotation));
+            group->AddInstanceNode(node);
+            continue;
+        }
+
         auto node = circObjectsGroup_->CreateChild();
         node->SetPosition(dec.Position);
         node->Rotate(Quaternion(dec.Rotation));
@@ -222,58 +388,20 @@ void CircuitComponent::SetPodCircuit(PodCircuit* circ)
         auto modelObj = node->CreateComponent<StaticModel>();
         modelObj->SetModel(circ->GetDecorationModel(dec.Index));
         //modelObj->SetCastShadows(true);
-        
-        int i = 0;
-        for (const auto& mat : circ->GetDecorationMaterials(dec.Index))
-            modelObj->SetMaterial(i++, mat);
+        SetModelMaterials(modelObj, circ->GetDecorationMaterials(dec.Index));
+
+        if (sector >= 0)
+            AddSectorDrawable(modelObj, PODVector<unsigned>(1, sector));
     }
 
     for (const auto& light : circ->GetGlobalLights())
         CreateLight(circObjectsGroup_, light);
 
-    for (const auto& anim : circ->GetTextureAnimations())
-    {
-        for (const auto& obj : anim.SectorAnimations)
-        {
-            auto& texAnim = anim.Animations[obj.AnimIndex];
-            for (const auto& sec : obj.Sectors)
-            {
-                SharedPtr<ValueAnimation> texIndexAnim(new ValueAnimation(context_));
-                SharedPtr<ValueAnimation> texCoordAnim(new ValueAnimation(context_));
-                SharedPtr<ValueAnimation> flagAnim(new ValueAnimation(context_));
-
-                bool flagValue = true;
-                for (const auto& frame : texAnim.Frames)
-                {
-                    auto& key = texAnim.Keys[frame.KeyIndex];
-                    texIndexAnim->SetKeyFrame(frame.Time, key.TextureIndex);
-
-                    Matrix4 mat(
-                        key.TexCoord[0].x_, key.TexCoord[0].y_, 0, 0,
-                        key.TexCoord[1].x_, key.TexCoord[1].y_, 0, 0,
-                        key.TexCoord[2].x_, key.TexCoord[2].y_, 0, 0,
-                        key.TexCoord[3].x_, key.TexCoord[3].y_, 0, 0
-                    );
-                    texCoordAnim->SetKeyFrame(frame.Time, mat);
-                    flagAnim->SetKeyFrame(frame.Time, flagValue);
-                    flagValue = !flagValue;
-                }
-
-                auto sector = sectors_[sec.SectorIndex];
-                for (const auto& face : sec.Faces)
-                {
-                    // TODO: looping
-                    auto faceNode = sector->GetNode()->CreateChild();
-                    auto faceAnim = faceNode->CreateComponent<FaceAnimComponent>();
-                    faceAnim->SetInfo(circ_, sec.SectorIndex, face.FaceIndex, face.FaceType);
-                    faceAnim->SetAttributeAnimation("TexIndex", texIndexAnim);
-                    faceAnim->SetAttributeAnimation("TexCoord", texCoordAnim);
-                    faceAnim->SetAttributeAnimation("FlagUpdate", flagAnim);
-                }
-            }
-        }
-    }
+    CreateCollision();
+    UpdateCollision();
+
+    textureAnimator_.SetPodCircuit(circ);
 
     auto debug = GetNode()->GetOrCreateComponent<DebugCircuitComponent>();
     debug->SetPodCircuit(circ);
-}
\ No newline at end of file
+}
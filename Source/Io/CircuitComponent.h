@@ -22,13 +22,16 @@
 
 #pragma once
 
+#include <Urho3D/Physics/CollisionShape.h>
 #include <Urho3D/Scene/LogicComponent.h>
 #include "PodCircuit.h"
+#include "PodTextureAnimator.h"
 
 namespace Urho3D
 {
 
 class Constraint;
+class Drawable;
 class Node;
 class RigidBody;
 
@@ -38,6 +41,39 @@ using namespace Urho3D;
 
 class SectorComponent;
 
+/// Shape type of SectorCollisionShape, after the built-in shape types.
+static constexpr int SHAPE_PODSECTOR = SHAPE_GIMPACTMESH + 1;
+
+/// Collision shape of a circuit sector, sharing the prebuilt compressed BVH of the circuit collision.
+class SectorCollisionShape : public CollisionShape
+{
+    URHO3D_OBJECT(SectorCollisionShape, CollisionShape)
+
+public:
+    /// Construct.
+    explicit SectorCollisionShape(Context* context);
+
+    /// Register object factory.
+    static void RegisterObject(Context* context);
+
+    /// Set the collision mesh of a sector. Set once, after the shape is created.
+    void SetSectorCollision(PodCircuitCollision* collision, int sectorIdx);
+
+    /// Return the surface of a triangle, from the Bullet triangle index of a contact or raycast.
+    const PodCollisionMaterial& GetTriangleMaterial(unsigned triangleIndex) const
+    {
+        return collision_->GetMaterial(sectorCollision_->GetTriangleMaterialID(triangleIndex));
+    }
+
+protected:
+    /// Create the Bullet shape over the sector BVH.
+    btCollisionShape* UpdateDerivedShape(int shapeType, const Vector3& newWorldScale) override;
+
+private:
+    PodCircuitCollision* collision_;
+    PodSectorCollision* sectorCollision_;
+};
+
 /// Circuit component, responsible for managing physics and rendering components for a circuit.
 class CircuitComponent : public LogicComponent
 {
@@ -54,11 +90,40 @@ public:
     /// void ApplyAttributes() override;
     /// Handle physics world update. Called by LogicComponent base class.
     /// void FixedUpdate(float timeStep) override;
+    /// Handle scene update. Called by LogicComponent base class. Plays the texture animations, updates the sector
+    /// visibility and the active sector collision.
+    void Update(float timeStep) override;
 
     /// Create rendering and physics components. Called by the application.
     void SetPodCircuit(PodCircuit* circ);
 
+    /// Merge the sector geometry into chunks of neighbouring sectors and draw the decorations instanced, when the
+    /// chunk size is positive. Applies to the next SetPodCircuit.
+    void SetSectorBatching(float chunkSize);
+
+    /// Set the node (camera or vehicle) used for sector visibility culling. Only the drawables of the sectors
+    /// visible from the sector containing the viewer are enabled. Null disables the culling.
+    void SetVisibilityViewer(Node* viewer);
+
+    /// Add a node (vehicle) activating the collision of the sectors around it. Only the sectors near an activator
+    /// are added to the physics world.
+    void AddCollisionActivator(Node* activator);
+
 private:
+    /// Find the sector containing the viewer and update the visible sectors when it changed.
+    void UpdateVisibility();
+
+    /// Enable the drawables of the sectors visible from a sector, or all of them when the sector is -1.
+    void SetVisibleSectors(int viewerSector);
+
+    /// Register a drawable culled with the visibility of the given sectors.
+    void AddSectorDrawable(Drawable* drawable, const PODVector<unsigned>& sectors);
+
+    /// Create the sector collision nodes, disabled until activated.
+    void CreateCollision();
+
+    /// Enable the collision of the sectors near the activators and disable the others.
+    void UpdateCollision();
 
     PodCircuit* circ_;
 
@@ -67,4 +132,27 @@ private:
     SharedPtr<Node> circObjectsGroup_;
 
     PODVector<SectorComponent*> sectors_;
+
+    /// Sector or chunk models, sector lights and decorations culled by sector visibility.
+    PODVector<Drawable*> cullDrawables_;
+
+    /// Indices into cullDrawables_, by sector.
+    Vector<PODVector<unsigned>> sectorDrawables_;
+
+    /// Sector chunk size, zero when the sectors are not batched.
+    float chunkSize_ = 0.0f;
+
+    WeakPtr<Node> visibilityViewer_;
+
+    int viewerSector_ = -1;
+
+    Vector<WeakPtr<Node>> collisionActivators_;
+
+    /// Sector collision nodes, null for the sectors without collision triangles.
+    PODVector<Node*> collisionNodes_;
+
+    /// Sector bounds grown by the activation margin, by sector.
+    PODVector<BoundingBox> collisionBounds_;
+
+    PodTextureAnimator textureAnimator_;
 };
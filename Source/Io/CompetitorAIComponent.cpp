@@ -0,0 +1,220 @@
+//
+// Copyright (c) 2008-2019 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include <Urho3D/Core/Context.h>
+#include <Urho3D/Core/Profiler.h>
+#include <Urho3D/Core/WorkQueue.h>
+#include <Urho3D/Physics/PhysicsEvents.h>
+#include <Urho3D/Physics/PhysicsWorld.h>
+#include <Urho3D/Physics/RigidBody.h>
+#include <Urho3D/Scene/Scene.h>
+
+#include "CompetitorAIComponent.h"
+#include "VehicleComponent.h"
+
+/// Smallest number of competitors split over the worker threads.
+static constexpr unsigned MIN_THREADED_COMPETITORS = 32;
+
+/// Number of competitors updated by each parallel chunk.
+static constexpr unsigned COMPETITORS_PER_CHUNK = 16;
+
+/// Distance of the steering target ahead of the vehicle on the path, and the time at the vehicle speed added to it.
+static constexpr float STEER_LOOKAHEAD_DISTANCE = 8.0f;
+static constexpr float STEER_LOOKAHEAD_TIME = 0.5f;
+
+/// Distance of the path direction ahead compared to the current one to slow down before corners, and the time at the
+/// vehicle speed added to it.
+static constexpr float CORNER_LOOKAHEAD_DISTANCE = 15.0f;
+static constexpr float CORNER_LOOKAHEAD_TIME = 1.5f;
+
+/// Angle to the steering target under which the vehicle drives straight, in degrees.
+static constexpr float STEER_DEAD_ZONE = 3.0f;
+
+/// Fraction of the maximum speed kept in a right angle corner.
+static constexpr float CORNER_SPEED_FACTOR = 0.5f;
+
+/// Speed above the target speed, relative to it, from which the vehicle brakes.
+static constexpr float BRAKE_SPEED_RATIO = 1.2f;
+
+/// Speed under which an accelerating vehicle is stuck, the time after which it reverses and for how long.
+static constexpr float STUCK_SPEED = 1.0f;
+static constexpr float STUCK_TIME = 2.0f;
+static constexpr float REVERSE_TIME = 1.0f;
+
+/// Maximum speed by difficulty.
+static const float MAX_SPEEDS[MAX_COMPETITOR_DIFFICULTIES] = { 20.0f, 25.0f, 30.0f };
+
+CompetitorAIComponent::CompetitorAIComponent(Context* context) :
+    Component(context)
+{
+}
+
+void CompetitorAIComponent::RegisterObject(Context* context)
+{
+    context->RegisterFactory<CompetitorAIComponent>();
+}
+
+void CompetitorAIComponent::SetPodCircuit(PodCircuit* circ, bool reverse)
+{
+    const PodCircuit::Difficulty* difficulties[MAX_COMPETITOR_DIFFICULTIES] = {
+        reverse ? &circ->difficultyReverseEasy_ : &circ->difficultyForwardEasy_,
+        reverse ? &circ->difficultyReverseNormal_ : &circ->difficultyForwardNormal_,
+        reverse ? &circ->difficultyReverseHard_ : &circ->difficultyForwardHard_
+    };
+    for (unsigned i = 0; i < MAX_COMPETITOR_DIFFICULTIES; i++)
+        paths_[i].Build(difficulties[i]->Path.Positions);
+}
+
+void CompetitorAIComponent::AddCompetitor(VehicleComponent* vehicle, CompetitorDifficulty difficulty)
+{
+    Competitor competitor{};
+    competitor.Vehicle = vehicle;
+    competitor.Difficulty = difficulty;
+    competitors_.Push(competitor);
+}
+
+void CompetitorAIComponent::RemoveAllCompetitors()
+{
+    competitors_.Clear();
+}
+
+void CompetitorAIComponent::OnSceneSet(Scene* scene)
+{
+    if (scene)
+        SubscribeToEvent(E_PHYSICSPRESTEP, URHO3D_HANDLER(CompetitorAIComponent, HandlePhysicsPreStep));
+    else
+        UnsubscribeFromEvent(E_PHYSICSPRESTEP);
+}
+
+void CompetitorAIComponent::HandlePhysicsPreStep(StringHash eventType, VariantMap& eventData)
+{
+    using namespace PhysicsPreStep;
+
+    auto* world = static_cast<PhysicsWorld*>(eventData[P_WORLD].GetPtr());
+    if (world && world->GetScene() == GetScene() && IsEnabledEffective())
+        UpdateCompetitors(eventData[P_TIMESTEP].GetFloat());
+}
+
+void CompetitorAIComponent::UpdateCompetitors(float timeStep)
+{
+    URHO3D_PROFILE(UpdateCompetitors);
+
+    // Read the vehicle states on the main thread, dropping the removed vehicles
+    for (unsigned i = 0; i < competitors_.Size();)
+    {
+        Competitor& competitor = competitors_[i];
+        VehicleComponent* vehicle = competitor.Vehicle.Get();
+        if (!vehicle)
+        {
+            competitors_.Erase(i);
+            continue;
+        }
+
+        Node* vehicleNode = vehicle->GetNode();
+        RigidBody* hullBody = vehicle->GetHullBody();
+        competitor.Position = vehicleNode->GetWorldPosition();
+        competitor.Rotation = vehicleNode->GetWorldRotation();
+        competitor.Velocity = hullBody ? hullBody->GetLinearVelocity() : Vector3::ZERO;
+        i++;
+    }
+
+    auto* queue = GetSubsystem<WorkQueue>();
+    unsigned numCompetitors = competitors_.Size();
+    if (threaded_ && queue->GetNumThreads() && numCompetitors >= MIN_THREADED_COMPETITORS)
+    {
+        // The competitors only write their own state, so the result does not depend on the chunk scheduling
+        Competitor* competitors = competitors_.Buffer();
+        queue->ParallelFor(0, numCompetitors, COMPETITORS_PER_CHUNK,
+            [this, competitors, timeStep](unsigned start, unsigned end, unsigned threadIndex)
+        {
+            for (unsigned i = start; i < end; ++i)
+                UpdateCompetitor(competitors[i], timeStep);
+        });
+    }
+    else
+    {
+        for (Competitor& competitor : competitors_)
+            UpdateCompetitor(competitor, timeStep);
+    }
+
+    for (Competitor& competitor : competitors_)
+        competitor.Vehicle->controls_.buttons_ = competitor.Buttons;
+}
+
+void CompetitorAIComponent::UpdateCompetitor(Competitor& competitor, float timeStep) const
+{
+    const PodCircuitPath& path = paths_[competitor.Difficulty];
+    if (path.IsEmpty())
+    {
+        competitor.Buttons = 0;
+        return;
+    }
+
+    PodCircuitPath::Projection nearest = path.FindNearest(competitor.Position);
+    competitor.PathDistance = nearest.Distance;
+
+    Vector3 forward = competitor.Rotation * Vector3::FORWARD;
+    float speed = competitor.Velocity.DotProduct(forward);
+    float aheadSpeed = Max(speed, 0.0f);
+
+    // Steer toward a point ahead on the path, positive angles are to the right
+    Vector3 target = path.GetPosition(nearest.Distance + STEER_LOOKAHEAD_DISTANCE + aheadSpeed * STEER_LOOKAHEAD_TIME);
+    Vector3 localTarget = competitor.Rotation.Inverse() * (target - competitor.Position);
+    float targetAngle = Atan2(localTarget.x_, localTarget.z_);
+
+    // Slow down before the corners, by how much the path turns ahead
+    int cornerSegment = path.GetSegment(nearest.Distance + CORNER_LOOKAHEAD_DISTANCE +
+        aheadSpeed * CORNER_LOOKAHEAD_TIME);
+    float cornerAngle = path.GetSegmentDirection(nearest.Segment).Angle(path.GetSegmentDirection(cornerSegment));
+    float targetSpeed = MAX_SPEEDS[competitor.Difficulty] * Lerp(1.0f, CORNER_SPEED_FACTOR, Min(cornerAngle / 90.0f,
+        1.0f));
+
+    unsigned buttons = 0;
+    if (targetAngle < -STEER_DEAD_ZONE)
+        buttons |= CTRL_LEFT;
+    else if (targetAngle > STEER_DEAD_ZONE)
+        buttons |= CTRL_RIGHT;
+    if (speed < targetSpeed)
+        buttons |= CTRL_FORWARD;
+    else if (speed > targetSpeed * BRAKE_SPEED_RATIO)
+        buttons |= CTRL_BACK;
+
+    // Reverse out of walls, steering the other way to turn the front toward the path
+    if (competitor.ReverseTime > 0.0f)
+    {
+        competitor.ReverseTime -= timeStep;
+        buttons = CTRL_BACK | ((buttons & CTRL_LEFT) ? CTRL_RIGHT : 0) | ((buttons & CTRL_RIGHT) ? CTRL_LEFT : 0);
+    }
+    else if ((buttons & CTRL_FORWARD) && Abs(speed) < STUCK_SPEED)
+    {
+        competitor.StuckTime += timeStep;
+        if (competitor.StuckTime > STUCK_TIME)
+        {
+            competitor.StuckTime = 0.0f;
+            competitor.ReverseTime = REVERSE_TIME;
+        }
+    }
+    else
+        competitor.StuckTime = 0.0f;
+
+    competitor.Buttons = buttons;
+}
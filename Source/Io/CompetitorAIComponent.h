@@ -0,0 +1,112 @@
+//
+// Copyright (c) 2008-2019 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include <Urho3D/Scene/Component.h>
+#include "PodCircuit.h"
+#include "PodCircuitPath.h"
+
+using namespace Urho3D;
+
+class VehicleComponent;
+
+/// Competitor difficulty, selecting the circuit difficulty path followed and the driving speed.
+enum CompetitorDifficulty
+{
+    CD_EASY = 0,
+    CD_NORMAL,
+    CD_HARD,
+    MAX_COMPETITOR_DIFFICULTIES
+};
+
+/// Competitor AI component, driving the competitor vehicles along the circuit difficulty paths. All the competitors
+/// are updated in one batched pass on the physics pre-step, split over the worker threads for large grids. The
+/// pre-step is sent before the fixed updates of the vehicles, so the controls apply in the same physics step whatever
+/// the creation order.
+class CompetitorAIComponent : public Component
+{
+    URHO3D_OBJECT(CompetitorAIComponent, Component)
+
+public:
+    /// Construct.
+    explicit CompetitorAIComponent(Context* context);
+
+    /// Register object factory.
+    static void RegisterObject(Context* context);
+
+    /// Build the paths of the circuit difficulties, forward or reverse.
+    void SetPodCircuit(PodCircuit* circ, bool reverse = false);
+
+    /// Add a vehicle driven along the path of a difficulty.
+    void AddCompetitor(VehicleComponent* vehicle, CompetitorDifficulty difficulty);
+
+    /// Remove all the competitors.
+    void RemoveAllCompetitors();
+
+    /// Set whether to split the update over the worker threads when there are enough competitors.
+    void SetThreaded(bool enable) { threaded_ = enable; }
+
+    /// Return the number of competitors.
+    unsigned GetNumCompetitors() const { return competitors_.Size(); }
+
+    /// Return the path of a difficulty.
+    const PodCircuitPath& GetPath(CompetitorDifficulty difficulty) const { return paths_[difficulty]; }
+
+protected:
+    /// Handle scene being assigned, subscribe to the physics pre-step.
+    void OnSceneSet(Scene* scene) override;
+
+private:
+    /// Driving state of a competitor, read from its vehicle before the update and written back after it.
+    struct Competitor
+    {
+        WeakPtr<VehicleComponent> Vehicle;
+        CompetitorDifficulty Difficulty;
+        Vector3 Position;
+        Quaternion Rotation;
+        Vector3 Velocity;
+        /// Distance along the path at the last update.
+        float PathDistance;
+        /// Time spent accelerating without moving.
+        float StuckTime;
+        /// Remaining time reversing out of a stuck position.
+        float ReverseTime;
+        /// Control buttons computed by the update.
+        unsigned Buttons;
+    };
+
+    /// Handle the physics pre-step of the scene, drive all the competitors.
+    void HandlePhysicsPreStep(StringHash eventType, VariantMap& eventData);
+
+    /// Drive all the competitors for a physics step.
+    void UpdateCompetitors(float timeStep);
+
+    /// Compute the controls of a competitor from its vehicle state.
+    void UpdateCompetitor(Competitor& competitor, float timeStep) const;
+
+    PodCircuitPath paths_[MAX_COMPETITOR_DIFFICULTIES];
+
+    Vector<Competitor> competitors_;
+
+    bool threaded_ = true;
+};
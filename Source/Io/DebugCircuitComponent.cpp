@@ -21,102 +21,51 @@
 //
 
 #include <Urho3D/Core/Context.h>
-#include <Urho3D/Graphics/Material.h>
-#include <Urho3D/Graphics/Technique.h>
+#include <Urho3D/Core/CoreEvents.h>
+#include <Urho3D/Graphics/Camera.h>
+#include <Urho3D/Graphics/DebugRenderer.h>
 #include <Urho3D/Graphics/Model.h>
-#include <Urho3D/Graphics/StaticModel.h>
-#include <Urho3D/Resource/ResourceCache.h>
+#include <Urho3D/Graphics/Renderer.h>
+#include <Urho3D/Graphics/Viewport.h>
 #include <Urho3D/Scene/Scene.h>
-#include <Urho3D/UI/Text3D.h>
-#include <Urho3D/UI/Font.h>
 
-#include "PodVehicle.h"
+#include "imgui.h"
+#include "ImGuiIntegration.h"
 #include "DebugCircuitComponent.h"
 
 extern String debug_enabledDifficulty;
 extern HashMap<String, Vector<int>> debug_enabledPointLists;
 extern HashMap<String, bool> debug_enabledAllPositions;
 
-static Node* CreateDebugModel(SharedPtr<Node>& parent, Model* model, const Vector3& pos, const Vector3& scl, const Color& color,
-    FillMode fill, String name, const Vector3& textTranslate = Vector3())
-{
-    auto cache = parent->GetContext()->GetSubsystem<ResourceCache>();
-    auto node = parent->CreateChild();
-    node->SetPosition(pos);
-    node->SetScale(scl);
-    // TODO: rotation
-
-    auto mat = new Material(parent->GetContext());
-    if (color.a_ < 1.0f)
-        mat->SetTechnique(0, cache->GetResource<Technique>("Techniques/NoTextureUnlitAlpha.xml"));
-    else
-        mat->SetTechnique(0, cache->GetResource<Technique>("Techniques/NoTextureUnlit.xml"));
-    mat->SetShaderParameter("MatDiffColor", color);
-    mat->SetFillMode(fill);
-    mat->SetCullMode(CULL_NONE);
-
-    auto modelObj = node->CreateComponent<StaticModel>();
-    modelObj->SetModel(model);
-    modelObj->SetMaterial(mat);
-
-    auto textNode = node->CreateChild();
-    textNode->Translate(textTranslate);
-    textNode->Translate(Vector3(0.0f, 2.0f, 0.0f));
-    auto text = textNode->CreateComponent<Text3D>();
-    text->SetText(name);
-    text->SetFont(cache->GetResource<Font>("Fonts/Anonymous Pro.sdf"), 24);
-    text->SetColor(Color::WHITE);
-    text->SetAlignment(HA_CENTER, VA_CENTER);
-
-    return node;
-}
+/// Height of the labels above their item.
+static constexpr float LABEL_HEIGHT = 2.0f;
 
-static Node* CreateDebugBox(SharedPtr<Node>& parent, const Vector3& pos, const Vector3& scl, const Color& color, FillMode fill, String name = "")
+/// Distance from the camera beyond which the labels are not drawn.
+static constexpr float LABEL_DISTANCE = 150.0f;
+
+/// Return the index of a category flag.
+static unsigned GetCategoryIndex(unsigned category)
 {
-    auto cache = parent->GetContext()->GetSubsystem<ResourceCache>();
-    auto model = cache->GetResource<Model>("Models/Box.mdl");
-    return CreateDebugModel(parent, model, pos, scl, color, fill, name);
+    unsigned index = 0;
+    while (!(category & 1u))
+    {
+        category >>= 1;
+        index++;
+    }
+    return index;
 }
 
-static Node* CreateDebugPlane(SharedPtr<Node>& parent, const Vector3& p1, const Vector3& p2, const Vector3& p3, const Vector3& p4,
-    const Vector3& normal, const Color& color, FillMode fill, String name = "")
+/// Return a box of the given size centered on a position.
+static BoundingBox GetCenteredBox(const Vector3& center, const Vector3& size)
 {
-    auto cache = parent->GetContext()->GetSubsystem<ResourceCache>();
-    SharedPtr<Model> model(new Model(parent->GetContext()));
-    SharedPtr<VertexBuffer> vb(new VertexBuffer(parent->GetContext()));
-    SharedPtr<IndexBuffer> ib(new IndexBuffer(parent->GetContext()));
-    SharedPtr<Geometry> geom(new Geometry(parent->GetContext()));
-    Vector3 data[] = {
-        p1, normal,
-        p2, normal,
-        p3, normal,
-        p4, normal,
-    };
-    unsigned short indices[] = { 0, 1, 2, 0, 2, 3 };
-    vb->SetSize(4, { VertexElement(TYPE_VECTOR3, SEM_POSITION), VertexElement(TYPE_VECTOR3, SEM_NORMAL) });
-    vb->SetData((float*)data);
-    ib->SetSize(6, false);
-    ib->SetData(indices);
-    geom->SetVertexBuffer(0, vb);
-    geom->SetIndexBuffer(ib);
-    geom->SetDrawRange(TRIANGLE_LIST, 0, 6);
-    model->SetNumGeometries(1);
-    model->SetGeometry(0, 0, geom);
-
-    BoundingBox bounds;
-    bounds.Merge(p1);
-    bounds.Merge(p2);
-    bounds.Merge(p3);
-    bounds.Merge(p4);
-    model->SetBoundingBox(bounds);
-    return CreateDebugModel(parent, model, Vector3(0.0f, 0.0f, 0.0f), Vector3(1.0f, 1.0f, 1.0f), color, fill, name, bounds.Center());
+    return BoundingBox(center - size * 0.5f, center + size * 0.5f);
 }
 
 DebugCircuitComponent::DebugCircuitComponent(Context* context) :
-    LogicComponent(context)
+    Component(context),
+    circ_(nullptr),
+    categories_(DCC_ALL)
 {
-    // Only the physics update event is needed: unsubscribe from the rest for optimization
-    // SetUpdateEventMask(USE_FIXEDUPDATE);
 }
 
 void DebugCircuitComponent::RegisterObject(Context* context)
@@ -124,27 +73,70 @@ void DebugCircuitComponent::RegisterObject(Context* context)
     context->RegisterFactory<DebugCircuitComponent>();
 }
 
-void DebugCircuitComponent::SetPodCircuit(PodCircuit* circ)
+void DebugCircuitComponent::AddBox(unsigned category, const BoundingBox& box, const Matrix3x4& transform,
+    const Color& color, bool solid, const String& label)
 {
-    circ_ = circ;
+    DebugCategory& dest = shapeCategories_[GetCategoryIndex(category)];
 
-    auto cache = GetSubsystem<ResourceCache>();
+    DebugBox debugBox;
+    debugBox.Box = box;
+    debugBox.Transform = transform;
+    debugBox.WorldBounds = box.Transformed(transform);
+    debugBox.ShapeColor = color;
+    debugBox.Solid = solid;
+    dest.Boxes.Push(debugBox);
 
-    if (!debugGroup_)
-        debugGroup_ = GetNode()->CreateChild("Debug");
+    if (!label.Empty())
+    {
+        DebugLabel debugLabel;
+        debugLabel.Text = label;
+        debugLabel.Position = transform * box.Center() + Vector3(0.0f, LABEL_HEIGHT, 0.0f);
+        dest.Labels.Push(debugLabel);
+    }
+}
 
-    debugGroup_->RemoveAllChildren();
+void DebugCircuitComponent::AddQuad(unsigned category, const Vector3* corners, const Color& color, const String& label)
+{
+    DebugCategory& dest = shapeCategories_[GetCategoryIndex(category)];
+
+    DebugQuad debugQuad;
+    debugQuad.WorldBounds.Clear();
+    for (unsigned i = 0; i < 4; i++)
+    {
+        debugQuad.Corners[i] = corners[i];
+        debugQuad.WorldBounds.Merge(corners[i]);
+    }
+    debugQuad.ShapeColor = color;
+    dest.Quads.Push(debugQuad);
+
+    DebugLabel debugLabel;
+    debugLabel.Text = label;
+    debugLabel.Position = debugQuad.WorldBounds.Center() + Vector3(0.0f, LABEL_HEIGHT, 0.0f);
+    dest.Labels.Push(debugLabel);
+}
+
+void DebugCircuitComponent::SetPodCircuit(PodCircuit* circ)
+{
+    circ_ = circ;
+
+    for (DebugCategory& category : shapeCategories_)
+    {
+        category.Boxes.Clear();
+        category.Quads.Clear();
+        category.Labels.Clear();
+    }
 
     for (const auto& dec : circ->GetDecorationInstances())
     {
         auto model = circ->GetDecorationModel(dec.Index);
-        auto& bounds = model->GetBoundingBox();
-        auto node = CreateDebugBox(debugGroup_, dec.Position, (bounds.max_ - bounds.min_), Color::RED, FILL_WIREFRAME, String("Decoration ") + String(dec.Index));
-        node->SetRotation(Quaternion(dec.Rotation));
+        AddBox(DCC_DECORATIONS, model->GetBoundingBox(), Matrix3x4(dec.Position, Quaternion(dec.Rotation), 1.0f),
+            Color::RED, false, String("Decoration ") + String(dec.Index));
     }
 
+    const Vector3 lightSize(5.0f, 5.0f, 5.0f);
     for (const auto& light : circ->GetGlobalLights())
-        CreateDebugBox(debugGroup_, light.Position, Vector3(5.0f, 5.0f, 5.0f), Color::YELLOW, FILL_SOLID, "GlobalLight");
+        AddBox(DCC_LIGHTS, GetCenteredBox(light.Position, lightSize), Matrix3x4::IDENTITY, Color::YELLOW, true,
+            "GlobalLight");
 
     for (int i = 0; i < circ->GetSectors().Size(); i++)
     {
@@ -156,16 +148,19 @@ void DebugCircuitComponent::SetPodCircuit(PodCircuit* circ)
             String name = "Light";
             if (light.Type == 1)
                 name = "SpotLight";
-            CreateDebugBox(debugGroup_, light.Position, Vector3(5.0f, 5.0f, 5.0f), Color::YELLOW, FILL_SOLID, name);
+            AddBox(DCC_LIGHTS, GetCenteredBox(light.Position, lightSize), Matrix3x4::IDENTITY, Color::YELLOW, true,
+                name);
         }
     }
 
+    const Vector3 markerSize(3.0f, 3.0f, 3.0f);
     int sidx = 0;
     for (auto& sound : circ->soundSection_.Sounds)
     {
         fp1616_t* values = reinterpret_cast<fp1616_t*>(&sound.Data[1]);
         Vector3 pos = PodTransform(Vector3FromFP1616(values));
-        CreateDebugBox(debugGroup_, pos, Vector3(3.0f, 3.0f, 3.0f), Color::RED, FILL_SOLID, "Sound " + String(sidx++));
+        AddBox(DCC_SOUNDS, GetCenteredBox(pos, markerSize), Matrix3x4::IDENTITY, Color::RED, true,
+            "Sound " + String(sidx++));
     }
 
     for (const auto& zone : circ->GetRepairZones())
@@ -177,55 +172,183 @@ void DebugCircuitComponent::SetPodCircuit(PodCircuit* circ)
 
         Color color = Color::BLUE;
         color.a_ = 0.75f;
-        CreateDebugBox(debugGroup_, zone.CenterPos + Vector3(0.0f, zone.Height*0.5f, 0.0f), scl, color, FILL_SOLID, "RepairZone");
+        AddBox(DCC_REPAIRZONES, GetCenteredBox(zone.CenterPos + Vector3(0.0f, zone.Height * 0.5f, 0.0f), scl),
+            Matrix3x4::IDENTITY, color, true, "RepairZone");
+    }
+
+    for (auto& start : circ_->designationForward_.Starts)
+    {
+        fp1616_t* values = reinterpret_cast<fp1616_t*>(start.Data);
+        Vector3 pos = PodTransform(Vector3FromFP1616(values));
+        AddBox(DCC_STARTS, GetCenteredBox(pos, markerSize), Matrix3x4::IDENTITY, Color::GREEN, true, "Start");
+    }
+
+    int mi = 0;
+    for (auto& macro : circ_->designationForward_.MacroSection.DesignationMacros)
+    {
+        Vector3 corners[] = { macro.PlanePos1, macro.PlanePos2, macro.PlanePos3, macro.PlanePos4 };
+        AddQuad(DCC_DESIGNATIONS, corners, Color(0.0f, 1.0f, 1.0f, 0.5f), "DesignationMacro " + String(mi++));
     }
 
+    UpdateEventSubscription();
+}
+
+void DebugCircuitComponent::SetCategories(unsigned categories)
+{
+    categories_ = categories;
+    UpdateEventSubscription();
+}
+
+void DebugCircuitComponent::DrawDebugGeometry(DebugRenderer* debug, bool depthTest)
+{
+    if (!circ_)
+        return;
+
+    for (unsigned i = 0; i < NUM_DEBUG_SHAPE_CATEGORIES; i++)
     {
-        for (auto& start : circ_->designationForward_.Starts)
+        if (!(categories_ & (1u << i)))
+            continue;
+
+        const DebugCategory& category = shapeCategories_[i];
+        for (const DebugBox& box : category.Boxes)
         {
-            fp1616_t* values = reinterpret_cast<fp1616_t*>(start.Data);
-            Vector3 pos = PodTransform(Vector3FromFP1616(values));
-            CreateDebugBox(debugGroup_, pos, Vector3(3.0f, 3.0f, 3.0f), Color::GREEN, FILL_SOLID, "Start");
+            if (debug->IsInside(box.WorldBounds))
+                debug->AddBoundingBox(box.Box, box.Transform, box.ShapeColor, depthTest, box.Solid);
         }
-
-        int mi = 0;
-        for (auto& macro : circ_->designationForward_.MacroSection.DesignationMacros)
+        for (const DebugQuad& quad : category.Quads)
         {
-            CreateDebugPlane(debugGroup_, macro.PlanePos1, macro.PlanePos2, macro.PlanePos3, macro.PlanePos4, macro.PlaneNormal,
-                Color(0.0f, 1.0f, 1.0f, 0.5f), FILL_SOLID, "DesignationMacro " + String(mi++));
+            if (debug->IsInside(quad.WorldBounds))
+                debug->AddPolygon(quad.Corners[0], quad.Corners[1], quad.Corners[2], quad.Corners[3], quad.ShapeColor,
+                    depthTest);
         }
     }
 
-    auto DebugDifficulty = [this](PodCircuit::Difficulty& d) {
-        if (debug_enabledDifficulty != d.Path.Name) return;
+    if (categories_ & DCC_DIFFICULTY)
+    {
+        DrawDifficulty(circ_->difficultyForwardEasy_, debug, depthTest);
+        DrawDifficulty(circ_->difficultyForwardNormal_, debug, depthTest);
+        DrawDifficulty(circ_->difficultyForwardHard_, debug, depthTest);
+        DrawDifficulty(circ_->difficultyReverseEasy_, debug, depthTest);
+        DrawDifficulty(circ_->difficultyReverseNormal_, debug, depthTest);
+        DrawDifficulty(circ_->difficultyReverseHard_, debug, depthTest);
+    }
+}
+
+void DebugCircuitComponent::DrawDifficulty(const PodCircuit::Difficulty& d, DebugRenderer* debug, bool depthTest)
+{
+    if (debug_enabledDifficulty != d.Path.Name) return;
+
+    const Vector3 sectionSize(5.0f, 5.0f, 5.0f);
+    const Vector3 pointSize(3.0f, 3.0f, 3.0f);
+    const Color pointColor(1.0f, 0.0f, 1.0f, 1.0f);
+
+    for (const auto& section : d.Level.Config1s)
+    {
+        BoundingBox box = GetCenteredBox(section.Position, sectionSize);
+        if (debug->IsInside(box))
+            debug->AddBoundingBox(box, Color(0.0f, 1.0f, 0.0f, 0.75f), depthTest, true);
+    }
+
+    auto& enabledPointLists = debug_enabledPointLists[d.Path.Name];
+    if (!enabledPointLists.Size())
+        enabledPointLists.Resize(d.Path.PointLists.Size());
+
+    for (int i = 0; i < d.Path.PointLists.Size(); i++)
+    {
+        if (!enabledPointLists[i]) continue;
 
-        int si = 0;
-        for (const auto& section : d.Level.Config1s)
+        for (const auto& point : d.Path.PointLists[i].Points)
         {
-            Color c = Color(0.0f, 1.0f, 0.0f, 0.75f);
-            CreateDebugBox(debugGroup_, section.Position, Vector3(5.0f, 5.0f, 5.0f), c, FILL_SOLID, "Section " + String(si++));
+            BoundingBox box = GetCenteredBox(d.Path.Positions[point.PositionIndex], pointSize);
+            if (debug->IsInside(box))
+                debug->AddBoundingBox(box, pointColor, depthTest, true);
         }
+    }
 
-        for (int i = 0; i < d.Path.PointLists.Size(); i++)
+    if (debug_enabledAllPositions[d.Path.Name])
+    {
+        for (const auto& pos : d.Path.Positions)
         {
-            auto& enabledPointLists = debug_enabledPointLists[d.Path.Name];
-            if (!enabledPointLists.Size())
-                enabledPointLists.Resize(d.Path.PointLists.Size());
-            if (!enabledPointLists[i]) continue;
-
-            auto& list = d.Path.PointLists[i];
-            for (const auto& point : list.Points)
-                CreateDebugBox(debugGroup_, d.Path.Positions[point.PositionIndex], Vector3(3.0f, 3.0f, 3.0f), Color(1.0f, 0.0f, 1.0f, 1.0f), FILL_SOLID);
+            BoundingBox box = GetCenteredBox(pos, pointSize);
+            if (debug->IsInside(box))
+                debug->AddBoundingBox(box, pointColor, depthTest, true);
         }
+    }
+}
+
+void DebugCircuitComponent::DrawDifficultyLabels(const PodCircuit::Difficulty& d, const Camera* camera)
+{
+    if (debug_enabledDifficulty != d.Path.Name) return;
+
+    int si = 0;
+    for (const auto& section : d.Level.Config1s)
+        DrawLabel("Section " + String(si++), section.Position + Vector3(0.0f, LABEL_HEIGHT, 0.0f), camera);
+}
+
+void DebugCircuitComponent::DrawLabel(const String& text, const Vector3& position, const Camera* camera)
+{
+    Vector3 viewPosition = camera->GetView() * position;
+    if (viewPosition.z_ <= 0.0f || viewPosition.z_ > LABEL_DISTANCE)
+        return;
 
-        if (debug_enabledAllPositions[d.Path.Name])
-            for (const auto& pos : d.Path.Positions)
-                CreateDebugBox(debugGroup_, pos, Vector3(3.0f, 3.0f, 3.0f), Color(1.0f, 0.0f, 1.0f, 1.0f), FILL_SOLID);
-    };
-    DebugDifficulty(circ->difficultyForwardEasy_);
-    DebugDifficulty(circ->difficultyForwardNormal_);
-    DebugDifficulty(circ->difficultyForwardHard_);
-    DebugDifficulty(circ->difficultyReverseEasy_);
-    DebugDifficulty(circ->difficultyReverseNormal_);
-    DebugDifficulty(circ->difficultyReverseHard_);
+    Vector2 screenPosition = camera->WorldToScreenPoint(position);
+    if (screenPosition.x_ < 0.0f || screenPosition.x_ > 1.0f || screenPosition.y_ < 0.0f || screenPosition.y_ > 1.0f)
+        return;
+
+    // All the labels go to the same draw list, drawn in one batch with the font atlas
+    const ImVec2& displaySize = ImGui::GetIO().DisplaySize;
+    ImVec2 textSize = ImGui::CalcTextSize(text.CString());
+    ImVec2 textPosition(screenPosition.x_ * displaySize.x - textSize.x * 0.5f,
+        screenPosition.y_ * displaySize.y - textSize.y * 0.5f);
+    ImGui::GetBackgroundDrawList()->AddText(textPosition, IM_COL32_WHITE, text.CString());
+}
+
+void DebugCircuitComponent::UpdateEventSubscription()
+{
+    bool drawShapes = circ_ && (categories_ & ~DCC_LABELS);
+    if (drawShapes)
+        SubscribeToEvent(E_POSTRENDERUPDATE, URHO3D_HANDLER(DebugCircuitComponent, HandlePostRenderUpdate));
+    else
+        UnsubscribeFromEvent(E_POSTRENDERUPDATE);
+
+    if (drawShapes && (categories_ & DCC_LABELS))
+        SubscribeToEvent(E_IMGUI_NEWFRAME, URHO3D_HANDLER(DebugCircuitComponent, HandleImGuiFrame));
+    else
+        UnsubscribeFromEvent(E_IMGUI_NEWFRAME);
+}
+
+void DebugCircuitComponent::HandlePostRenderUpdate(StringHash eventType, VariantMap& eventData)
+{
+    Scene* scene = GetScene();
+    auto* debug = scene ? scene->GetComponent<DebugRenderer>() : nullptr;
+    if (debug && IsEnabledEffective())
+        DrawDebugGeometry(debug, true);
+}
+
+void DebugCircuitComponent::HandleImGuiFrame(StringHash eventType, VariantMap& eventData)
+{
+    auto* renderer = GetSubsystem<Renderer>();
+    Viewport* viewport = renderer ? renderer->GetViewport(0) : nullptr;
+    Camera* camera = viewport ? viewport->GetCamera() : nullptr;
+    if (!camera || !IsEnabledEffective())
+        return;
+
+    for (unsigned i = 0; i < NUM_DEBUG_SHAPE_CATEGORIES; i++)
+    {
+        if (!(categories_ & (1u << i)))
+            continue;
+
+        for (const DebugLabel& label : shapeCategories_[i].Labels)
+            DrawLabel(label.Text, label.Position, camera);
+    }
+
+    if (categories_ & DCC_DIFFICULTY)
+    {
+        DrawDifficultyLabels(circ_->difficultyForwardEasy_, camera);
+        DrawDifficultyLabels(circ_->difficultyForwardNormal_, camera);
+        DrawDifficultyLabels(circ_->difficultyForwardHard_, camera);
+        DrawDifficultyLabels(circ_->difficultyReverseEasy_, camera);
+        DrawDifficultyLabels(circ_->difficultyReverseNormal_, camera);
+        DrawDifficultyLabels(circ_->difficultyReverseHard_, camera);
+    }
 }
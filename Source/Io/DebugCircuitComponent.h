@@ -22,24 +22,41 @@
 
 #pragma once
 
-#include <Urho3D/Scene/LogicComponent.h>
+#include <Urho3D/Scene/Component.h>
 #include "PodCircuit.h"
 
 namespace Urho3D
 {
 
-class Constraint;
-class Node;
-class RigidBody;
+class Camera;
 
 }
 
 using namespace Urho3D;
 
-/// Debug circuit component, responsible for displaying debug info
-class DebugCircuitComponent : public LogicComponent
+/// Categories of circuit data drawn by DebugCircuitComponent.
+enum DebugCircuitCategory : unsigned
 {
-    URHO3D_OBJECT(DebugCircuitComponent, LogicComponent)
+    DCC_DECORATIONS = 0x1,
+    DCC_LIGHTS = 0x2,
+    DCC_SOUNDS = 0x4,
+    DCC_REPAIRZONES = 0x8,
+    DCC_STARTS = 0x10,
+    DCC_DESIGNATIONS = 0x20,
+    DCC_DIFFICULTY = 0x40,
+    /// Names of the drawn items, requires ImGui.
+    DCC_LABELS = 0x80,
+    DCC_ALL = 0xff
+};
+
+/// Number of categories with shapes collected from the circuit, the decorations to the designations.
+static constexpr unsigned NUM_DEBUG_SHAPE_CATEGORIES = 6;
+
+/// Debug circuit component, responsible for displaying debug info. The circuit data is drawn each frame with the scene
+/// DebugRenderer and the labels with the ImGui background draw list, without creating any scene node or drawable.
+class DebugCircuitComponent : public Component
+{
+    URHO3D_OBJECT(DebugCircuitComponent, Component)
 
 public:
     /// Construct.
@@ -48,18 +65,79 @@ public:
     /// Register object factory and attributes.
     static void RegisterObject(Context* context);
 
-    /// Perform post-load after deserialization. Acquire the components from the scene nodes.
-    /// void ApplyAttributes() override;
-    /// Handle physics world update. Called by LogicComponent base class.
-    /// void FixedUpdate(float timeStep) override;
+    /// Visualize the component as debug geometry.
+    void DrawDebugGeometry(DebugRenderer* debug, bool depthTest) override;
 
-    /// Create rendering and physics components. Called by the application.
+    /// Collect the debug shapes of the circuit. Called by the application.
     void SetPodCircuit(PodCircuit* circ);
 
+    /// Set the drawn categories, DebugCircuitCategory flags. Nothing is done per frame when none is set.
+    void SetCategories(unsigned categories);
+    /// Return the drawn categories.
+    unsigned GetCategories() const { return categories_; }
+
 private:
+    /// Box of a circuit item, in the item space.
+    struct DebugBox
+    {
+        BoundingBox Box;
+        Matrix3x4 Transform;
+        /// World space bounds for the frustum test.
+        BoundingBox WorldBounds;
+        Color ShapeColor;
+        bool Solid;
+    };
+
+    /// Quad of a designation plane.
+    struct DebugQuad
+    {
+        Vector3 Corners[4];
+        BoundingBox WorldBounds;
+        Color ShapeColor;
+    };
+
+    /// Name of an item drawn above it.
+    struct DebugLabel
+    {
+        String Text;
+        Vector3 Position;
+    };
+
+    /// Shapes and labels of a category.
+    struct DebugCategory
+    {
+        PODVector<DebugBox> Boxes;
+        PODVector<DebugQuad> Quads;
+        Vector<DebugLabel> Labels;
+    };
+
+    /// Add an item box and its label.
+    void AddBox(unsigned category, const BoundingBox& box, const Matrix3x4& transform, const Color& color, bool solid,
+        const String& label);
+    /// Add a designation quad and its label.
+    void AddQuad(unsigned category, const Vector3* corners, const Color& color, const String& label);
+
+    /// Draw the boxes and labels of the difficulty selected for visualization.
+    void DrawDifficulty(const PodCircuit::Difficulty& d, DebugRenderer* debug, bool depthTest);
+    /// Draw the labels of the difficulty selected for visualization.
+    void DrawDifficultyLabels(const PodCircuit::Difficulty& d, const Camera* camera);
+
+    /// Draw a label above a position when in front of the camera and near it.
+    void DrawLabel(const String& text, const Vector3& position, const Camera* camera);
+
+    /// Subscribe to the drawing events of the enabled categories only.
+    void UpdateEventSubscription();
+
+    /// Handle the post render update, draw the debug geometry.
+    void HandlePostRenderUpdate(StringHash eventType, VariantMap& eventData);
+    /// Handle the ImGui frame, draw the labels.
+    void HandleImGuiFrame(StringHash eventType, VariantMap& eventData);
+
     PodCircuit* circ_;
 
-    SharedPtr<StaticModel> circModel_;
+    /// Enabled DebugCircuitCategory flags.
+    unsigned categories_;
 
-    SharedPtr<Node> debugGroup_;
+    /// Shapes of the decorations to the designations, by category bit.
+    DebugCategory shapeCategories_[NUM_DEBUG_SHAPE_CATEGORIES];
 };
@@ -0,0 +1,514 @@
+#include <cstdarg>
+#include <cstdio>
+#include <stdexcept>
+#include <Urho3D/Core/ProcessUtils.h>
+#include <Urho3D/Core/StringUtils.h>
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/IO/File.h>
+#include <Urho3D/IO/FileSystem.h>
+#include <Urho3D/IO/VectorBuffer.h>
+#include <Urho3D/Physics/PhysicsEvents.h>
+#include <Urho3D/Physics/RigidBody.h>
+#include <Urho3D/Scene/Node.h>
+#include "PodBenchmark.h"
+#include "PodCircuit.h"
+#include "PodCommon.h"
+
+static constexpr unsigned BENCHMARK_ITERATIONS = 10;
+
+/// Bytes read from the first section by the sections benchmark.
+static constexpr unsigned SECTION_READ_SIZE = 4096;
+
+/// Number of passes over the circuit objects timed by the vertices benchmark.
+static constexpr unsigned VERTEX_PASSES = 100;
+
+/// Node collision events sent by the events benchmark for each receiver count.
+static constexpr unsigned EVENT_SENDS = 100000;
+
+/// Receivers of the node collision events in the events benchmark.
+static const unsigned EVENT_RECEIVERS[] = { 1, 4, 16 };
+
+static const char* VEHICLES_PATH = "Io/DATA/BINARY/VOITURES/";
+static const char* CIRCUITS_PATH = "Io/DATA/BINARY/CIRCUITS/";
+
+/// Formats a result row with the C printf conventions, ToString supports neither %lld nor a float precision.
+static String FormatRow(const char* format, ...)
+{
+    char buffer[512];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    return String(buffer);
+}
+
+/// Bdf file which only decrypts the data, used to time the decryption step alone.
+class PodRawFile : public PodBdfFile
+{
+public:
+    explicit PodRawFile(Context* context, const String& fileName)
+        : PodBdfFile(context, fileName) {}
+
+    bool LoadData() override { return true; }
+
+    /// Return the size of the decrypted data held in memory.
+    unsigned GetDataSize() const { return data_.Size(); }
+
+    /// Return the block size.
+    unsigned GetBlockSize() const { return blockSize_; }
+};
+
+/// Reference implementation: the block by block decryption PodBdfFile::Load used before the in place decryption.
+static void DecryptReference(Context* context, const String& fileName)
+{
+    File file(context, fileName, FILE_READ);
+    if (!file.IsOpen())
+        return;
+
+    unsigned int key = file.ReadUInt() ^ file.GetSize();
+    file.Seek(0);
+
+    unsigned int blockSize = 0;
+    unsigned int sum = 0;
+    while (!file.IsEof())
+    {
+        unsigned int value = file.ReadUInt();
+        if (value == sum && (file.GetSize() % file.GetPosition() == 0))
+        {
+            blockSize = file.GetPosition();
+            break;
+        }
+        sum += value ^ key;
+    }
+    if (!blockSize)
+        throw std::runtime_error("Could not determine PDBF block size");
+    file.Seek(0);
+
+    int blockIndex = 0;
+    int blockDataSize = blockSize - sizeof(unsigned int);
+    int blockDataDwordCount = blockDataSize / sizeof(unsigned int);
+    PODVector<unsigned char> dest(file.GetSize() - (file.GetSize() / blockSize * sizeof(unsigned int)));
+
+    UniqueArray<unsigned char> block(new unsigned char[blockSize]);
+    unsigned int* blockDword = reinterpret_cast<unsigned int*>(block.Get());
+
+    while (!file.IsEof())
+    {
+        file.Read(block.Get(), blockSize);
+        int i = 0;
+        unsigned int checksum = 0;
+        if (blockIndex == 0 || (key != 0x00005CA8 && key != 0x0000D13F))
+        {
+            for (; i < blockDataDwordCount; i++)
+            {
+                unsigned int* value = blockDword + i;
+                checksum += (*value ^ key);
+                *value ^= key;
+            }
+        }
+        else
+        {
+            unsigned int lastValue = 0;
+            for (; i < blockDataDwordCount; i++)
+            {
+                unsigned int keyValue = 0;
+                switch (lastValue >> 16 & 3)
+                {
+                case 0: keyValue = lastValue - 0x50A4A89D; break;
+                case 1: keyValue = 0x3AF70BC4 - lastValue; break;
+                case 2: keyValue = (lastValue + 0x07091971) << 1; break;
+                case 3: keyValue = (0x11E67319 - lastValue) << 1; break;
+                }
+                unsigned int* value = blockDword + i;
+                lastValue = *value;
+                switch (lastValue & 3)
+                {
+                case 0: *value = ~(*value) ^ keyValue; break;
+                case 1: *value = ~(*value) ^ ~keyValue; break;
+                case 2: *value = (*value) ^ ~keyValue; break;
+                case 3: *value = (*value) ^ keyValue ^ 0xFFFF; break;
+                }
+                checksum += *value;
+            }
+        }
+        if (checksum != blockDword[i])
+            throw std::runtime_error("Invalid PBDF block checksum.");
+
+        dest.Insert(blockIndex * blockDataSize, PODVector<unsigned char>(block.Get(), blockDataSize));
+        blockIndex++;
+    }
+}
+
+static void GetShippedFiles(Context* context, Vector<String>& fileNames)
+{
+    auto* fileSystem = context->GetSubsystem<FileSystem>();
+    Vector<String> found;
+
+    fileSystem->ScanDir(found, VEHICLES_PATH, "*.BV4", SCAN_FILES, false);
+    for (const auto& name : found)
+        fileNames.Push(VEHICLES_PATH + name);
+
+    fileSystem->ScanDir(found, CIRCUITS_PATH, "*.BL4", SCAN_FILES, false);
+    for (const auto& name : found)
+        fileNames.Push(CIRCUITS_PATH + name);
+}
+
+/// Returns the average time in microseconds to load the file with PodRawFile.
+static long long TimeRawLoad(Context* context, const String& fileName, bool parallel)
+{
+    HiresTimer timer;
+    for (unsigned i = 0; i < BENCHMARK_ITERATIONS; i++)
+    {
+        PodRawFile file(context, fileName);
+        file.SetParallelDecrypt(parallel);
+        file.Load();
+    }
+    return timer.GetUSec(false) / BENCHMARK_ITERATIONS;
+}
+
+static void BenchmarkDecrypt(Context* context, const Vector<String>& fileNames)
+{
+    PrintLine("file;reference_usec;current_usec;parallel_usec;speedup;parallel_speedup");
+
+    long long totalReference = 0;
+    long long totalCurrent = 0;
+    long long totalParallel = 0;
+    for (const auto& fileName : fileNames)
+    {
+        HiresTimer timer;
+        for (unsigned i = 0; i < BENCHMARK_ITERATIONS; i++)
+            DecryptReference(context, fileName);
+        long long reference = timer.GetUSec(false) / BENCHMARK_ITERATIONS;
+        long long current = TimeRawLoad(context, fileName, false);
+        long long parallel = TimeRawLoad(context, fileName, true);
+
+        totalReference += reference;
+        totalCurrent += current;
+        totalParallel += parallel;
+        PrintLine(FormatRow("%s;%lld;%lld;%lld;%.2f;%.2f", fileName.CString(), reference, current, parallel,
+            current ? double(reference) / double(current) : 0.0, parallel ? double(reference) / double(parallel) : 0.0));
+    }
+
+    PrintLine(FormatRow("total;%lld;%lld;%lld;%.2f;%.2f", totalReference, totalCurrent, totalParallel,
+        totalCurrent ? double(totalReference) / double(totalCurrent) : 0.0,
+        totalParallel ? double(totalReference) / double(totalParallel) : 0.0));
+}
+
+/// Returns the average time in microseconds to open the file and read the start of its first section.
+static long long TimeFirstSection(Context* context, const String& fileName, bool lazy)
+{
+    PODVector<unsigned char> section(SECTION_READ_SIZE);
+    HiresTimer timer;
+    for (unsigned i = 0; i < BENCHMARK_ITERATIONS; i++)
+    {
+        PodRawFile file(context, fileName);
+        file.SetParallelDecrypt(false);
+        if (lazy ? !file.Open() : !file.Load())
+            return 0;
+        file.SeekOffset(0);
+        file.Read(section.Buffer(), section.Size());
+    }
+    return timer.GetUSec(false) / BENCHMARK_ITERATIONS;
+}
+
+static void BenchmarkSections(Context* context, const Vector<String>& fileNames)
+{
+    PrintLine("file;load_usec;open_usec;speedup;load_bytes;open_bytes");
+
+    long long totalLoad = 0;
+    long long totalOpen = 0;
+    for (const auto& fileName : fileNames)
+    {
+        long long load = TimeFirstSection(context, fileName, false);
+        long long open = TimeFirstSection(context, fileName, true);
+
+        // Memory held by each mode: the whole decrypted data, or the block cache after reading the first section
+        PodRawFile loaded(context, fileName);
+        PodRawFile opened(context, fileName);
+        if (!loaded.Load() || !opened.Open())
+            continue;
+        PODVector<unsigned char> section(SECTION_READ_SIZE);
+        opened.SeekOffset(0);
+        opened.Read(section.Buffer(), section.Size());
+        unsigned loadBytes = loaded.GetDataSize();
+        unsigned openBytes = opened.GetNumCachedBlocks() * opened.GetBlockSize();
+
+        totalLoad += load;
+        totalOpen += open;
+        PrintLine(FormatRow("%s;%lld;%lld;%.2f;%u;%u", fileName.CString(), load, open,
+            open ? double(load) / double(open) : 0.0, loadBytes, openBytes));
+    }
+
+    PrintLine(FormatRow("total;%lld;%lld;%.2f", totalLoad, totalOpen, totalOpen ? double(totalLoad) / double(totalOpen) : 0.0));
+}
+
+/// Fixed point vertex arrays of an object as read from the file, which ReadObject does not keep.
+struct FixedPointObject
+{
+    const ObjectData* Obj;
+    PODVector<fp1616_t> VertexArray;
+    PODVector<fp1616_t> Normals;
+};
+
+/// Pack converted vectors back to the fixed point file axes. Exact, the converted values are multiples of 1/65536.
+static void PackVectorsToFP1616(const PODVector<Vector3>& src, PODVector<fp1616_t>& dest)
+{
+    dest.Resize(src.Size() * 3);
+    for (unsigned i = 0; i < src.Size(); i++)
+    {
+        dest[i * 3 + 0] = (fp1616_t)(src[i].z_ * 65536.0f);
+        dest[i * 3 + 1] = (fp1616_t)(-src[i].x_ * 65536.0f);
+        dest[i * 3 + 2] = (fp1616_t)(src[i].y_ * 65536.0f);
+    }
+}
+
+/// Reference implementation: the per face vertex conversion GenerateDataFromFace did before the bulk conversion.
+static float GatherReference(const FixedPointObject& fixedObj)
+{
+    const ObjectData& obj = *fixedObj.Obj;
+    const fp1616_t* vdata = fixedObj.VertexArray.Buffer();
+    const fp1616_t* normals = fixedObj.Normals.Buffer();
+    float sum = 0.0f;
+    for (unsigned i = 0; i < obj.FaceCount; i++)
+    {
+        const FaceData& face = obj.FaceData.Get()[i];
+        for (unsigned j = 1; j + 1 < face.Vertices; j++)
+        {
+            unsigned idx[3] = { face.Indices[0], face.Indices[j], face.Indices[j + 1] };
+            for (unsigned index : idx)
+            {
+                Vector3 pos(-FloatFromFP1616(vdata[index * 3 + 1]), FloatFromFP1616(vdata[index * 3 + 2]),
+                    FloatFromFP1616(vdata[index * 3 + 0]));
+                Vector3 normal(-FloatFromFP1616(normals[index * 3 + 1]), FloatFromFP1616(normals[index * 3 + 2]),
+                    FloatFromFP1616(normals[index * 3 + 0]));
+                sum += pos.x_ + normal.y_;
+            }
+        }
+    }
+    return sum;
+}
+
+/// The bulk conversion of the object vertices, then the face vertices gathered from the converted arrays.
+static float GatherConverted(const FixedPointObject& fixedObj, PODVector<Vector3>& positions, PODVector<Vector3>& normals)
+{
+    const ObjectData& obj = *fixedObj.Obj;
+    positions.Resize(obj.VertexCount);
+    normals.Resize(obj.VertexCount);
+    ConvertVectorsFromFP1616(fixedObj.VertexArray.Buffer(), positions.Buffer(), obj.VertexCount);
+    ConvertVectorsFromFP1616(fixedObj.Normals.Buffer(), normals.Buffer(), obj.VertexCount);
+
+    float sum = 0.0f;
+    for (unsigned i = 0; i < obj.FaceCount; i++)
+    {
+        const FaceData& face = obj.FaceData.Get()[i];
+        for (unsigned j = 1; j + 1 < face.Vertices; j++)
+        {
+            unsigned idx[3] = { face.Indices[0], face.Indices[j], face.Indices[j + 1] };
+            for (unsigned index : idx)
+                sum += positions[index].x_ + normals[index].y_;
+        }
+    }
+    return sum;
+}
+
+static void BenchmarkVertices(Context* context, const Vector<String>& fileNames)
+{
+    PrintLine("file;vertices;reference_usec;converted_usec;speedup;match");
+
+    long long totalReference = 0;
+    long long totalConverted = 0;
+    for (const auto& fileName : fileNames)
+    {
+        if (!fileName.EndsWith(".BL4"))
+            continue;
+
+        PodCircuit circuit(context, fileName);
+        try
+        {
+            if (!circuit.Load())
+                continue;
+        }
+        catch (const std::exception& e)
+        {
+            PrintLine(fileName + ": " + e.what(), true);
+            continue;
+        }
+
+        PODVector<const ObjectData*> objects;
+        unsigned numVertices = 0;
+        for (const auto& sector : circuit.GetSectors())
+            objects.Push(&sector.Object);
+        for (const auto& decoration : circuit.GetDecorations())
+            objects.Push(&decoration.Object);
+        Vector<FixedPointObject> fixedObjects(objects.Size());
+        for (unsigned i = 0; i < objects.Size(); i++)
+        {
+            fixedObjects[i].Obj = objects[i];
+            PackVectorsToFP1616(objects[i]->Positions, fixedObjects[i].VertexArray);
+            PackVectorsToFP1616(objects[i]->VertexNormals, fixedObjects[i].Normals);
+            numVertices += objects[i]->VertexCount;
+        }
+
+        // The sums keep the gathers from being optimized out and check that both paths read the same values
+        float referenceSum = 0.0f;
+        HiresTimer timer;
+        for (unsigned i = 0; i < VERTEX_PASSES; i++)
+        {
+            for (const auto& fixedObj : fixedObjects)
+                referenceSum += GatherReference(fixedObj);
+        }
+        long long reference = timer.GetUSec(true) / VERTEX_PASSES;
+
+        float convertedSum = 0.0f;
+        PODVector<Vector3> positions;
+        PODVector<Vector3> normals;
+        for (unsigned i = 0; i < VERTEX_PASSES; i++)
+        {
+            for (const auto& fixedObj : fixedObjects)
+                convertedSum += GatherConverted(fixedObj, positions, normals);
+        }
+        long long converted = timer.GetUSec(false) / VERTEX_PASSES;
+
+        totalReference += reference;
+        totalConverted += converted;
+        PrintLine(FormatRow("%s;%u;%lld;%lld;%.2f;%s", fileName.CString(), numVertices, reference, converted,
+            converted ? double(reference) / double(converted) : 0.0, referenceSum == convertedSum ? "yes" : "no"));
+    }
+
+    PrintLine(FormatRow("total;;%lld;%lld;%.2f", totalReference, totalConverted,
+        totalConverted ? double(totalReference) / double(totalConverted) : 0.0));
+}
+
+/// Receiver of the node collision events, reading the same parameters from the VariantMap or the typed payload.
+class CollisionReceiver : public Object
+{
+    URHO3D_OBJECT(CollisionReceiver, Object);
+
+public:
+    explicit CollisionReceiver(Context* context) :
+        Object(context)
+    {
+    }
+
+    void HandleNodeCollision(StringHash eventType, VariantMap& eventData)
+    {
+        using namespace NodeCollision;
+
+        auto* otherNode = static_cast<Node*>(eventData[P_OTHERNODE].GetPtr());
+        bool trigger = eventData[P_TRIGGER].GetBool();
+        const PODVector<unsigned char>& contacts = eventData[P_CONTACTS].GetBuffer();
+        Count(otherNode, trigger, contacts);
+    }
+
+    void HandleTypedNodeCollision(NodeCollisionEventData& eventData)
+    {
+        Count(eventData.otherNode_, eventData.trigger_, *eventData.contacts_);
+    }
+
+    unsigned sum_ = 0;
+
+private:
+    void Count(Node* otherNode, bool trigger, const PODVector<unsigned char>& contacts)
+    {
+        sum_ += (otherNode ? 1 : 0) + (trigger ? 1 : 0) + contacts.Size();
+    }
+};
+
+/// Returns the average time in nanoseconds to send a node collision event to the receivers. The legacy sends fill the
+/// VariantMap like PhysicsWorld did before the typed events, the typed sends fall back to it for VariantMap receivers.
+static long long TimeNodeCollisions(Node* node, Node* otherNode, const PODVector<unsigned char>& contacts, bool typed)
+{
+    HiresTimer timer;
+    for (unsigned i = 0; i < EVENT_SENDS; i++)
+    {
+        if (typed)
+        {
+            NodeCollisionEventData eventData{nullptr, otherNode, nullptr, false, &contacts};
+            node->SendTypedEvent(eventData);
+        }
+        else
+        {
+            using namespace NodeCollision;
+
+            VariantMap& eventData = node->GetEventDataMap();
+            eventData[P_BODY] = (RigidBody*)nullptr;
+            eventData[P_OTHERNODE] = otherNode;
+            eventData[P_OTHERBODY] = (RigidBody*)nullptr;
+            eventData[P_TRIGGER] = false;
+            eventData[P_CONTACTS] = contacts;
+            node->SendEvent(E_NODECOLLISION, eventData);
+        }
+    }
+    return timer.GetUSec(false) * 1000 / EVENT_SENDS;
+}
+
+static void BenchmarkEvents(Context* context)
+{
+    PrintLine("receivers;legacy_nsec;typed_nsec;fallback_nsec;speedup;match");
+
+    SharedPtr<Node> node(new Node(context));
+    SharedPtr<Node> otherNode(new Node(context));
+    // One contact: position, normal, distance and impulse
+    VectorBuffer contacts;
+    contacts.WriteVector3(Vector3::ZERO);
+    contacts.WriteVector3(Vector3::UP);
+    contacts.WriteFloat(0.0f);
+    contacts.WriteFloat(1.0f);
+
+    for (unsigned numReceivers : EVENT_RECEIVERS)
+    {
+        Vector<SharedPtr<CollisionReceiver> > receivers;
+        for (unsigned i = 0; i < numReceivers; i++)
+            receivers.Push(MakeShared<CollisionReceiver>(context));
+
+        for (CollisionReceiver* receiver : receivers)
+            receiver->SubscribeToEvent(node, E_NODECOLLISION, new EventHandlerImpl<CollisionReceiver>(receiver,
+                &CollisionReceiver::HandleNodeCollision));
+        long long legacy = TimeNodeCollisions(node, otherNode, contacts.GetBuffer(), false);
+        // The same VariantMap receivers, reached through the typed send fallback
+        long long fallback = TimeNodeCollisions(node, otherNode, contacts.GetBuffer(), true);
+        unsigned legacySum = 0;
+        for (CollisionReceiver* receiver : receivers)
+        {
+            legacySum += receiver->sum_;
+            receiver->sum_ = 0;
+            receiver->UnsubscribeFromAllEvents();
+            receiver->SubscribeToTypedEvent(node, &CollisionReceiver::HandleTypedNodeCollision);
+        }
+
+        long long typed = TimeNodeCollisions(node, otherNode, contacts.GetBuffer(), true);
+        unsigned typedSum = 0;
+        for (CollisionReceiver* receiver : receivers)
+            typedSum += receiver->sum_;
+
+        // The legacy receivers got the events twice, from the legacy and the fallback sends
+        PrintLine(FormatRow("%u;%lld;%lld;%lld;%.2f;%s", numReceivers, legacy, typed, fallback,
+            typed ? double(legacy) / double(typed) : 0.0, legacySum == typedSum * 2 ? "yes" : "no"));
+    }
+}
+
+bool RunPodBenchmark(Context* context, const String& name)
+{
+    // The events benchmark needs no POD files
+    if (name == "events")
+    {
+        BenchmarkEvents(context);
+        return true;
+    }
+
+    Vector<String> fileNames;
+    GetShippedFiles(context, fileNames);
+    if (fileNames.Empty())
+        PrintLine("No POD files found in " + String(VEHICLES_PATH) + " or " + String(CIRCUITS_PATH), true);
+
+    if (name == "decrypt")
+        BenchmarkDecrypt(context, fileNames);
+    else if (name == "sections")
+        BenchmarkSections(context, fileNames);
+    else if (name == "vertices")
+        BenchmarkVertices(context, fileNames);
+    else
+        return false;
+
+    return true;
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <Urho3D/Core/Context.h>
+
+using namespace Urho3D;
+
+/// Runs the named micro-benchmark over the shipped VOITURES/CIRCUITS files, or over the engine events, and prints the results.
+/// Selected with the -benchmark <name> command line option. Returns false if the benchmark is unknown.
+bool RunPodBenchmark(Context* context, const String& name);
@@ -1,3 +1,4 @@
+#include <cstring>
 #include <stdexcept>
 #include <Urho3D/Graphics/Texture2D.h>
 #include <Urho3D/Resource/Image.h>
@@ -8,6 +9,12 @@
 #include <Urho3D/Graphics/Geometry.h>
 #include <Urho3D/Graphics/Technique.h>
 #include <Urho3D/Resource/ResourceCache.h>
+#include <Urho3D/IO/File.h>
+#include <Urho3D/IO/FileSystem.h>
+#include <Urho3D/IO/Log.h>
+#include <Urho3D/Core/Profiler.h>
+#include <Urho3D/Core/Thread.h>
+#include <Urho3D/Core/WorkQueue.h>
 #include "PodCircuit.h"
 #include "PodModelGen.h"
 
@@ -27,6 +34,14 @@ enum Offset
 static constexpr int TEXTURE_WIDTH = 256;
 static constexpr int TEXTURE_HEIGHT = 256;
 
+/// Baked circuit cache format version, increase when the cached data layout changes.
+static constexpr unsigned CACHE_VERSION = 5;
+static const char* CACHE_FILE_ID = "IOBC";
+
+/// Collision cache format version, increase when the cached collision layout changes.
+static constexpr unsigned COLLISION_CACHE_VERSION = 3;
+static const char* COLLISION_CACHE_FILE_ID = "IOCC";
+
 static Matrix3 ReadRotation(PodBdfFile& file)
 {
     Vector3 rot[3];
@@ -618,21 +633,47 @@ bool PodCircuit::LoadData()
     SeekOffset(Offset::CompetitorsHard);
     ReadCompetitorSection(*this, competitorsHard_);
 
-    // Create main model, process sectors to create geometry
+    // Animated faces keep their own vertices, so their uvs can be patched
+    for (const auto& section : anim2Sections_)
+    {
+        for (const auto& sectorAnim : section.SectorAnimations)
+        {
+            for (const auto& sec : sectorAnim.Sectors)
+            {
+                for (const auto& face : sec.Faces)
+                    GetSectorFace(sec.SectorIndex, face.FaceType, face.FaceIndex)->Animated = true;
+            }
+        }
+    }
+
+    // Create main model, process sectors to create geometry. All sectors share the circuit textures
+    textureSet_ = new PodTextureSet(context_, textureList_);
+    textureSet_->SetNativeRGB565(nativeRGB565_);
     for (int i = 0; i < sectors_.Size(); i++)
     {
         auto& sec = sectors_[i];
         auto modelGen = new PodModelGen(context_, textureList_);
+        modelGen->SetTextureSet(textureSet_);
         modelGen->AddObject(sec.Object);
         modelGen->SetBounds(sec.BoundsMin, sec.BoundsMax);
         sectorModelGens_.Push(UniquePtr<PodModelGen>(modelGen));
+
+        // The transformed bounds may have swapped min and max components
+        BoundingBox bounds(sec.BoundsMin, sec.BoundsMin);
+        bounds.Merge(sec.BoundsMax);
+        sectorBounds_.Push(bounds);
     }
 
     // Process decoration objects
     for (int i = 0; i < envSection_.Decorations.Size(); i++)
     {
         auto& dec = envSection_.Decorations[i];
+        SharedPtr<PodTextureSet> textureSet(new PodTextureSet(context_, dec.Textures));
+        textureSet->SetNativeRGB565(nativeRGB565_);
+        decorationTextureSets_.Push(textureSet);
+
         auto modelGen = new PodModelGen(context_, dec.Textures);
+        modelGen->SetTextureSet(textureSet);
         modelGen->AddObject(dec.Object);
         decorationModelGens_.Push(UniquePtr<PodModelGen>(modelGen));
     }
@@ -640,6 +681,12 @@ bool PodCircuit::LoadData()
     return true;
 }
 
+FaceData* PodCircuit::GetSectorFace(int sectorIdx, int faceType, int faceIdx)
+{
+    auto& object = sectors_[sectorIdx].Object;
+    return faceType == 3 ? object.TriFaces[faceIdx] : object.QuadFaces[faceIdx];
+}
+
 const Vector<PodCircuit::Light>* PodCircuit::GetSectorLights(int idx)
 {
     if (idx < lightSection_.SectorLights.Size())
@@ -647,3 +694,386 @@ const Vector<PodCircuit::Light>* PodCircuit::GetSectorLights(int idx)
 
     return nullptr;
 }
+
+void PodCircuit::BuildSectorChunks(float chunkSize)
+{
+    chunkModelGens_.Clear();
+    chunkSectors_.Clear();
+    sectorChunks_.Clear();
+
+    // Group the sectors by the grid cell containing their bounds center
+    HashMap<IntVector3, unsigned> cellChunks;
+    for (unsigned i = 0; i < sectorBounds_.Size(); i++)
+    {
+        Vector3 center = sectorBounds_[i].Center() / chunkSize;
+        IntVector3 cell(FloorToInt(center.x_), FloorToInt(center.y_), FloorToInt(center.z_));
+
+        auto it = cellChunks.Find(cell);
+        if (it == cellChunks.End())
+        {
+            it = cellChunks.Insert(MakePair(cell, chunkModelGens_.Size()));
+            auto modelGen = new PodModelGen(context_, textureList_);
+            modelGen->SetTextureSet(textureSet_);
+            chunkModelGens_.Push(UniquePtr<PodModelGen>(modelGen));
+            chunkSectors_.Resize(chunkModelGens_.Size());
+        }
+
+        chunkModelGens_[it->second_]->AddObject(sectors_[i].Object);
+        chunkSectors_[it->second_].Push(i);
+        sectorChunks_.Push(it->second_);
+    }
+}
+
+void PodCircuit::GetDrawModelGens(PODVector<PodModelGen*>& dest)
+{
+    dest.Clear();
+    for (auto& modelGen : chunkModelGens_.Empty() ? sectorModelGens_ : chunkModelGens_)
+        dest.Push(modelGen.Get());
+    for (auto& modelGen : decorationModelGens_)
+        dest.Push(modelGen.Get());
+}
+
+PodModelGen& PodCircuit::GetSectorDrawModelGen(int idx)
+{
+    int chunk = GetSectorChunk(idx);
+    return chunk >= 0 ? *chunkModelGens_[chunk] : *sectorModelGens_[idx];
+}
+
+int PodCircuit::FindSector(const Vector3& position, int hint) const
+{
+    if (hint >= 0 && hint < (int)sectorBounds_.Size() && sectorBounds_[hint].IsInside(position) != OUTSIDE)
+        return hint;
+
+    for (unsigned i = 0; i < sectorBounds_.Size(); i++)
+    {
+        if (sectorBounds_[i].IsInside(position) != OUTSIDE)
+            return i;
+    }
+    return -1;
+}
+
+const PodCircuit::Visibility* PodCircuit::GetSectorVisibility(int idx) const
+{
+    if (idx < 0 || idx >= (int)visibility_.Size() || visibility_[idx].Count < 0)
+        return nullptr;
+
+    return &visibility_[idx];
+}
+
+/// Hash the source file data a word at a time to key the caches. Not cryptographic, only detects changed data.
+static unsigned HashData(const PODVector<unsigned char>& data)
+{
+    const unsigned char* bytes = data.Buffer();
+    unsigned size = data.Size();
+    unsigned hash = 2166136261u;
+    unsigned i = 0;
+    for (; i + sizeof(unsigned) <= size; i += sizeof(unsigned))
+    {
+        unsigned word;
+        memcpy(&word, bytes + i, sizeof(unsigned));
+        hash = (hash ^ word) * 16777619u;
+    }
+    for (; i < size; i++)
+        hash = (hash ^ bytes[i]) * 16777619u;
+    return hash;
+}
+
+static void ConvertTextureList(Context* context, const TextureList& list, Vector<SharedPtr<Image>>& images)
+{
+    images.Resize(list.Count);
+    for (unsigned i = 0; i < list.Count; i++)
+        images[i] = CreateImageFromRGB565(context, list.PixelData.Get()[i].Pixels.Get(), list.Width, list.Height);
+}
+
+static void WriteImages(Serializer& dest, const Vector<SharedPtr<Image>>& images)
+{
+    dest.WriteUInt(images.Size());
+    for (const auto& image : images)
+    {
+        dest.WriteInt(image->GetWidth());
+        dest.WriteInt(image->GetHeight());
+        dest.Write(image->GetData(), image->GetWidth() * image->GetHeight() * 4);
+    }
+}
+
+static bool ReadImages(Context* context, Deserializer& source, Vector<SharedPtr<Image>>& images)
+{
+    images.Resize(source.ReadUInt());
+    for (auto& image : images)
+    {
+        int width = source.ReadInt();
+        int height = source.ReadInt();
+        image = new Image(context);
+        if (!image->SetSize(width, height, 4))
+            return false;
+
+        unsigned size = width * height * 4;
+        if (source.Read(image->GetData(), size) != size)
+            return false;
+    }
+    return true;
+}
+
+bool PodCircuit::LoadCached(const String& cacheFileName)
+{
+    return ReadFile() && LoadReadDataCached(cacheFileName);
+}
+
+bool PodCircuit::LoadCached(Deserializer& source, const String& cacheFileName)
+{
+    return ReadFile(source) && LoadReadDataCached(cacheFileName);
+}
+
+bool PodCircuit::LoadReadDataCached(const String& cacheFileName)
+{
+    // The collision cache is keyed on the same source data
+    sourceSize_ = data_.Size();
+    sourceHash_ = HashData(data_);
+
+    bool parsed = false;
+    if (context_->GetSubsystem<FileSystem>()->FileExists(cacheFileName))
+    {
+        File cache(context_, cacheFileName, FILE_READ);
+        if (cache.IsOpen() && cache.ReadFileID() == CACHE_FILE_ID && cache.ReadUInt() == CACHE_VERSION &&
+            cache.ReadUInt() == sourceSize_ && cache.ReadUInt() == sourceHash_)
+        {
+            // A truncated or corrupt body falls back to the source data and rewrites the cache
+            unsigned key = cache.ReadUInt();
+            unsigned blockSize = cache.ReadUInt();
+            unsigned dataSize = cache.ReadUInt();
+            unsigned dataHash = cache.ReadUInt();
+            PODVector<unsigned char> data;
+            if (dataSize <= cache.GetSize() - cache.GetPosition())
+            {
+                data.Resize(dataSize);
+                if (cache.Read(data.Buffer(), dataSize) != dataSize || HashData(data) != dataHash)
+                    data.Clear();
+            }
+
+            if (!data.Empty())
+            {
+                key_ = key;
+                blockSize_ = blockSize;
+                data_.Swap(data);
+                if (!LoadDecryptedData())
+                    return false;
+                if (ReadCache(cache))
+                    return true;
+
+                // The parsed data is still valid, the models are generated from the faces
+                URHO3D_LOGWARNING("Rebuilding invalid baked data for circuit " + GetFileName());
+                parsed = true;
+            }
+        }
+    }
+
+    if (!parsed)
+    {
+        DecryptData();
+        if (!LoadDecryptedData())
+            return false;
+    }
+
+    if (deferCacheWrite_)
+        pendingCacheFileName_ = cacheFileName;
+    else
+        WriteCache(cacheFileName);
+    return true;
+}
+
+void PodCircuit::WritePendingCache()
+{
+    if (pendingCacheFileName_.Empty())
+        return;
+
+    WriteCache(pendingCacheFileName_);
+    pendingCacheFileName_.Clear();
+}
+
+bool PodCircuit::ReadCache(Deserializer& cache)
+{
+    bool success = ReadImages(context_, cache, textureImages_);
+
+    decorationImages_.Resize(success ? cache.ReadUInt() : 0);
+    success &= decorationImages_.Size() == decorationModelGens_.Size();
+    for (unsigned i = 0; success && i < decorationImages_.Size(); i++)
+        success = ReadImages(context_, cache, decorationImages_[i]);
+
+    success = success && cache.ReadUInt() == sectorModelGens_.Size();
+    for (unsigned i = 0; success && i < sectorModelGens_.Size(); i++)
+        success = sectorModelGens_[i]->Load(cache);
+
+    success = success && cache.ReadUInt() == decorationModelGens_.Size();
+    for (unsigned i = 0; success && i < decorationModelGens_.Size(); i++)
+        success = decorationModelGens_[i]->Load(cache);
+
+    if (!success)
+    {
+        textureImages_.Clear();
+        decorationImages_.Clear();
+        return false;
+    }
+
+    textureSet_->SetImages(&textureImages_);
+    for (unsigned i = 0; i < decorationTextureSets_.Size(); i++)
+        decorationTextureSets_[i]->SetImages(&decorationImages_[i]);
+
+    return true;
+}
+
+void PodCircuit::WriteCache(const String& cacheFileName)
+{
+    // Convert the textures once unless the generation tasks did, the texture sets create the textures from the
+    // converted images
+    if (textureImages_.Empty())
+    {
+        PrepareTextureImages();
+        for (unsigned i = 0; i <= decorationImages_.Size(); i++)
+            ConvertTextures(i);
+    }
+
+    File cache(context_, cacheFileName, FILE_WRITE);
+    if (!cache.IsOpen())
+    {
+        URHO3D_LOGWARNING("Could not write baked circuit " + cacheFileName);
+        return;
+    }
+
+    cache.WriteFileID(CACHE_FILE_ID);
+    cache.WriteUInt(CACHE_VERSION);
+    cache.WriteUInt(sourceSize_);
+    cache.WriteUInt(sourceHash_);
+    cache.WriteUInt(key_);
+    cache.WriteUInt(blockSize_);
+    cache.WriteUInt(data_.Size());
+    cache.WriteUInt(HashData(data_));
+    cache.Write(data_.Buffer(), data_.Size());
+
+    WriteImages(cache, textureImages_);
+    cache.WriteUInt(decorationImages_.Size());
+    for (const auto& images : decorationImages_)
+        WriteImages(cache, images);
+
+    cache.WriteUInt(sectorModelGens_.Size());
+    for (auto& modelGen : sectorModelGens_)
+        modelGen->Save(cache);
+
+    cache.WriteUInt(decorationModelGens_.Size());
+    for (auto& modelGen : decorationModelGens_)
+        modelGen->Save(cache);
+}
+
+void PodCircuit::PrepareTextureImages()
+{
+    textureSet_->SetImages(&textureImages_);
+    decorationImages_.Resize(envSection_.Decorations.Size());
+    for (unsigned i = 0; i < decorationImages_.Size(); i++)
+        decorationTextureSets_[i]->SetImages(&decorationImages_[i]);
+}
+
+void PodCircuit::ConvertTextures(unsigned index)
+{
+    if (index == 0)
+        ConvertTextureList(context_, textureList_, textureImages_);
+    else
+        ConvertTextureList(context_, envSection_.Decorations[index - 1].Textures, decorationImages_[index - 1]);
+}
+
+void PodCircuit::PrepareGenerateTasks()
+{
+    // The cache provides converted textures. Native RGB565 textures are uploaded unconverted, unless a cache is
+    // written.
+    bool writeCache = !pendingCacheFileName_.Empty();
+    numTextureTasks_ = 0;
+    if (textureImages_.Empty() && (!nativeRGB565_ || writeCache))
+    {
+        PrepareTextureImages();
+        numTextureTasks_ = 1 + decorationImages_.Size();
+    }
+
+    // The cache holds the sector geometry, also generate it when the chunks are drawn instead
+    GetDrawModelGens(generateModelGens_);
+    if (writeCache && !chunkModelGens_.Empty())
+    {
+        for (auto& modelGen : sectorModelGens_)
+            generateModelGens_.Push(modelGen.Get());
+    }
+}
+
+void PodCircuit::RunGenerateTask(unsigned index)
+{
+    if (index < numTextureTasks_)
+        ConvertTextures(index);
+    else
+        generateModelGens_[index - numTextureTasks_]->GenerateGeometry();
+}
+
+static void GenerateTaskWork(const WorkItem* item, unsigned threadIndex)
+{
+    auto* circuit = reinterpret_cast<PodCircuit*>(item->aux_);
+    circuit->RunGenerateTask(*reinterpret_cast<unsigned*>(item->start_));
+}
+
+void PodCircuit::RunGenerateTasks()
+{
+    AutoProfileBlock profileBlock(context_->GetSubsystem<Profiler>(), "GenerateCircuit");
+
+    // Work items can only be queued from the main thread
+    auto* queue = context_->GetSubsystem<WorkQueue>();
+    unsigned numTasks = GetNumGenerateTasks();
+    if (!queue || !queue->GetNumThreads() || !Thread::IsMainThread())
+    {
+        for (unsigned i = 0; i < numTasks; i++)
+            RunGenerateTask(i);
+        return;
+    }
+
+    PODVector<unsigned> tasks(numTasks);
+    for (unsigned i = 0; i < numTasks; i++)
+    {
+        tasks[i] = i;
+        SharedPtr<WorkItem> item = queue->GetFreeItem();
+        item->priority_ = M_MAX_UNSIGNED;
+        item->workFunction_ = GenerateTaskWork;
+        item->aux_ = this;
+        item->start_ = &tasks[i];
+        queue->AddWorkItem(item);
+    }
+    queue->Complete(M_MAX_UNSIGNED);
+}
+
+void PodCircuit::LoadCollision(const String& cacheFileName)
+{
+    // The source data key computed by LoadCached identifies the circuit, without it the cache can not be checked
+    bool useCache = !cacheFileName.Empty() && sourceSize_;
+
+    if (useCache && context_->GetSubsystem<FileSystem>()->FileExists(cacheFileName))
+    {
+        File cache(context_, cacheFileName, FILE_READ);
+        if (cache.IsOpen() && cache.ReadFileID() == COLLISION_CACHE_FILE_ID &&
+            cache.ReadUInt() == COLLISION_CACHE_VERSION && cache.ReadUInt() == sourceSize_ &&
+            cache.ReadUInt() == sourceHash_ && collision_.Load(cache, sectors_.Size()))
+            return;
+    }
+
+    PODVector<const ObjectData*> sectorObjects;
+    for (const auto& sector : sectors_)
+        sectorObjects.Push(&sector.Object);
+    collision_.Build(sectorObjects);
+
+    if (!useCache)
+        return;
+
+    File cache(context_, cacheFileName, FILE_WRITE);
+    if (!cache.IsOpen())
+    {
+        URHO3D_LOGWARNING("Could not write circuit collision " + cacheFileName);
+        return;
+    }
+
+    cache.WriteFileID(COLLISION_CACHE_FILE_ID);
+    cache.WriteUInt(COLLISION_CACHE_VERSION);
+    cache.WriteUInt(sourceSize_);
+    cache.WriteUInt(sourceHash_);
+    collision_.Save(cache);
+}
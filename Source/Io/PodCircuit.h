@@ -5,9 +5,16 @@
 #include "Application.h"
 #include "PodCommon.h"
 #include "PodModelGen.h"
+#include "PodCircuitCollision.h"
 
 namespace Urho3D { class Model; class Texture2D; class Material; }
 
+/// Extension appended to the circuit file name for its baked cache.
+static const char* const CIRCUIT_CACHE_EXTENSION = ".bake";
+
+/// Extension appended to the circuit file name for its collision cache.
+static const char* const COLLISION_CACHE_EXTENSION = ".col";
+
 class PodCircuit : public PodBdfFile
 {
 public:
@@ -470,6 +477,32 @@ public:
 
     bool LoadData() override;
 
+    /// Load the circuit through a baked cache file holding the decrypted data, the generated geometry and the
+    /// converted textures. The cache is written on the first load and rebuilt when the source file changes.
+    bool LoadCached(const String& cacheFileName);
+    /// Load through a baked cache file from already opened circuit file data. Can be called from a worker thread.
+    bool LoadCached(Deserializer& source, const String& cacheFileName);
+
+    /// Set whether to upload the textures in the native RGB565 format when supported. Set before loading.
+    void SetNativeRGB565Textures(bool enable) { nativeRGB565_ = enable; }
+    /// Set whether LoadCached leaves a missing or outdated cache to WritePendingCache instead of writing it, so that
+    /// its textures and geometry come from the generation tasks. Set before loading.
+    void SetDeferCacheWrite(bool enable) { deferCacheWrite_ = enable; }
+    /// Write the cache left by a deferred LoadCached, if any. Can be called from a worker thread.
+    void WritePendingCache();
+
+    /// Prepare the generation tasks of the loaded circuit: the texture lists to convert, then the drawn model
+    /// generators in GetDrawModelGens order. Call after loading and building the sector chunks.
+    void PrepareGenerateTasks();
+    /// Return the number of generation tasks.
+    unsigned GetNumGenerateTasks() const { return numTextureTasks_ + generateModelGens_.Size(); }
+    /// Return the number of texture conversion tasks, which come before the model generator tasks.
+    unsigned GetNumTextureTasks() const { return numTextureTasks_; }
+    /// Run a generation task. The tasks write separate data, so they can run on different threads at the same time.
+    void RunGenerateTask(unsigned index);
+    /// Run all the generation tasks, as work items on the worker threads when called from the main thread.
+    void RunGenerateTasks();
+
     const String& GetProjectName() { return projectName_; }
 
     const Vector<Sector>& GetSectors() { return sectors_; }
@@ -482,6 +515,49 @@ public:
 
     PodModelGen& GetSectorModelGen(int idx) { return *sectorModelGens_[idx]; }
 
+    /// Return a sector face from its type (3 or 4 vertices) and index in the triangle or quad list.
+    FaceData* GetSectorFace(int sectorIdx, int faceType, int faceIdx);
+
+    /// Merge the sector geometry by material into chunks of neighbouring sectors, grouped on a grid of the given
+    /// cell size. The chunks use 32-bit indices when their vertex count requires it.
+    void BuildSectorChunks(float chunkSize);
+
+    unsigned GetNumSectorChunks() const { return chunkModelGens_.Size(); }
+
+    /// Return the chunk containing a sector, or -1 if the chunks are not built.
+    int GetSectorChunk(int idx) const { return idx < (int)sectorChunks_.Size() ? sectorChunks_[idx] : -1; }
+
+    const PODVector<unsigned>& GetChunkSectors(int idx) const { return chunkSectors_[idx]; }
+
+    SharedPtr<Model> GetChunkModel(int idx) { return chunkModelGens_[idx]->GetModel(); }
+
+    const Vector<SharedPtr<Material>>& GetChunkMaterials(int idx) { return chunkModelGens_[idx]->GetMaterials(); }
+
+    PodModelGen& GetChunkModelGen(int idx) { return *chunkModelGens_[idx]; }
+
+    /// Return the model generators drawn by the circuit: the sector chunks when built, else the sectors, then the
+    /// decorations.
+    void GetDrawModelGens(PODVector<PodModelGen*>& dest);
+
+    /// Return the model generator drawing the faces of a sector: its chunk when built, else the sector own.
+    PodModelGen& GetSectorDrawModelGen(int idx);
+
+    /// Build the sector collision meshes and their BVHs, through a collision cache file when its name is not empty.
+    /// The cache is keyed on the source data hashed by LoadCached and is not used after Load. Call after loading, can be
+    /// called from a worker thread.
+    void LoadCollision(const String& cacheFileName);
+
+    /// Return the sector collision meshes, empty until LoadCollision.
+    PodCircuitCollision& GetCollision() { return collision_; }
+
+    const BoundingBox& GetSectorBounds(int idx) const { return sectorBounds_[idx]; }
+
+    /// Return the index of the sector whose bounds contain the position, or -1. The hint sector is tested first.
+    int FindSector(const Vector3& position, int hint = -1) const;
+
+    /// Return the precomputed list of sectors visible from a sector, or null if the circuit has none for it.
+    const Visibility* GetSectorVisibility(int idx) const;
+
     const Vector<Light>* GetSectorLights(int idx);
 
     const Vector<Decoration>& GetDecorations() { return envSection_.Decorations; }
@@ -536,4 +612,38 @@ public:
     // runtime stuff
     Vector<UniquePtr<PodModelGen>> sectorModelGens_;
     Vector<UniquePtr<PodModelGen>> decorationModelGens_;
+    PODVector<BoundingBox> sectorBounds_;
+    PodCircuitCollision collision_;
+    Vector<UniquePtr<PodModelGen>> chunkModelGens_;
+    Vector<PODVector<unsigned>> chunkSectors_;
+    PODVector<int> sectorChunks_;
+    SharedPtr<PodTextureSet> textureSet_;
+    Vector<SharedPtr<PodTextureSet>> decorationTextureSets_;
+    Vector<SharedPtr<Image>> textureImages_;
+    Vector<Vector<SharedPtr<Image>>> decorationImages_;
+    bool nativeRGB565_ = false;
+
+private:
+    /// Size the converted image lists and point the texture sets to them.
+    void PrepareTextureImages();
+    /// Convert a texture list to images: the circuit list for index 0, else a decoration list.
+    void ConvertTextures(unsigned index);
+    /// Load the encrypted data read from the circuit file, through the baked cache.
+    bool LoadReadDataCached(const String& cacheFileName);
+    /// Read the images and geometry of a baked cache, after its decrypted data was loaded. Return false if they are
+    /// invalid, the models are then generated from the faces.
+    bool ReadCache(Deserializer& cache);
+    /// Write a baked cache for the loaded circuit.
+    void WriteCache(const String& cacheFileName);
+
+    /// Model generators of the generation tasks.
+    PODVector<PodModelGen*> generateModelGens_;
+    /// Number of texture lists to convert in the generation tasks.
+    unsigned numTextureTasks_ = 0;
+    /// Cache left to WritePendingCache, empty if none.
+    String pendingCacheFileName_;
+    /// Size and hash of the encrypted source data keying the caches, set by LoadCached.
+    unsigned sourceSize_ = 0;
+    unsigned sourceHash_ = 0;
+    bool deferCacheWrite_ = false;
 };
\ No newline at end of file
@@ -0,0 +1,298 @@
+#include <stdexcept>
+#include <Urho3D/IO/Deserializer.h>
+#include <Urho3D/IO/Serializer.h>
+#include <Urho3D/Physics/PhysicsUtils.h>
+#include <Bullet/BulletCollision/CollisionShapes/btBvhTriangleMeshShape.h>
+#include <Bullet/BulletCollision/CollisionShapes/btOptimizedBvh.h>
+#include <Bullet/BulletCollision/CollisionShapes/btTriangleIndexVertexArray.h>
+#include "PodCircuitCollision.h"
+#include "PodCommon.h"
+
+/// Alignment of the serialized BVH buffer required by Bullet.
+static constexpr unsigned BVH_ALIGNMENT = 16;
+
+/// Largest sector vertex count indexed with 16-bit collision indices, larger sectors use 32-bit indices.
+static constexpr unsigned MAX_SHORT_INDEXED_VERTICES = 65536;
+
+/// Material IDs are stored as bytes.
+static constexpr unsigned MAX_MATERIALS = 256;
+
+/// Face properties affecting the collision material: road, wall, dural and slipperiness bits.
+static constexpr unsigned COLLISION_PROPERTIES_MASK = 0x00ff2028;
+
+PodSectorCollision::PodSectorCollision()
+    : indexSize_(sizeof(unsigned short))
+    , bvh_(nullptr)
+    , bvhData_(nullptr)
+{
+}
+
+PodSectorCollision::~PodSectorCollision()
+{
+    Release();
+}
+
+void PodSectorCollision::SetVertices(const ObjectData& obj)
+{
+    vertices_ = obj.Positions;
+    indexSize_ = vertices_.Size() > MAX_SHORT_INDEXED_VERTICES ? sizeof(unsigned) : sizeof(unsigned short);
+}
+
+void PodSectorCollision::PushIndex(unsigned index)
+{
+    unsigned offset = indexData_.Size();
+    indexData_.Resize(offset + indexSize_);
+    if (indexSize_ == sizeof(unsigned short))
+    {
+        auto shortIndex = (unsigned short)index;
+        memcpy(&indexData_[offset], &shortIndex, sizeof(shortIndex));
+    }
+    else
+        memcpy(&indexData_[offset], &index, sizeof(index));
+}
+
+unsigned PodSectorCollision::GetIndex(unsigned i) const
+{
+    if (indexSize_ == sizeof(unsigned short))
+    {
+        unsigned short index;
+        memcpy(&index, &indexData_[i * sizeof(index)], sizeof(index));
+        return index;
+    }
+
+    unsigned index;
+    memcpy(&index, &indexData_[i * sizeof(index)], sizeof(index));
+    return index;
+}
+
+void PodSectorCollision::AddFace(const FaceData& face, uint8_t materialID)
+{
+    // Triangulate quads as a fan, like the rendered geometry
+    for (unsigned j = 1; j + 1 < face.Vertices; j++)
+    {
+        unsigned idx[3] = { face.Indices[0], face.Indices[j], face.Indices[j + 1] };
+        for (unsigned index : idx)
+        {
+            PushIndex(index);
+            bounds_.Merge(vertices_[index]);
+        }
+        materialIDs_.Push(materialID);
+    }
+}
+
+void PodSectorCollision::Build()
+{
+    Release();
+    if (materialIDs_.Empty())
+        return;
+
+    CreateMeshInterface();
+    shape_ = new btBvhTriangleMeshShape(meshInterface_.Get(), true, ToBtVector3(bounds_.min_),
+        ToBtVector3(bounds_.max_), true);
+}
+
+void PodSectorCollision::CreateMeshInterface()
+{
+    btIndexedMesh mesh;
+    mesh.m_numTriangles = materialIDs_.Size();
+    mesh.m_triangleIndexBase = indexData_.Buffer();
+    mesh.m_triangleIndexStride = 3 * indexSize_;
+    mesh.m_numVertices = vertices_.Size();
+    mesh.m_vertexBase = reinterpret_cast<const unsigned char*>(vertices_.Buffer());
+    mesh.m_vertexStride = sizeof(Vector3);
+
+    meshInterface_ = new btTriangleIndexVertexArray();
+    meshInterface_->addIndexedMesh(mesh, indexSize_ == sizeof(unsigned short) ? PHY_SHORT : PHY_INTEGER);
+}
+
+void PodSectorCollision::Release()
+{
+    shape_.Reset();
+    if (bvh_)
+    {
+        // Deserialized in place, the node arrays point into bvhData_
+        bvh_->~btOptimizedBvh();
+        bvh_ = nullptr;
+    }
+    if (bvhData_)
+    {
+        btAlignedFree(bvhData_);
+        bvhData_ = nullptr;
+    }
+    meshInterface_.Reset();
+}
+
+void PodSectorCollision::Save(Serializer& dest) const
+{
+    dest.WriteUInt(vertices_.Size());
+    dest.Write(vertices_.Buffer(), vertices_.Size() * sizeof(Vector3));
+    dest.WriteUInt(indexSize_);
+    dest.WriteUInt(indexData_.Size());
+    dest.Write(indexData_.Buffer(), indexData_.Size());
+    dest.WriteUInt(materialIDs_.Size());
+    dest.Write(materialIDs_.Buffer(), materialIDs_.Size());
+    dest.WriteBoundingBox(bounds_);
+
+    btOptimizedBvh* bvh = shape_ ? shape_->getOptimizedBvh() : nullptr;
+    unsigned size = bvh ? bvh->calculateSerializeBufferSize() : 0;
+    dest.WriteUInt(size);
+    if (size)
+    {
+        void* buffer = btAlignedAlloc(size, BVH_ALIGNMENT);
+        bvh->serializeInPlace(buffer, size, false);
+        dest.Write(buffer, size);
+        btAlignedFree(buffer);
+    }
+}
+
+/// Read an array count, failing when the array would not fit in the rest of the source.
+static bool ReadCount(Deserializer& source, unsigned elementSize, unsigned& count)
+{
+    count = source.ReadUInt();
+    return count <= (source.GetSize() - source.GetPosition()) / elementSize;
+}
+
+bool PodSectorCollision::Load(Deserializer& source, unsigned numMaterials)
+{
+    Clear();
+
+    // Truncated or stale caches must not size the arrays, nor index out of them
+    unsigned count = 0;
+    bool success = ReadCount(source, sizeof(Vector3), count);
+    vertices_.Resize(success ? count : 0);
+    unsigned size = vertices_.Size() * sizeof(Vector3);
+    success = success && source.Read(vertices_.Buffer(), size) == size;
+
+    indexSize_ = success ? source.ReadUInt() : 0;
+    success = (indexSize_ == sizeof(unsigned short) || indexSize_ == sizeof(unsigned)) && ReadCount(source, 1, count);
+    indexData_.Resize(success ? count : 0);
+    success = success && source.Read(indexData_.Buffer(), count) == count;
+
+    success = success && ReadCount(source, 1, count);
+    materialIDs_.Resize(success ? count : 0);
+    success = success && source.Read(materialIDs_.Buffer(), count) == count;
+    bounds_ = success ? source.ReadBoundingBox() : BoundingBox();
+    success &= indexData_.Size() == materialIDs_.Size() * 3 * indexSize_;
+
+    for (unsigned i = 0; success && i < materialIDs_.Size() * 3; i++)
+        success = GetIndex(i) < vertices_.Size();
+    for (unsigned i = 0; success && i < materialIDs_.Size(); i++)
+        success = materialIDs_[i] < numMaterials;
+
+    // A sector without triangles has no BVH
+    success = success && ReadCount(source, 1, size);
+    success &= (size != 0) == !materialIDs_.Empty();
+    if (success && size)
+    {
+        bvhData_ = btAlignedAlloc(size, BVH_ALIGNMENT);
+        success = source.Read(bvhData_, size) == size;
+        if (success)
+            bvh_ = btOptimizedBvh::deSerializeInPlace(bvhData_, size, false);
+        success = bvh_ != nullptr;
+    }
+
+    if (!success)
+    {
+        Clear();
+        return false;
+    }
+
+    if (bvh_)
+    {
+        CreateMeshInterface();
+        shape_ = new btBvhTriangleMeshShape(meshInterface_.Get(), true, ToBtVector3(bounds_.min_),
+            ToBtVector3(bounds_.max_), false);
+        shape_->setOptimizedBvh(bvh_);
+    }
+    return true;
+}
+
+void PodSectorCollision::Clear()
+{
+    Release();
+    vertices_.Clear();
+    indexData_.Clear();
+    materialIDs_.Clear();
+}
+
+uint8_t PodCircuitCollision::GetMaterialID(const FaceData& face)
+{
+    unsigned properties = face.FaceProperties & COLLISION_PROPERTIES_MASK;
+    auto it = materialIDs_.Find(properties);
+    if (it != materialIDs_.End())
+        return it->second_;
+
+    if (materials_.Size() >= MAX_MATERIALS)
+        throw std::runtime_error("Too many circuit collision materials");
+
+    PodCollisionMaterial material;
+    material.Road = face.IsRoad();
+    material.Wall = face.IsWall();
+    material.Dural = face.IsDural();
+    material.Slipperiness = face.GetSlipperiness();
+
+    uint8_t id = materials_.Size();
+    materials_.Push(material);
+    materialIDs_[properties] = id;
+    return id;
+}
+
+void PodCircuitCollision::Build(const PODVector<const ObjectData*>& sectorObjects)
+{
+    sectors_.Clear();
+    materials_.Clear();
+    materialIDs_.Clear();
+
+    for (const ObjectData* obj : sectorObjects)
+    {
+        auto sector = new PodSectorCollision();
+        sectors_.Push(UniquePtr<PodSectorCollision>(sector));
+        sector->SetVertices(*obj);
+        for (unsigned i = 0; i < obj->FaceCount; i++)
+        {
+            const FaceData& face = obj->FaceData.Get()[i];
+            if (face.IsVisible() || face.IsRoad() || face.IsWall())
+                sector->AddFace(face, GetMaterialID(face));
+        }
+        sector->Build();
+    }
+
+    materialIDs_.Clear();
+}
+
+void PodCircuitCollision::Save(Serializer& dest) const
+{
+    dest.WriteUInt(materials_.Size());
+    dest.Write(materials_.Buffer(), materials_.Size() * sizeof(PodCollisionMaterial));
+
+    dest.WriteUInt(sectors_.Size());
+    for (const auto& sector : sectors_)
+        sector->Save(dest);
+}
+
+bool PodCircuitCollision::Load(Deserializer& source, unsigned numSectors)
+{
+    sectors_.Clear();
+    materials_.Clear();
+    unsigned numMaterials = source.ReadUInt();
+    if (numMaterials > MAX_MATERIALS)
+        return false;
+    materials_.Resize(numMaterials);
+    unsigned size = materials_.Size() * sizeof(PodCollisionMaterial);
+    bool success = source.Read(materials_.Buffer(), size) == size;
+
+    success = success && source.ReadUInt() == numSectors;
+    for (unsigned i = 0; success && i < numSectors; i++)
+    {
+        auto sector = new PodSectorCollision();
+        sectors_.Push(UniquePtr<PodSectorCollision>(sector));
+        success = sector->Load(source, materials_.Size());
+    }
+
+    if (!success)
+    {
+        sectors_.Clear();
+        materials_.Clear();
+    }
+    return success;
+}
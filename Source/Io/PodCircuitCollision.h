@@ -0,0 +1,120 @@
+#pragma once
+
+#include <Urho3D/Container/Ptr.h>
+#include <Urho3D/Container/HashMap.h>
+#include <Urho3D/Math/BoundingBox.h>
+#include "Utils.h"
+
+using namespace Urho3D;
+
+namespace Urho3D { class Serializer; class Deserializer; }
+
+class btBvhTriangleMeshShape;
+class btOptimizedBvh;
+class btTriangleIndexVertexArray;
+
+struct ObjectData;
+struct FaceData;
+
+/// Surface of a collision triangle, from the road/wall face properties.
+struct PodCollisionMaterial
+{
+    bool Road;
+    bool Wall;
+    bool Dural;
+    uint8_t Slipperiness;
+};
+
+/// Collision mesh of a circuit sector: indexed triangles, 16-bit unless the sector has more vertices, one material ID
+/// per triangle and a quantized (compressed) Bullet BVH, which is either built or read back from a collision cache.
+class PodSectorCollision
+{
+public:
+    PodSectorCollision();
+    ~PodSectorCollision();
+
+    /// Prevent copy construction.
+    PodSectorCollision(const PodSectorCollision&) = delete;
+    /// Prevent assignment.
+    PodSectorCollision& operator=(const PodSectorCollision&) = delete;
+
+    /// Set the vertices from the sector object, indexed by its faces.
+    void SetVertices(const ObjectData& obj);
+    /// Add the triangles of a face, with the material ID of the face.
+    void AddFace(const FaceData& face, uint8_t materialID);
+
+    /// Build the BVH of the added triangles. Can be called from a worker thread.
+    void Build();
+
+    /// Write the triangles, material IDs and the serialized BVH.
+    void Save(Serializer& dest) const;
+    /// Read data written by Save, without rebuilding the BVH. Return false if it is invalid, including indices out of
+    /// the vertices and material IDs not below the material count.
+    bool Load(Deserializer& source, unsigned numMaterials);
+
+    /// Return the Bullet shape shared by the sector collision shapes, or null if the sector has no triangles.
+    btBvhTriangleMeshShape* GetShape() const { return shape_.Get(); }
+    /// Return the number of triangles.
+    unsigned GetNumTriangles() const { return materialIDs_.Size(); }
+    /// Return the material ID of a triangle, the Bullet triangle index of a contact or raycast.
+    uint8_t GetTriangleMaterialID(unsigned triangleIndex) const { return materialIDs_[triangleIndex]; }
+    /// Return the bounds of the triangles.
+    const BoundingBox& GetBounds() const { return bounds_; }
+
+private:
+    /// Create the mesh interface over the triangle arrays.
+    void CreateMeshInterface();
+    /// Release the shape, BVH and mesh interface.
+    void Release();
+    /// Release everything and clear the triangles.
+    void Clear();
+    /// Append a triangle index in the index size of the sector.
+    void PushIndex(unsigned index);
+    /// Return a triangle index.
+    unsigned GetIndex(unsigned i) const;
+
+    PODVector<Vector3> vertices_;
+    /// Triangle indices, indexSize_ bytes each.
+    PODVector<unsigned char> indexData_;
+    /// Size of an index, 2 bytes unless the sector has more vertices than 16-bit indices address.
+    unsigned indexSize_;
+    /// Material ID by triangle.
+    PODVector<uint8_t> materialIDs_;
+    BoundingBox bounds_;
+    UniquePtr<btTriangleIndexVertexArray> meshInterface_;
+    UniquePtr<btBvhTriangleMeshShape> shape_;
+    /// BVH deserialized in place from bvhData_, not owned by the shape.
+    btOptimizedBvh* bvh_;
+    /// 16-byte aligned buffer holding the deserialized BVH.
+    void* bvhData_;
+};
+
+/// Collision of a whole circuit: the sector collision meshes and the materials shared by their triangles.
+class PodCircuitCollision
+{
+public:
+    /// Build the sector collision meshes from the colliding faces of the sector objects, the visible, road and wall
+    /// faces. Can be called from a worker thread.
+    void Build(const PODVector<const ObjectData*>& sectorObjects);
+
+    /// Write the materials and sector meshes.
+    void Save(Serializer& dest) const;
+    /// Read data written by Save. Return false if it is invalid or does not match the sector count.
+    bool Load(Deserializer& source, unsigned numSectors);
+
+    /// Return the number of sectors.
+    unsigned GetNumSectors() const { return sectors_.Size(); }
+    /// Return the collision mesh of a sector.
+    PodSectorCollision& GetSector(int idx) { return *sectors_[idx]; }
+    /// Return a material from its ID.
+    const PodCollisionMaterial& GetMaterial(uint8_t id) const { return materials_[id]; }
+
+private:
+    /// Return the material ID of a face, adding its material when new.
+    uint8_t GetMaterialID(const FaceData& face);
+
+    Vector<UniquePtr<PodSectorCollision>> sectors_;
+    PODVector<PodCollisionMaterial> materials_;
+    /// Material IDs by masked face properties, while building.
+    HashMap<unsigned, uint8_t> materialIDs_;
+};
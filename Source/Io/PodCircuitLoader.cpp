@@ -0,0 +1,236 @@
+#include <stdexcept>
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/Core/WorkQueue.h>
+#include <Urho3D/IO/Log.h>
+#include "PodCircuitLoader.h"
+
+PodCircuitLoader::PodCircuitLoader(Context* context, const String& fileName) :
+    Object(context),
+    fileName_(fileName),
+    numModelGens_(0),
+    parsed_(false),
+    failed_(false),
+    numUploaded_(0),
+    tasksQueued_(false),
+    chunkSize_(0.0f),
+    useCache_(true),
+    nativeRGB565_(false),
+    loaded_(false)
+{
+}
+
+/// Remove a work item from the queue, or wait for it to complete if a worker thread is already running it.
+static void CancelWorkItem(WorkQueue* queue, const SharedPtr<WorkItem>& item)
+{
+    if (!item || item->completed_ || queue->RemoveWorkItem(item))
+        return;
+
+    while (!item->completed_)
+        Time::Sleep(0);
+}
+
+PodCircuitLoader::~PodCircuitLoader()
+{
+    // The items point to the loader, none may be left running once it is freed
+    auto* queue = GetSubsystem<WorkQueue>();
+    CancelWorkItem(queue, item_);
+    for (const SharedPtr<WorkItem>& item : taskItems_)
+        CancelWorkItem(queue, item);
+    CancelWorkItem(queue, cacheItem_);
+}
+
+void PodCircuitLoader::Start()
+{
+    circuit_ = new PodCircuit(context_, fileName_);
+    circuit_->SetNativeRGB565Textures(nativeRGB565_);
+    circuit_->SetDeferCacheWrite(true);
+
+    // The completion of the items is polled after the queue may have purged them, so they are not pooled
+    auto* queue = GetSubsystem<WorkQueue>();
+    item_ = new WorkItem();
+    item_->priority_ = 0;
+    item_->workFunction_ = LoadWork;
+    item_->aux_ = this;
+    queue->AddWorkItem(item_);
+}
+
+void PodCircuitLoader::LoadWork(const WorkItem* item, unsigned threadIndex)
+{
+    auto* loader = reinterpret_cast<PodCircuitLoader*>(item->aux_);
+    PodCircuit* circuit = loader->circuit_.Get();
+
+    try
+    {
+        bool loaded = loader->useCache_ ? circuit->LoadCached(loader->fileName_ + CIRCUIT_CACHE_EXTENSION) :
+            circuit->Load();
+        if (!loaded)
+        {
+            loader->failed_ = true;
+            return;
+        }
+    }
+    catch (const std::exception& e)
+    {
+        URHO3D_LOGERROR("Could not load circuit " + loader->fileName_ + ": " + e.what());
+        loader->failed_ = true;
+        return;
+    }
+
+    if (loader->chunkSize_ > 0.0f)
+        circuit->BuildSectorChunks(loader->chunkSize_);
+    circuit->PrepareGenerateTasks();
+    circuit->GetDrawModelGens(loader->modelGens_);
+    loader->numModelGens_ = loader->modelGens_.Size();
+    loader->parsed_ = true;
+
+    // The generation tasks run on the other worker threads meanwhile
+    try
+    {
+        circuit->LoadCollision(loader->useCache_ ? loader->fileName_ + COLLISION_CACHE_EXTENSION : String::EMPTY);
+    }
+    catch (const std::exception& e)
+    {
+        // The circuit is still drawn, without collision
+        URHO3D_LOGERROR("Could not build collision for circuit " + loader->fileName_ + ": " + e.what());
+    }
+}
+
+void PodCircuitLoader::GenerateWork(const WorkItem* item, unsigned threadIndex)
+{
+    auto* loader = reinterpret_cast<PodCircuitLoader*>(item->aux_);
+    loader->circuit_->RunGenerateTask(*reinterpret_cast<unsigned*>(item->start_));
+}
+
+void PodCircuitLoader::WriteCacheWork(const WorkItem* item, unsigned threadIndex)
+{
+    auto* loader = reinterpret_cast<PodCircuitLoader*>(item->aux_);
+    loader->circuit_->WritePendingCache();
+}
+
+void PodCircuitLoader::QueueGenerateTasks()
+{
+    // Decreasing priorities run the tasks in order: the textures first, then the model generators in upload order
+    auto* queue = GetSubsystem<WorkQueue>();
+    unsigned numTasks = circuit_->GetNumGenerateTasks();
+    tasks_.Resize(numTasks);
+    for (unsigned i = 0; i < numTasks; i++)
+    {
+        tasks_[i] = i;
+        SharedPtr<WorkItem> item(new WorkItem());
+        item->priority_ = numTasks - i;
+        item->workFunction_ = GenerateWork;
+        item->aux_ = this;
+        item->start_ = &tasks_[i];
+        queue->AddWorkItem(item);
+        taskItems_.Push(item);
+    }
+    tasksQueued_ = true;
+}
+
+unsigned PodCircuitLoader::GetNumCompletedTasks(unsigned begin, unsigned end) const
+{
+    unsigned numCompleted = 0;
+    for (unsigned i = begin; i < end; i++)
+    {
+        if (taskItems_[i]->completed_)
+            numCompleted++;
+    }
+    return numCompleted;
+}
+
+bool PodCircuitLoader::IsWorking() const
+{
+    if ((item_ && !item_->completed_) || (cacheItem_ && !cacheItem_->completed_))
+        return true;
+    return GetNumCompletedTasks(0, taskItems_.Size()) < taskItems_.Size();
+}
+
+bool PodCircuitLoader::Update(long long maxUSec)
+{
+    if (loaded_)
+        return true;
+
+    if (failed_)
+    {
+        if (IsWorking())
+            return false;
+
+        using namespace CircuitLoaded;
+        VariantMap& eventData = GetEventDataMap();
+        eventData[P_CIRCUITFILE] = fileName_;
+        eventData[P_SUCCESS] = false;
+        SendEvent(E_CIRCUITLOADED, eventData);
+        return true;
+    }
+
+    if (!parsed_)
+    {
+        SendProgress("parse", 0.0f);
+        return false;
+    }
+
+    // Work items can only be queued from the main thread
+    if (!tasksQueued_)
+        QueueGenerateTasks();
+
+    // Upload the models in order once the textures are converted, each upload waits for the geometry of its model
+    // generator
+    unsigned numModelGens = numModelGens_;
+    unsigned numTextureTasks = circuit_->GetNumTextureTasks();
+    unsigned numTasks = taskItems_.Size();
+    if (GetNumCompletedTasks(0, numTextureTasks) == numTextureTasks)
+    {
+        HiresTimer timer;
+        while (numUploaded_ < numModelGens && taskItems_[numTextureTasks + numUploaded_]->completed_ &&
+            timer.GetUSec(false) < maxUSec)
+            modelGens_[numUploaded_++]->GetModel();
+    }
+
+    unsigned numCompleted = GetNumCompletedTasks(0, numTasks);
+    if (numUploaded_ < numModelGens || numCompleted < numTasks)
+    {
+        if (numCompleted < numTasks)
+            SendProgress("geometry", float(numCompleted) / float(numTasks));
+        else
+            SendProgress("upload", float(numUploaded_) / float(numModelGens));
+        return false;
+    }
+
+    // The cache holds the generated data, it is written once the uploads no longer use it
+    if (useCache_ && !cacheItem_)
+    {
+        cacheItem_ = new WorkItem();
+        cacheItem_->priority_ = 0;
+        cacheItem_->workFunction_ = WriteCacheWork;
+        cacheItem_->aux_ = this;
+        GetSubsystem<WorkQueue>()->AddWorkItem(cacheItem_);
+    }
+
+    // The worker may still build the collision or write the cache
+    if (IsWorking())
+    {
+        SendProgress("collision", 0.0f);
+        return false;
+    }
+
+    loaded_ = true;
+    SendProgress("upload", 1.0f);
+
+    using namespace CircuitLoaded;
+    VariantMap& eventData = GetEventDataMap();
+    eventData[P_CIRCUITFILE] = fileName_;
+    eventData[P_SUCCESS] = true;
+    SendEvent(E_CIRCUITLOADED, eventData);
+    return true;
+}
+
+void PodCircuitLoader::SendProgress(const char* stage, float progress)
+{
+    using namespace CircuitLoadProgress;
+
+    VariantMap& eventData = GetEventDataMap();
+    eventData[P_CIRCUITFILE] = fileName_;
+    eventData[P_STAGE] = stage;
+    eventData[P_PROGRESS] = progress;
+    SendEvent(E_CIRCUITLOADPROGRESS, eventData);
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <Urho3D/Core/Object.h>
+#include <atomic>
+#include "PodCircuit.h"
+
+namespace Urho3D { class WorkItem; }
+
+/// Circuit loading progress, sent on the main thread while a circuit loads in the background.
+URHO3D_EVENT(E_CIRCUITLOADPROGRESS, CircuitLoadProgress)
+{
+    URHO3D_PARAM(P_CIRCUITFILE, circuit_file);  // String
+    URHO3D_PARAM(P_STAGE, stage);               // String: "parse", "geometry", "upload" or "collision"
+    URHO3D_PARAM(P_PROGRESS, progress);         // float, progress of the stage in [0, 1]
+}
+
+/// Circuit loading finished, successfully or not.
+URHO3D_EVENT(E_CIRCUITLOADED, CircuitLoaded)
+{
+    URHO3D_PARAM(P_CIRCUITFILE, circuit_file);  // String
+    URHO3D_PARAM(P_SUCCESS, success);           // bool
+}
+
+/// Loads a circuit without stalling the main thread. Decryption, parsing and the collision run on a worker thread,
+/// the texture conversion and the CPU side geometry in one work item per texture list and model generator on all the
+/// worker threads, while the GPU resources are created on the main thread in time sliced steps.
+class PodCircuitLoader : public Object
+{
+    URHO3D_OBJECT(PodCircuitLoader, Object)
+
+public:
+    PodCircuitLoader(Context* context, const String& fileName);
+    ~PodCircuitLoader() override;
+
+    /// Set whether to load through the baked circuit cache.
+    void SetUseCache(bool enable) { useCache_ = enable; }
+    /// Set whether to upload the textures in the native RGB565 format.
+    void SetNativeRGB565Textures(bool enable) { nativeRGB565_ = enable; }
+    /// Set the size of the merged sector chunks to build, zero to draw each sector.
+    void SetSectorChunkSize(float chunkSize) { chunkSize_ = chunkSize; }
+
+    /// Queue the background work.
+    void Start();
+    /// Upload the generated models for at most the given time and send the progress event. Main thread only.
+    /// Return true when the load is finished, successfully or not.
+    bool Update(long long maxUSec);
+
+    /// Return whether the worker threads are still using the loader.
+    bool IsWorking() const;
+    /// Return whether the circuit is fully loaded.
+    bool IsLoaded() const { return loaded_; }
+    /// Return the circuit file name.
+    const String& GetFileName() const { return fileName_; }
+    /// Return the loaded circuit, ownership is transferred to the caller.
+    PodCircuit* DetachCircuit() { return circuit_.Detach(); }
+
+private:
+    /// Decrypt, parse and build the collision. Runs on a worker thread.
+    static void LoadWork(const WorkItem* item, unsigned threadIndex);
+    /// Run a circuit generation task. Runs on a worker thread.
+    static void GenerateWork(const WorkItem* item, unsigned threadIndex);
+    /// Write the circuit cache once generated. Runs on a worker thread.
+    static void WriteCacheWork(const WorkItem* item, unsigned threadIndex);
+
+    /// Queue a work item for each circuit generation task, in task order.
+    void QueueGenerateTasks();
+    /// Return the number of completed generation tasks in a range.
+    unsigned GetNumCompletedTasks(unsigned begin, unsigned end) const;
+
+    void SendProgress(const char* stage, float progress);
+
+    String fileName_;
+    UniquePtr<PodCircuit> circuit_;
+    SharedPtr<WorkItem> item_;
+    /// Generation task work items and the task indices they point to.
+    Vector<SharedPtr<WorkItem>> taskItems_;
+    PODVector<unsigned> tasks_;
+    SharedPtr<WorkItem> cacheItem_;
+    PODVector<PodModelGen*> modelGens_;
+    /// Number of model generators, set by the worker thread once parsed.
+    std::atomic<unsigned> numModelGens_;
+    std::atomic<bool> parsed_;
+    std::atomic<bool> failed_;
+    unsigned numUploaded_;
+    bool tasksQueued_;
+    float chunkSize_;
+    bool useCache_;
+    bool nativeRGB565_;
+    bool loaded_;
+};
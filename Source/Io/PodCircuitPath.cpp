@@ -0,0 +1,253 @@
+#include <algorithm>
+#include "PodCircuitPath.h"
+
+/// Smallest grid cell size, in world units.
+static constexpr float MIN_CELL_SIZE = 10.0f;
+
+/// Grid cell size relative to the average segment length.
+static constexpr float CELL_SEGMENT_LENGTHS = 2.0f;
+
+/// Largest number of grid cells, the cells grow on very large circuits.
+static constexpr int MAX_GRID_CELLS = 256 * 256;
+
+/// Largest number of segments walked in each direction from the hint segment.
+static constexpr unsigned MAX_WALK_SEGMENTS = 8;
+
+void PodCircuitPath::Build(const Vector<Vector3>& positions)
+{
+    SetPoints(positions, nullptr, 0.0f);
+}
+
+void PodCircuitPath::Build(const Vector<Vector3>& positions, const PODVector<float>& distances, float length)
+{
+    SetPoints(positions, &distances, length);
+}
+
+void PodCircuitPath::SetPoints(const Vector<Vector3>& positions, const PODVector<float>* distances, float length)
+{
+    points_.Clear();
+    distances_.Clear();
+    cellStarts_.Clear();
+    cellSegments_.Clear();
+    bounds_.Clear();
+    length_ = 0.0f;
+
+    // Skip the repeated positions, they would make empty segments
+    for (unsigned i = 0; i < positions.Size(); i++)
+    {
+        if (points_.Empty() || !positions[i].Equals(points_.Back()))
+        {
+            points_.Push(positions[i]);
+            if (distances)
+                distances_.Push(distances_.Empty() ? (*distances)[i] : Max((*distances)[i], distances_.Back()));
+        }
+    }
+    if (points_.Size() > 1 && points_.Front().Equals(points_.Back()))
+    {
+        points_.Pop();
+        if (distances)
+            distances_.Pop();
+    }
+    if (points_.Size() < 2)
+    {
+        points_.Clear();
+        distances_.Clear();
+        return;
+    }
+
+    unsigned numSegments = points_.Size();
+    if (distances)
+    {
+        length_ = Max(length, distances_.Back());
+        distances_.Push(length_);
+    }
+    else
+    {
+        distances_.Resize(numSegments + 1);
+        for (unsigned i = 0; i < numSegments; i++)
+        {
+            distances_[i] = length_;
+            length_ += (points_[(i + 1) % numSegments] - points_[i]).Length();
+        }
+        distances_[numSegments] = length_;
+    }
+    if (length_ <= 0.0f)
+    {
+        points_.Clear();
+        distances_.Clear();
+        length_ = 0.0f;
+        return;
+    }
+
+    for (const Vector3& point : points_)
+        bounds_.Merge(point);
+
+    cellSize_ = Max(MIN_CELL_SIZE, CELL_SEGMENT_LENGTHS * length_ / numSegments);
+    for (;;)
+    {
+        gridSize_.x_ = (int)((bounds_.max_.x_ - bounds_.min_.x_) / cellSize_) + 1;
+        gridSize_.y_ = (int)((bounds_.max_.z_ - bounds_.min_.z_) / cellSize_) + 1;
+        if (gridSize_.x_ * gridSize_.y_ <= MAX_GRID_CELLS)
+            break;
+        cellSize_ *= 2.0f;
+    }
+
+    // Count the segments by cell, then fill them in cell order
+    unsigned numCells = gridSize_.x_ * gridSize_.y_;
+    cellStarts_.Resize(numCells + 1);
+    for (unsigned& start : cellStarts_)
+        start = 0;
+
+    for (int pass = 0; pass < 2; pass++)
+    {
+        for (unsigned i = 0; i < numSegments; i++)
+        {
+            IntVector2 cell1 = GetCell(points_[i]);
+            IntVector2 cell2 = GetCell(points_[(i + 1) % numSegments]);
+            for (int y = Min(cell1.y_, cell2.y_); y <= Max(cell1.y_, cell2.y_); y++)
+            {
+                for (int x = Min(cell1.x_, cell2.x_); x <= Max(cell1.x_, cell2.x_); x++)
+                {
+                    unsigned cellIdx = y * gridSize_.x_ + x;
+                    if (pass == 0)
+                        cellStarts_[cellIdx + 1]++;
+                    else
+                        cellSegments_[cellStarts_[cellIdx]++] = i;
+                }
+            }
+        }
+
+        if (pass == 0)
+        {
+            for (unsigned j = 0; j < numCells; j++)
+                cellStarts_[j + 1] += cellStarts_[j];
+            cellSegments_.Resize(cellStarts_[numCells]);
+        }
+        else
+        {
+            // Filling moved each start to the next cell start
+            for (unsigned j = numCells; j > 0; j--)
+                cellStarts_[j] = cellStarts_[j - 1];
+            cellStarts_[0] = 0;
+        }
+    }
+}
+
+PodCircuitPath::Projection PodCircuitPath::FindNearest(const Vector3& position) const
+{
+    Projection nearest;
+    if (points_.Empty())
+        return nearest;
+
+    // Search the rings of cells around the position until the unsearched cells are farther than the nearest segment.
+    // A position outside the grid is searched from its nearest cell, the ring distances still bound the segments.
+    IntVector2 center = GetCell(position);
+    int maxRadius = Max(gridSize_.x_, gridSize_.y_);
+    for (int radius = 0; radius <= maxRadius; radius++)
+    {
+        for (int y = center.y_ - radius; y <= center.y_ + radius; y++)
+        {
+            if (y < 0 || y >= gridSize_.y_)
+                continue;
+
+            bool edgeRow = y == center.y_ - radius || y == center.y_ + radius;
+            int step = edgeRow ? 1 : 2 * radius;
+            for (int x = center.x_ - radius; x <= center.x_ + radius; x += step)
+            {
+                if (x < 0 || x >= gridSize_.x_)
+                    continue;
+
+                unsigned cellIdx = y * gridSize_.x_ + x;
+                for (unsigned j = cellStarts_[cellIdx]; j < cellStarts_[cellIdx + 1]; j++)
+                    ProjectSegment(cellSegments_[j], position, nearest);
+            }
+        }
+
+        if (nearest.Offset <= radius * cellSize_)
+            break;
+    }
+    return nearest;
+}
+
+PodCircuitPath::Projection PodCircuitPath::FindNearest(const Vector3& position, int hintSegment) const
+{
+    if (hintSegment < 0 || hintSegment >= (int)points_.Size())
+        return FindNearest(position);
+
+    // Walk forward then backward from the hint while the segments get nearer
+    int numSegments = points_.Size();
+    Projection nearest;
+    ProjectSegment(hintSegment, position, nearest);
+    for (int direction = 1; direction >= -1; direction -= 2)
+    {
+        int segment = hintSegment;
+        for (unsigned i = 0; i < MAX_WALK_SEGMENTS; i++)
+        {
+            segment = (segment + direction + numSegments) % numSegments;
+            float offset = nearest.Offset;
+            ProjectSegment(segment, position, nearest);
+            if (nearest.Offset >= offset)
+                break;
+        }
+    }
+
+    // Off the path, the walk may have stopped at a local minimum
+    if (nearest.Offset > cellSize_)
+        return FindNearest(position);
+    return nearest;
+}
+
+Vector3 PodCircuitPath::GetPosition(float distance) const
+{
+    if (points_.Empty())
+        return Vector3::ZERO;
+
+    distance = WrapDistance(distance);
+    int segment = GetSegment(distance);
+    float segmentLength = distances_[segment + 1] - distances_[segment];
+    float t = segmentLength > 0.0f ? (distance - distances_[segment]) / segmentLength : 0.0f;
+    return points_[segment].Lerp(points_[(segment + 1) % points_.Size()], t);
+}
+
+Vector3 PodCircuitPath::GetSegmentDirection(int segment) const
+{
+    return (points_[(segment + 1) % points_.Size()] - points_[segment]).Normalized();
+}
+
+int PodCircuitPath::GetSegment(float distance) const
+{
+    if (points_.Empty())
+        return -1;
+
+    const float* begin = distances_.Buffer();
+    const float* end = begin + distances_.Size();
+    int segment = (int)(std::upper_bound(begin, end, WrapDistance(distance)) - begin) - 1;
+    return Clamp(segment, 0, (int)points_.Size() - 1);
+}
+
+IntVector2 PodCircuitPath::GetCell(const Vector3& position) const
+{
+    int x = (int)((position.x_ - bounds_.min_.x_) / cellSize_);
+    int y = (int)((position.z_ - bounds_.min_.z_) / cellSize_);
+    return IntVector2(Clamp(x, 0, gridSize_.x_ - 1), Clamp(y, 0, gridSize_.y_ - 1));
+}
+
+void PodCircuitPath::ProjectSegment(int segment, const Vector3& position, Projection& nearest) const
+{
+    const Vector3& start = points_[segment];
+    Vector3 delta = points_[(segment + 1) % points_.Size()] - start;
+    float t = Clamp((position - start).DotProduct(delta) / delta.LengthSquared(), 0.0f, 1.0f);
+    float offset = (start + delta * t - position).Length();
+    if (offset < nearest.Offset)
+    {
+        nearest.Segment = segment;
+        nearest.Distance = Lerp(distances_[segment], distances_[segment + 1], t);
+        nearest.Offset = offset;
+    }
+}
+
+float PodCircuitPath::WrapDistance(float distance) const
+{
+    distance = fmodf(distance, length_);
+    return distance < 0.0f ? distance + length_ : distance;
+}
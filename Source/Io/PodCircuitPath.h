@@ -0,0 +1,75 @@
+#pragma once
+
+#include <Urho3D/Container/Vector.h>
+#include <Urho3D/Math/BoundingBox.h>
+#include <Urho3D/Math/Vector3.h>
+
+using namespace Urho3D;
+
+/// Closed polyline through the positions of a circuit difficulty path or track segments, with the distance along the
+/// path of its points and a uniform grid of its segments on the ground plane for the nearest segment lookups.
+class PodCircuitPath
+{
+public:
+    /// Nearest point of the path to a position.
+    struct Projection
+    {
+        /// Segment index, -1 if the path is empty.
+        int Segment = -1;
+        /// Distance from the path start.
+        float Distance = 0.0f;
+        /// Distance from the position to the path.
+        float Offset = M_INFINITY;
+    };
+
+    /// Build the segments and the grid from the path positions. The last position connects back to the first.
+    void Build(const Vector<Vector3>& positions);
+    /// Build from positions with a known distance from the path start, increasing up to the path length.
+    void Build(const Vector<Vector3>& positions, const PODVector<float>& distances, float length);
+
+    /// Return whether the path has segments.
+    bool IsEmpty() const { return points_.Empty(); }
+    /// Return the number of segments.
+    unsigned GetNumSegments() const { return points_.Size(); }
+    /// Return the path length.
+    float GetLength() const { return length_; }
+
+    /// Return the nearest point of the path to a position. Only the grid cells around the position are searched.
+    Projection FindNearest(const Vector3& position) const;
+    /// Return the nearest point of the path to a position, walking from the segment found by the previous query while
+    /// the segments get nearer. The grid is searched when the walk does not end near the path, or without a hint.
+    Projection FindNearest(const Vector3& position, int hintSegment) const;
+
+    /// Return the position at a distance from the path start, wrapped around the path length.
+    Vector3 GetPosition(float distance) const;
+    /// Return the direction of a segment.
+    Vector3 GetSegmentDirection(int segment) const;
+    /// Return the segment at a distance from the path start, wrapped around the path length.
+    int GetSegment(float distance) const;
+
+private:
+    /// Set the segment points and distances, skipping the repeated positions, then build the grid. Computes the
+    /// distances and length when not given.
+    void SetPoints(const Vector<Vector3>& positions, const PODVector<float>* distances, float length);
+    /// Return the grid cell of a position, clamped to the grid.
+    IntVector2 GetCell(const Vector3& position) const;
+    /// Return the nearest point of a segment to a position.
+    void ProjectSegment(int segment, const Vector3& position, Projection& nearest) const;
+    /// Wrap a distance into the path length.
+    float WrapDistance(float distance) const;
+
+    /// Segment start points.
+    PODVector<Vector3> points_;
+    /// Distance from the path start of the segment start points, followed by the path length.
+    PODVector<float> distances_;
+    float length_ = 0.0f;
+
+    /// Bounds of the segment points, the grid covers their ground plane extent.
+    BoundingBox bounds_;
+    float cellSize_ = 0.0f;
+    IntVector2 gridSize_;
+    /// Start of each cell in cellSegments_, followed by the total count.
+    PODVector<unsigned> cellStarts_;
+    /// Indices of the segments crossing each cell, by cell.
+    PODVector<unsigned> cellSegments_;
+};
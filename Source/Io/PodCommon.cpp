@@ -1,5 +1,7 @@
 #include <stdexcept>
 #include <Urho3D/Core/Main.h>
+#include <Urho3D/Core/Thread.h>
+#include <Urho3D/Core/WorkQueue.h>
 #include <Urho3D/IO/FileSystem.h>
 #include <Urho3D/IO/File.h>
 #include <Urho3D/Graphics/Texture2D.h>
@@ -13,81 +15,216 @@
 #include "PodVehicle.h"
 
 
-/// Given a PDBF file with encrypted data, fills a Vector of bytes with decrypted data.
-/// Function was mostly copied from the C# code for PDBF by Ray Koopa.
-static void Decrypt(unsigned int key, unsigned int blockSize, File& file, PODVector<unsigned char>& dest)
+#ifdef URHO3D_SSE
+#include <emmintrin.h>
+#endif
+
+/// Minimum number of blocks for the decryption to be split across the worker threads.
+static constexpr unsigned int MIN_PARALLEL_DECRYPT_BLOCKS = 16;
+
+/// Default number of decrypted blocks kept by an opened file.
+static constexpr unsigned DEFAULT_BLOCK_CACHE_SIZE = 8;
+
+/// Size of the file start first read by Open to find the block size, doubled until the first block fits.
+static constexpr unsigned OPEN_READ_SIZE = 16384;
+
+/// Returns whether the key uses the chained encryption starting with the second block.
+static bool IsChainedKey(unsigned int key)
 {
-    int blockIndex = 0;
-    int blockDataSize = blockSize - sizeof(unsigned int);
-    int blockDataDwordCount = blockDataSize / sizeof(unsigned int);
+    return key == 0x00005CA8 || key == 0x0000D13F;
+}
 
-    unsigned char* block = new unsigned char[blockSize];
-    unsigned int* blockDword = reinterpret_cast<unsigned int*>(block);
+/// Decrypts a block with the default XOR encryption. Returns the checksum of the decrypted data.
+/// Dest may alias src as long as dest <= src, which allows compacting the blocks in place.
+static unsigned int DecryptBlockXor(unsigned int key, const unsigned int* src, unsigned int* dest, unsigned int dwordCount)
+{
+    unsigned int i = 0;
+    unsigned int checksum = 0;
+#ifdef URHO3D_SSE
+    __m128i keyVec = _mm_set1_epi32((int)key);
+    __m128i sumVec = _mm_setzero_si128();
+    for (; i + 4 <= dwordCount; i += 4)
+    {
+        __m128i value = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)), keyVec);
+        sumVec = _mm_add_epi32(sumVec, value);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i), value);
+    }
+    sumVec = _mm_add_epi32(sumVec, _mm_shuffle_epi32(sumVec, _MM_SHUFFLE(1, 0, 3, 2)));
+    sumVec = _mm_add_epi32(sumVec, _mm_shuffle_epi32(sumVec, _MM_SHUFFLE(2, 3, 0, 1)));
+    checksum = (unsigned int)_mm_cvtsi128_si32(sumVec);
+#endif
+    for (; i < dwordCount; i++)
+    {
+        unsigned int value = src[i] ^ key;
+        checksum += value;
+        dest[i] = value;
+    }
+    return checksum;
+}
 
-    while (!file.IsEof())
+/// Decrypts a block with the special encryption used by some keys. Returns the checksum of the decrypted data.
+/// Same aliasing rules as DecryptBlockXor.
+static unsigned int DecryptBlockChained(const unsigned int* src, unsigned int* dest, unsigned int dwordCount)
+{
+    unsigned int checksum = 0;
+    unsigned int lastValue = 0;
+    for (unsigned int i = 0; i < dwordCount; i++)
     {
-        // Process a block.
-        file.Read(block, blockSize);//inStream.Read(block, 0, blockSize);
-        int i = 0;
-        unsigned int checksum = 0;
-        if (blockIndex == 0 || (key != 0x00005CA8 && key != 0x0000D13F))
+        unsigned int keyValue = 0;
+        switch (lastValue >> 16 & 3)
         {
-            // First block and most keys always use the default XOR encryption.
-            for (; i < blockDataDwordCount; i++)
-            {
-                unsigned int* value = blockDword + i;
-                checksum += (*value ^ key);
-                *value ^= key;
-            }
+        case 0: keyValue = lastValue - 0x50A4A89D; break;
+        case 1: keyValue = 0x3AF70BC4 - lastValue; break;
+        case 2: keyValue = (lastValue + 0x07091971) << 1; break;
+        case 3: keyValue = (0x11E67319 - lastValue) << 1; break;
         }
-        else
+        lastValue = src[i];
+        unsigned int value = 0;
+        switch (lastValue & 3)
         {
-            // Starting with the second block, specific keys use a special encryption.
-            unsigned int lastValue = 0;
-            for (; i < blockDataDwordCount; i++)
-            {
-                unsigned int keyValue = 0;
-                switch (lastValue >> 16 & 3)
-                {
-                case 0: keyValue = lastValue - 0x50A4A89D; break;
-                case 1: keyValue = 0x3AF70BC4 - lastValue; break;
-                case 2: keyValue = (lastValue + 0x07091971) << 1; break;
-                case 3: keyValue = (0x11E67319 - lastValue) << 1; break;
-                }
-                unsigned int* value = blockDword + i;
-                lastValue = *value;
-                switch (lastValue & 3)
-                {
-                case 0: *value = ~(*value) ^ keyValue; break;
-                case 1: *value = ~(*value) ^ ~keyValue; break;
-                case 2: *value = (*value) ^ ~keyValue; break;
-                case 3: *value = (*value) ^ keyValue ^ 0xFFFF; break;
-                }
-                checksum += *value;
-            }
+        case 0: value = ~lastValue ^ keyValue; break;
+        case 1: value = ~lastValue ^ ~keyValue; break;
+        case 2: value = lastValue ^ ~keyValue; break;
+        case 3: value = lastValue ^ keyValue ^ 0xFFFF; break;
         }
-        // Validate the checksum and write the decrypted block.
-        if (checksum != blockDword[i])
+        checksum += value;
+        dest[i] = value;
+    }
+    return checksum;
+}
+
+/// Decrypts the block at blockIndex in the file from srcBlock (raw block data) into destBlock (decrypted data,
+/// without the block checksum). Returns false if the block checksum does not match.
+static bool DecryptBlockData(unsigned int key, unsigned int blockSize, unsigned int blockIndex,
+    const unsigned int* srcBlock, unsigned int* destBlock)
+{
+    unsigned int blockDataDwordCount = (blockSize - sizeof(unsigned int)) / sizeof(unsigned int);
+    unsigned int expected = srcBlock[blockDataDwordCount];
+
+    // First block and most keys always use the default XOR encryption.
+    // Starting with the second block, specific keys use a special encryption.
+    unsigned int checksum;
+    if (blockIndex == 0 || !IsChainedKey(key))
+        checksum = DecryptBlockXor(key, srcBlock, destBlock, blockDataDwordCount);
+    else
+        checksum = DecryptBlockChained(srcBlock, destBlock, blockDataDwordCount);
+
+    return checksum == expected;
+}
+
+/// Decrypts one block from src (raw file data) into dest (decrypted data, without the block checksums).
+/// Returns false if the block checksum does not match.
+static bool DecryptBlock(unsigned int key, unsigned int blockSize, unsigned int blockIndex, const unsigned char* src, unsigned char* dest)
+{
+    unsigned int blockDataSize = blockSize - sizeof(unsigned int);
+    return DecryptBlockData(key, blockSize, blockIndex, reinterpret_cast<const unsigned int*>(src + blockIndex * blockSize),
+        reinterpret_cast<unsigned int*>(dest + blockIndex * blockDataSize));
+}
+
+/// Given a buffer holding a whole PDBF file, decrypts every block in place and packs the decrypted data
+/// at the start of the buffer, dropping the block checksums. Returns the decrypted data size.
+/// Function was mostly copied from the C# code for PDBF by Ray Koopa.
+static unsigned int Decrypt(unsigned int key, unsigned int blockSize, unsigned char* data, unsigned int size)
+{
+    unsigned int blockCount = size / blockSize;
+    for (unsigned int blockIndex = 0; blockIndex < blockCount; blockIndex++)
+    {
+        if (!DecryptBlock(key, blockSize, blockIndex, data, data))
             throw std::runtime_error("Invalid PBDF block checksum.");
+    }
+    return blockCount * (blockSize - sizeof(unsigned int));
+}
 
-        dest.Insert(blockIndex * blockDataSize, PODVector<unsigned char>(block, blockDataSize));
-        blockIndex++;
+/// Shared state of a decryption split across the worker threads.
+struct DecryptJob
+{
+    unsigned int key;
+    unsigned int blockSize;
+    const unsigned char* src;
+    unsigned char* dest;
+    /// Per block checksum result, the work items point into this array.
+    unsigned char* blockValid;
+};
+
+static void DecryptBlocksWork(const WorkItem* item, unsigned threadIndex)
+{
+    const DecryptJob& job = *(reinterpret_cast<DecryptJob*>(item->aux_));
+    auto* start = reinterpret_cast<unsigned char*>(item->start_);
+    auto* end = reinterpret_cast<unsigned char*>(item->end_);
+
+    while (start != end)
+    {
+        *start = DecryptBlock(job.key, job.blockSize, start - job.blockValid, job.src, job.dest);
+        ++start;
     }
 }
 
-/// Calculates the PDBF block size given an encryption key
-static unsigned int ReadBlockSize(File& file, unsigned int key)
+/// Decrypts a whole PDBF file from src into dest using the worker threads, then checks all block checksums.
+/// Dest must not overlap src. Returns the decrypted data size.
+static unsigned int DecryptParallel(WorkQueue* queue, unsigned int key, unsigned int blockSize, const unsigned char* src,
+    unsigned int size, unsigned char* dest)
+{
+    unsigned int blockCount = size / blockSize;
+    PODVector<unsigned char> blockValid(blockCount);
+    DecryptJob job = { key, blockSize, src, dest, blockValid.Buffer() };
+
+    int numWorkItems = queue->GetNumThreads() + 1; // Worker threads + main thread
+    int blocksPerItem = Max((int)(blockCount / numWorkItems), 1);
+
+    PODVector<unsigned char>::Iterator start = blockValid.Begin();
+    for (int i = 0; i < numWorkItems && start != blockValid.End(); ++i)
+    {
+        SharedPtr<WorkItem> item = queue->GetFreeItem();
+        item->priority_ = M_MAX_UNSIGNED;
+        item->workFunction_ = DecryptBlocksWork;
+        item->aux_ = &job;
+
+        PODVector<unsigned char>::Iterator end = blockValid.End();
+        if (i < numWorkItems - 1 && end - start > blocksPerItem)
+            end = start + blocksPerItem;
+
+        item->start_ = &(*start);
+        item->end_ = &(*end);
+        queue->AddWorkItem(item);
+
+        start = end;
+    }
+
+    queue->Complete(M_MAX_UNSIGNED);
+
+    for (unsigned char valid : blockValid)
+    {
+        if (!valid)
+            throw std::runtime_error("Invalid PBDF block checksum.");
+    }
+    return blockCount * (blockSize - sizeof(unsigned int));
+}
+
+/// Finds the PDBF block size given an encryption key, from the start of a file of fileSize bytes. Returns 0 when the
+/// first block is not complete in data.
+static unsigned int FindBlockSize(const unsigned char* data, unsigned int size, unsigned int fileSize, unsigned int key)
 {
+    const unsigned int* dwords = reinterpret_cast<const unsigned int*>(data);
+    unsigned int dwordCount = size / sizeof(unsigned int);
     unsigned int checksum = 0;
-    while (!file.IsEof())
+    for (unsigned int i = 0; i < dwordCount; i++)
     {
-        unsigned int value = file.ReadUInt();
-        if (value == checksum && (file.GetSize() % file.GetPosition() == 0))
-            return file.GetPosition();
+        unsigned int position = (i + 1) * sizeof(unsigned int);
+        if (dwords[i] == checksum && (fileSize % position == 0))
+            return position;
 
-        checksum += value ^ key;
+        checksum += dwords[i] ^ key;
     }
-    throw std::runtime_error("Could not determine PDBF block size");
+    return 0;
+}
+
+/// Calculates the PDBF block size given an encryption key
+static unsigned int ReadBlockSize(const unsigned char* data, unsigned int size, unsigned int key)
+{
+    unsigned int blockSize = FindBlockSize(data, size, size, key);
+    if (!blockSize)
+        throw std::runtime_error("Could not determine PDBF block size");
+    return blockSize;
 }
 
 /// Returns an offset table from the file header, the offsets are
@@ -138,25 +275,180 @@ bool FaceData::IsVisible() const
     return FaceProperties & 1;
 }
 
+bool FaceData::IsRoad() const
+{
+    return (FaceProperties & (1 << 3)) != 0;
+}
+
+bool FaceData::IsWall() const
+{
+    return (FaceProperties & (1 << 5)) != 0;
+}
+
+bool FaceData::IsDural() const
+{
+    return (FaceProperties & (1 << 13)) != 0;
+}
+
+unsigned FaceData::GetSlipperiness() const
+{
+    return (FaceProperties >> 16) & 0xff;
+}
+
 
 PodBdfFile::PodBdfFile(Context* context, const String& fileName)
-    : context_(context), fileName_(fileName)
+    : context_(context), fileName_(fileName), parallelDecrypt_(true), blockCacheSize_(DEFAULT_BLOCK_CACHE_SIZE),
+    blockUseCount_(0)
 {
 }
 
 bool PodBdfFile::Load()
 {
-    UniquePtr<File> file(new File(context_, fileName_, FILE_READ));
-    if (!file->IsOpen() || file->IsEof())
+    if (!ReadFile())
+        return false;
+
+    DecryptData();
+    return LoadDecryptedData();
+}
+
+bool PodBdfFile::Load(Deserializer& source)
+{
+    if (!ReadFile(source))
+        return false;
+
+    DecryptData();
+    return LoadDecryptedData();
+}
+
+bool PodBdfFile::Open()
+{
+    data_.Clear();
+    blockCache_.Clear();
+    file_ = new File(context_, fileName_, FILE_READ);
+    unsigned int fileSize = file_->GetSize();
+    if (!file_->IsOpen() || fileSize < sizeof(unsigned int))
+    {
+        file_.Reset();
+        return false;
+    }
+
+    // Read the file start until it holds the first block, whose checksum gives the block size
+    PODVector<unsigned char> start;
+    blockSize_ = 0;
+    for (unsigned int readSize = OPEN_READ_SIZE; !blockSize_; readSize *= 2)
+    {
+        start.Resize(Min(readSize, fileSize));
+        file_->Seek(0);
+        file_->Read(start.Buffer(), start.Size());
+        key_ = *reinterpret_cast<const unsigned int*>(start.Buffer()) ^ fileSize;
+        blockSize_ = FindBlockSize(start.Buffer(), start.Size(), fileSize, key_);
+        if (!blockSize_ && start.Size() == fileSize)
+        {
+            file_.Reset();
+            throw std::runtime_error("Could not determine PDBF block size");
+        }
+    }
+
+    position_ = 0;
+    size_ = fileSize / blockSize_ * (blockSize_ - sizeof(unsigned int));
+
+    // Read the header and adjusted offsets, decrypting the first blocks only
+    offsets_ = ReadHeader(*this, blockSize_);
+
+    headerEnd_ = position_;
+    return true;
+}
+
+void PodBdfFile::SetBlockCacheSize(unsigned numBlocks)
+{
+    blockCacheSize_ = Max(numBlocks, 1U);
+    if (blockCache_.Size() > blockCacheSize_)
+        blockCache_.Clear();
+}
+
+const unsigned char* PodBdfFile::GetBlock(unsigned blockIndex)
+{
+    // Replace the least recently used block once the cache is full
+    CachedBlock* block = nullptr;
+    for (CachedBlock& cached : blockCache_)
+    {
+        if (cached.Index == blockIndex)
+        {
+            cached.LastUse = ++blockUseCount_;
+            return cached.Data.Buffer();
+        }
+        if (!block || cached.LastUse < block->LastUse)
+            block = &cached;
+    }
+    if (blockCache_.Size() < blockCacheSize_)
+    {
+        blockCache_.Resize(blockCache_.Size() + 1);
+        block = &blockCache_.Back();
+    }
+    block->Index = M_MAX_UNSIGNED;
+    block->LastUse = 0;
+
+    rawBlock_.Resize(blockSize_);
+    file_->Seek(blockIndex * blockSize_);
+    if (file_->Read(rawBlock_.Buffer(), blockSize_) != blockSize_)
+        throw std::runtime_error("Could not read PBDF block.");
+
+    block->Data.Resize(blockSize_ - sizeof(unsigned int));
+    if (!DecryptBlockData(key_, blockSize_, blockIndex, reinterpret_cast<const unsigned int*>(rawBlock_.Buffer()),
+        reinterpret_cast<unsigned int*>(block->Data.Buffer())))
+        throw std::runtime_error("Invalid PBDF block checksum.");
+
+    block->Index = blockIndex;
+    block->LastUse = ++blockUseCount_;
+    return block->Data.Buffer();
+}
+
+bool PodBdfFile::ReadFile()
+{
+    File file(context_, fileName_, FILE_READ);
+    return file.IsOpen() && ReadFile(file);
+}
+
+bool PodBdfFile::ReadFile(Deserializer& source)
+{
+    file_.Reset();
+    blockCache_.Clear();
+    if (source.IsEof())
+        return false;
+
+    // Read the whole file at once, it is decrypted in place afterwards
+    unsigned int fileSize = source.GetSize();
+    if (fileSize < sizeof(unsigned int))
         return false;
+    data_.Resize(fileSize);
+    return source.Read(data_.Buffer(), fileSize) == fileSize;
+}
 
-    key_ = file->ReadUInt() ^ file->GetSize();
-    file->Seek(0);
-    blockSize_ = ReadBlockSize(*file, key_);
-    file->Seek(0);
+void PodBdfFile::DecryptData()
+{
+    unsigned int fileSize = data_.Size();
+    key_ = *reinterpret_cast<const unsigned int*>(data_.Buffer()) ^ fileSize;
+    blockSize_ = ReadBlockSize(data_.Buffer(), fileSize, key_);
+
+    auto* queue = context_->GetSubsystem<WorkQueue>();
+    unsigned int blockCount = fileSize / blockSize_;
+    bool parallel = parallelDecrypt_ && queue && queue->GetNumThreads() && Thread::IsMainThread() &&
+        blockCount >= MIN_PARALLEL_DECRYPT_BLOCKS;
+
+    // The chained keys are still decrypted one block at a time on the calling thread
+    if (parallel && !IsChainedKey(key_))
+    {
+        PODVector<unsigned char> raw;
+        raw.Swap(data_);
+        data_.Resize(blockCount * (blockSize_ - sizeof(unsigned int)));
+        DecryptParallel(queue, key_, blockSize_, raw.Buffer(), fileSize, data_.Buffer());
+    }
+    else
+        data_.Resize(Decrypt(key_, blockSize_, data_.Buffer(), fileSize));
+}
 
-    data_.Resize(file->GetSize() - (file->GetSize() / blockSize_ * sizeof(unsigned int)));
-    Decrypt(key_, blockSize_, *file, data_);
+bool PodBdfFile::LoadDecryptedData()
+{
     position_ = 0;
     size_ = data_.Size();
 
@@ -170,6 +462,24 @@ bool PodBdfFile::Load()
 
 unsigned PodBdfFile::Read(void* dest, unsigned size)
 {
+    if (file_)
+    {
+        // Copy from the blocks covering the range, decrypting them when needed
+        unsigned int blockDataSize = blockSize_ - sizeof(unsigned int);
+        unsigned int readSize = position_ < size_ ? Min(size, size_ - position_) : 0;
+        auto* destBytes = static_cast<unsigned char*>(dest);
+        for (unsigned int remaining = readSize; remaining;)
+        {
+            unsigned int offset = position_ % blockDataSize;
+            unsigned int count = Min(remaining, blockDataSize - offset);
+            std::memcpy(destBytes, GetBlock(position_ / blockDataSize) + offset, count);
+            destBytes += count;
+            position_ += count;
+            remaining -= count;
+        }
+        return readSize;
+    }
+
     unsigned int acsize = size;
     if ((position_ + size) > data_.Size())
         acsize = size - (data_.Size() - position_);
@@ -328,6 +638,7 @@ void PodBdfFile::ReadFace(FaceData& face, unsigned int flags)
     if (fileType_ == FILE_CIRCUIT && Vector3FromFP1616(face.Normal) == Vector3::ZERO)
     {
         face.Reserved2 = ReadUInt();
+        face.FaceProperties = 0;
     }
     else
     {
@@ -337,13 +648,19 @@ void PodBdfFile::ReadFace(FaceData& face, unsigned int flags)
     }
 
     face.UseAnimTexCoord = false;
+    face.Animated = false;
 }
 
 void PodBdfFile::ReadObject(ObjectData& obj, unsigned int flags)
 {
+    // Convert once per object, the faces gather from the converted vertices. The fixed point arrays share a
+    // temporary buffer and are not kept.
     obj.VertexCount = ReadUInt();
-    obj.VertexArray = new fp1616_t[obj.VertexCount * 3];
-    Read(obj.VertexArray.Get(), obj.VertexCount * 3 * sizeof(fp1616_t));
+    PODVector<fp1616_t> fixedPoint(obj.VertexCount * 3);
+    Read(fixedPoint.Buffer(), fixedPoint.Size() * sizeof(fp1616_t));
+    obj.Positions.Resize(obj.VertexCount);
+    ConvertVectorsFromFP1616(fixedPoint.Buffer(), obj.Positions.Buffer(), obj.VertexCount);
+
     obj.FaceCount = ReadUInt();
     obj.TriangleCount = ReadUInt();
     obj.QuadrangleCount = ReadUInt();
@@ -359,10 +676,34 @@ void PodBdfFile::ReadObject(ObjectData& obj, unsigned int flags)
             obj.QuadFaces.Push(&face);
     }
 
-    obj.Normals = new fp1616_t[obj.VertexCount * 3];
-    Read(obj.Normals.Get(), obj.VertexCount * 3 * sizeof(fp1616_t));
+    Read(fixedPoint.Buffer(), fixedPoint.Size() * sizeof(fp1616_t));
+    obj.VertexNormals.Resize(obj.VertexCount);
+    ConvertVectorsFromFP1616(fixedPoint.Buffer(), obj.VertexNormals.Buffer(), obj.VertexCount);
 
     obj.Unknown = ReadUInt();
     if (flags & FLAG_OBJ_HAS_PRISM)
         Read(obj.Prism, sizeof(obj.Prism));
+}
+
+void ConvertVectorsFromFP1616(const fp1616_t* src, Vector3* dest, unsigned count)
+{
+    const float scale = 1.0f / float(1 << 16);
+    unsigned i = 0;
+#ifdef URHO3D_SSE
+    // Each vector is loaded and stored as 4 floats, the extra lane reads the next vector and is overwritten by it, so
+    // the last vector is converted by the scalar loop. The power of two scale gives the same result as a division.
+    const __m128 scaleVec = _mm_setr_ps(-scale, scale, scale, 0.0f);
+    for (; i + 1 < count; i++)
+    {
+        __m128 value = _mm_cvtepi32_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 3)));
+        value = _mm_mul_ps(_mm_shuffle_ps(value, value, _MM_SHUFFLE(3, 0, 2, 1)), scaleVec);
+        _mm_storeu_ps(&dest[i].x_, value);
+    }
+#endif
+    for (; i < count; i++)
+    {
+        dest[i].x_ = -src[i * 3 + 1] * scale;
+        dest[i].y_ = src[i * 3 + 2] * scale;
+        dest[i].z_ = src[i * 3 + 0] * scale;
+    }
 }
\ No newline at end of file
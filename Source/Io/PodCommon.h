@@ -66,7 +66,15 @@ struct FaceData;
 struct FaceData
 {
     bool IsVisible() const;
-    
+    /// Return whether the face is drivable road.
+    bool IsRoad() const;
+    /// Return whether the face is a wall.
+    bool IsWall() const;
+    /// Return whether the face has the dural effect.
+    bool IsDural() const;
+    /// Return the slipperiness level of the face surface, zero for full grip.
+    unsigned GetSlipperiness() const;
+
     String Name; // if (NamedFaces)
     uint32_t Vertices;  // 3..4
     uint32_t Indices[4];
@@ -83,20 +91,23 @@ struct FaceData
 
     Vector2 AnimTexCoord[4];
     bool UseAnimTexCoord;
+    bool Animated; // texture coordinates can change at runtime, the face vertices are not shared
 };
 
 struct ObjectData
 {
     uint32_t VertexCount;                   // uint16_t
-    UniqueArray<fp1616_t> VertexArray;      // [VertexCount][3]
     uint32_t FaceCount;
     uint32_t TriangleCount;                 // used for alloc
     uint32_t QuadrangleCount;               // used for alloc
     UniqueArray<FaceData> FaceData;                     // [FaceCount]
-    UniqueArray<fp1616_t> Normals;           // [VertexCount] [3]
     uint32_t Unknown;
     uint8_t Prism[28]; // Vehicle only
 
+    // The fixed point vertex and normal arrays of the file are not kept, ReadObject converts them as they are read
+    PODVector<Vector3> Positions;           // [VertexCount], converted to engine axes by ReadObject
+    PODVector<Vector3> VertexNormals;       // [VertexCount], converted to engine axes by ReadObject
+
     PODVector<::FaceData*> TriFaces;
     PODVector<::FaceData*> QuadFaces;
 };
@@ -107,6 +118,25 @@ public:
     explicit PodBdfFile(Context* context, const String& fileName);
 
     bool Load();
+    /// Load from already opened file data, such as a resource cache file. Can be called from a worker thread.
+    bool Load(Deserializer& source);
+
+    /// Open the file to read its sections on demand, instead of loading it whole. Reads the header and the offset
+    /// table only; the blocks covering the data read afterwards are decrypted when needed, and the most recently used
+    /// ones are kept. Does not call LoadData.
+    bool Open();
+
+    /// Set whether to split the decryption across the worker threads. Enabled by default.
+    void SetParallelDecrypt(bool enable) { parallelDecrypt_ = enable; }
+
+    /// Set the number of decrypted blocks kept by an opened file.
+    void SetBlockCacheSize(unsigned numBlocks);
+
+    /// Return the number of offsets in the offset table.
+    unsigned GetNumOffsets() const { return offsets_.Size(); }
+
+    /// Return the number of decrypted blocks kept by an opened file.
+    unsigned GetNumCachedBlocks() const { return blockCache_.Size(); }
 
     virtual bool LoadData() = 0;
 
@@ -153,18 +183,52 @@ public:
 
     PodFileType fileType_;
 
+protected:
+    /// Read the whole encrypted file into data_.
+    bool ReadFile();
+    /// Read the whole encrypted file from opened file data into data_.
+    bool ReadFile(Deserializer& source);
+    /// Decrypt data_ in place and determine the key and block size.
+    void DecryptData();
+    /// Read the offset table from the decrypted data_ and call LoadData.
+    bool LoadDecryptedData();
+
+    /// Encrypted file data after ReadFile, decrypted data afterwards
+    PODVector<unsigned char> data_;
+    /// Encryption key
+    unsigned int key_;
+    /// Block size
+    unsigned int blockSize_;
+
 private:
+    /// Decrypted block of an opened file.
+    struct CachedBlock
+    {
+        unsigned Index;
+        unsigned LastUse;
+        PODVector<unsigned char> Data;
+    };
+
+    /// Return the decrypted data of a block of the opened file, decrypting it when not cached.
+    const unsigned char* GetBlock(unsigned blockIndex);
+
     String fileName_;
-    /// Decrypted data
-    PODVector<unsigned char> data_;
     /// Offsets relative to data start
     PODVector<int> offsets_;
     /// Header end offset
     unsigned int headerEnd_;
-    /// Encryption key
-    unsigned int key_;
-    /// Block size
-    unsigned int blockSize_;
+    /// Whether to decrypt the blocks on the worker threads
+    bool parallelDecrypt_;
+    /// File opened by Open, decrypted block by block
+    SharedPtr<File> file_;
+    /// Most recently used decrypted blocks of the opened file
+    Vector<CachedBlock> blockCache_;
+    /// Encrypted block read from the opened file
+    PODVector<unsigned char> rawBlock_;
+    /// Maximum number of cached blocks
+    unsigned blockCacheSize_;
+    /// Block reads counter, ordering the cached blocks by use
+    unsigned blockUseCount_;
 };
 
 static float FloatFromFP1616(fp1616_t fp)
@@ -177,6 +241,9 @@ static Vector3 Vector3FromFP1616(fp1616_t* fp)
     return Vector3(FloatFromFP1616(fp[0]), FloatFromFP1616(fp[1]), FloatFromFP1616(fp[2]));
 }
 
+/// Convert packed 16.16 fixed point vectors to floats in the engine axes, like PodTransform(Vector3FromFP1616()).
+void ConvertVectorsFromFP1616(const fp1616_t* src, Vector3* dest, unsigned count);
+
 static Color ColorFromRGB565(uint16_t pix)
 {
     uint8_t r5 = (pix >> 11) & 0x001f;
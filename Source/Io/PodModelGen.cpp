@@ -1,3 +1,4 @@
+#include <Urho3D/Graphics/Graphics.h>
 #include <Urho3D/Graphics/Texture2D.h>
 #include <Urho3D/Resource/Image.h>
 #include <Urho3D/Graphics/Model.h>
@@ -7,9 +8,19 @@
 #include <Urho3D/Graphics/Geometry.h>
 #include <Urho3D/Graphics/Technique.h>
 #include <Urho3D/Resource/ResourceCache.h>
+#include <Urho3D/Container/Sort.h>
+#include <Urho3D/IO/Deserializer.h>
+#include <Urho3D/IO/Serializer.h>
 #include "PodModelGen.h"
 #include "PodCommon.h"
 
+#ifdef URHO3D_SSE
+#include <emmintrin.h>
+#endif
+
+static constexpr unsigned MAX_SHORT_INDEXED_VERTICES = 65536;
+static constexpr unsigned VERTEX_CACHE_SIZE = 16;
+
 PodGeometryGen::PodGeometryGen(Context* ctx)
     : vertexBuffer_(new VertexBuffer(ctx))
     , uvBuffer_(new VertexBuffer(ctx))
@@ -21,110 +32,266 @@ PodGeometryGen::PodGeometryGen(Context* ctx)
     //elements.Push(VertexElement(TYPE_VECTOR2, SEM_TEXCOORD));
 }
 
-void PodGeometryGen::GenerateDataFromFace(const FaceData& face)
+static void GetFaceVertices(const FaceData& face, PODVector<PodGeometryGen::FaceVertex>& faceVerts)
 {
-    struct FaceVertex { unsigned int idx; Vector2 uv; };
-    static PODVector<FaceVertex> faceVerts;
     faceVerts.Clear();
 
     if (!face.IsVisible()) return;
 
-    if (face.Vertices > 3)
-    {
-        // triangulate quad
-        for (int j = 1; j < face.Vertices - 1; j++)
-        {
-            unsigned int idx1 = face.Indices[0];
-            unsigned int idx2 = face.Indices[j];
-            unsigned int idx3 = face.Indices[j + 1];
-            Vector2 uv1, uv2, uv3;
-            if (face.UseAnimTexCoord)
-            {
-                uv1 = face.AnimTexCoord[0];
-                uv2 = face.AnimTexCoord[j];
-                uv3 = face.AnimTexCoord[j+1];
-            }
-            else
-            {
-                uv1 = Vector2(face.TexCoord[0][0], face.TexCoord[0][1]);
-                uv2 = Vector2(face.TexCoord[j][0], face.TexCoord[j][1]);
-                uv3 = Vector2(face.TexCoord[j + 1][0], face.TexCoord[j + 1][1]);
-            }
-            faceVerts.Push({ idx1, uv1 });
-            faceVerts.Push({ idx2, uv2 });
-            faceVerts.Push({ idx3, uv3 });
-        }
-    }
-    else
+    // triangulate quads as a fan
+    for (int j = 1; j < face.Vertices - 1; j++)
     {
         unsigned int idx1 = face.Indices[0];
-        unsigned int idx2 = face.Indices[1];
-        unsigned int idx3 = face.Indices[2];
+        unsigned int idx2 = face.Indices[j];
+        unsigned int idx3 = face.Indices[j + 1];
         Vector2 uv1, uv2, uv3;
         if (face.UseAnimTexCoord)
         {
             uv1 = face.AnimTexCoord[0];
-            uv2 = face.AnimTexCoord[1];
-            uv3 = face.AnimTexCoord[2];
+            uv2 = face.AnimTexCoord[j];
+            uv3 = face.AnimTexCoord[j + 1];
         }
         else
         {
             uv1 = Vector2(face.TexCoord[0][0], face.TexCoord[0][1]);
-            uv2 = Vector2(face.TexCoord[1][0], face.TexCoord[1][1]);
-            uv3 = Vector2(face.TexCoord[2][0], face.TexCoord[2][1]);
+            uv2 = Vector2(face.TexCoord[j][0], face.TexCoord[j][1]);
+            uv3 = Vector2(face.TexCoord[j + 1][0], face.TexCoord[j + 1][1]);
         }
         faceVerts.Push({ idx1, uv1 });
         faceVerts.Push({ idx2, uv2 });
         faceVerts.Push({ idx3, uv3 });
     }
+}
 
-    if (updatingUv_)
-    {
-        for (const auto& vert : faceVerts)
-            uvs_.Push(vert.uv);
-    }
-    else
+unsigned PodGeometryGen::GetFaceVertexCount(const FaceData& face)
+{
+    return face.IsVisible() ? (face.Vertices - 2) * 3 : 0;
+}
+
+void PodGeometryGen::GenerateDataFromFace(const FaceData& face)
+{
+    GetFaceVertices(face, faceVerts_);
+
+    const Vector3* positions = face.Obj->Positions.Buffer();
+    const Vector3* normals = face.Obj->VertexNormals.Buffer();
+    for (const auto& vert : faceVerts_)
     {
-        const fp1616_t* vdata = face.Obj->VertexArray.Get();
-        const fp1616_t* normals = face.Obj->Normals.Get();
-        for (const auto& vert : faceVerts)
+        // Build vertex
+        Vertex v;
+        v.pos = positions[vert.idx];
+        v.normal = normals[vert.idx];
+
+        if (face.Animated)
         {
-            // Build vertex
-            Vertex v;
-            v.pos.x_ = -FloatFromFP1616(vdata[vert.idx * 3 + 1]);
-            v.pos.y_ = FloatFromFP1616(vdata[vert.idx * 3 + 2]);
-            v.pos.z_ = FloatFromFP1616(vdata[vert.idx * 3 + 0]);
-            v.normal.x_ = -FloatFromFP1616(normals[vert.idx * 3 + 1]);
-            v.normal.y_ = FloatFromFP1616(normals[vert.idx * 3 + 2]);
-            v.normal.z_ = FloatFromFP1616(normals[vert.idx * 3 + 0]);
-
-            // Push our own index
+            // Push our own index, the uvs of the face stay contiguous for patching
             unsigned int vertIdx = vertices_.Size();
             indices_.Push(vertIdx);
             vertices_.Push(v);
             uvs_.Push(vert.uv);
         }
+        else
+        {
+            // Welded and indexed by Optimize
+            staticVertices_.Push(v);
+            staticUvs_.Push(vert.uv);
+        }
     }
 }
 
-void PodGeometryGen::SetUpdatingTexCoords(bool b)
+void PodGeometryGen::Reserve(unsigned vertexCount)
+{
+    staticVertices_.Reserve(vertexCount);
+    staticUvs_.Reserve(vertexCount);
+    indices_.Reserve(vertexCount);
+}
+
+/// Key to weld the vertices with identical position, normal and uv.
+struct WeldVertex
 {
-    updatingUv_ = b;
-    if (b)
+    PodGeometryGen::Vertex vertex;
+    Vector2 uv;
+
+    bool operator ==(const WeldVertex& rhs) const
     {
-        updatingUvIdx_ = 0;
-        uvs_.Clear();
+        return vertex.pos == rhs.vertex.pos && vertex.normal == rhs.vertex.normal && uv == rhs.uv;
     }
+
+    unsigned ToHash() const
+    {
+        unsigned hash = 0;
+        const unsigned char* data = reinterpret_cast<const unsigned char*>(this);
+        for (unsigned i = 0; i < sizeof(WeldVertex); i++)
+            hash = SDBMHash(hash, data[i]);
+        return hash;
+    }
+};
+
+/// Reorder the triangles for the post-transform vertex cache, with the Tipsify algorithm (Sander et al. 2007).
+static void OptimizeVertexCache(PODVector<unsigned>& indices, unsigned vertexCount)
+{
+    unsigned triangleCount = indices.Size() / 3;
+    if (triangleCount < 2)
+        return;
+
+    // Triangles using each vertex
+    PODVector<unsigned> liveCount(vertexCount, 0);
+    for (unsigned index : indices)
+        liveCount[index]++;
+    PODVector<unsigned> adjacencyStart(vertexCount + 1);
+    adjacencyStart[0] = 0;
+    for (unsigned i = 0; i < vertexCount; i++)
+        adjacencyStart[i + 1] = adjacencyStart[i] + liveCount[i];
+    PODVector<unsigned> adjacency(indices.Size());
+    PODVector<unsigned> fill(adjacencyStart.Buffer(), vertexCount);
+    for (unsigned i = 0; i < indices.Size(); i++)
+        adjacency[fill[indices[i]]++] = i / 3;
+
+    PODVector<unsigned> cacheTime(vertexCount, 0);
+    PODVector<bool> emitted(triangleCount, false);
+    PODVector<unsigned> deadEnd;
+    PODVector<unsigned> candidates;
+    PODVector<unsigned> output;
+    output.Reserve(indices.Size());
+
+    unsigned time = VERTEX_CACHE_SIZE + 1;
+    unsigned cursor = 0;
+    int fanning = 0;
+    while (fanning >= 0)
+    {
+        // Emit all the remaining triangles around the fanning vertex
+        candidates.Clear();
+        for (unsigned i = adjacencyStart[fanning]; i < adjacencyStart[fanning + 1]; i++)
+        {
+            unsigned triangle = adjacency[i];
+            if (emitted[triangle])
+                continue;
+
+            for (unsigned j = 0; j < 3; j++)
+            {
+                unsigned vertex = indices[triangle * 3 + j];
+                output.Push(vertex);
+                deadEnd.Push(vertex);
+                candidates.Push(vertex);
+                liveCount[vertex]--;
+                if (time - cacheTime[vertex] > VERTEX_CACHE_SIZE)
+                    cacheTime[vertex] = time++;
+            }
+            emitted[triangle] = true;
+        }
+
+        // Continue with the candidate staying longest in the cache while its triangles are emitted
+        fanning = -1;
+        int bestPriority = -1;
+        for (unsigned vertex : candidates)
+        {
+            if (!liveCount[vertex])
+                continue;
+
+            int priority = 0;
+            if (time - cacheTime[vertex] + 2 * liveCount[vertex] <= VERTEX_CACHE_SIZE)
+                priority = time - cacheTime[vertex];
+            if (priority > bestPriority)
+            {
+                bestPriority = priority;
+                fanning = vertex;
+            }
+        }
+
+        // Dead end: use a recently referenced vertex, or the next vertex with triangles left
+        while (fanning < 0 && !deadEnd.Empty())
+        {
+            unsigned vertex = deadEnd.Back();
+            deadEnd.Pop();
+            if (liveCount[vertex])
+                fanning = vertex;
+        }
+        while (fanning < 0 && cursor < vertexCount)
+        {
+            if (liveCount[cursor])
+                fanning = cursor;
+            cursor++;
+        }
+    }
+
+    indices.Swap(output);
 }
 
-SharedPtr<Geometry> PodGeometryGen::Commit()
+void PodGeometryGen::Optimize()
 {
-    if (updatingUv_)
+    // Weld the static vertices
+    HashMap<WeldVertex, unsigned> weldMap;
+    Vector<Vertex> weldedVertices;
+    Vector<Vector2> weldedUvs;
+    PODVector<unsigned> weldedIndices(staticVertices_.Size());
+    for (unsigned i = 0; i < staticVertices_.Size(); i++)
     {
-        uvBuffer_->SetData(uvs_.Buffer());
-        return geometry_;
+        WeldVertex key = { staticVertices_[i], staticUvs_[i] };
+        auto it = weldMap.Find(key);
+        if (it == weldMap.End())
+        {
+            it = weldMap.Insert(MakePair(key, weldedVertices.Size()));
+            weldedVertices.Push(staticVertices_[i]);
+            weldedUvs.Push(staticUvs_[i]);
+        }
+        weldedIndices[i] = it->second_;
+    }
+
+    OptimizeVertexCache(weldedIndices, weldedVertices.Size());
+
+    // Lay out the welded vertices in first use order, after the vertices of the animated faces
+    PODVector<unsigned> remap(weldedVertices.Size(), M_MAX_UNSIGNED);
+    for (unsigned index : weldedIndices)
+    {
+        if (remap[index] == M_MAX_UNSIGNED)
+        {
+            remap[index] = vertices_.Size();
+            vertices_.Push(weldedVertices[index]);
+            uvs_.Push(weldedUvs[index]);
+        }
+        indices_.Push(remap[index]);
+    }
+
+    staticVertices_.Clear();
+    staticUvs_.Clear();
+}
+
+void PodGeometryGen::InvalidateFaceTexCoords(const FaceData& face, unsigned start, unsigned count)
+{
+    if (count)
+        dirtyUvRanges_.Push({ &face, start, count });
+}
+
+void PodGeometryGen::CommitTexCoords()
+{
+    if (dirtyUvRanges_.Empty())
+        return;
+
+    Sort(dirtyUvRanges_.Begin(), dirtyUvRanges_.End(),
+        [](const FaceRange& lhs, const FaceRange& rhs) { return lhs.start < rhs.start; });
+
+    unsigned rangeStart = dirtyUvRanges_[0].start;
+    unsigned rangeEnd = rangeStart;
+    for (const auto& range : dirtyUvRanges_)
+    {
+        // Upload the pending range once the next face does not touch it
+        if (range.start > rangeEnd)
+        {
+            uvBuffer_->SetDataRange(&uvs_[rangeStart], rangeStart, rangeEnd - rangeStart);
+            rangeStart = range.start;
+        }
+        rangeEnd = Max(rangeEnd, range.start + range.count);
+
+        GetFaceVertices(*range.face, faceVerts_);
+        for (unsigned i = 0; i < faceVerts_.Size(); i++)
+            uvs_[range.start + i] = faceVerts_[i].uv;
     }
+    uvBuffer_->SetDataRange(&uvs_[rangeStart], rangeStart, rangeEnd - rangeStart);
+
+    dirtyUvRanges_.Clear();
+}
 
+SharedPtr<Geometry> PodGeometryGen::Commit()
+{
     BoundingBox bounds;
     for (unsigned int i = 0; i < vertices_.Size(); i++)
     {
@@ -142,9 +309,21 @@ SharedPtr<Geometry> PodGeometryGen::Commit()
     uvBuffer_->SetSize(uvs_.Size(), { VertexElement(TYPE_VECTOR2, SEM_TEXCOORD) }, true);
     uvBuffer_->SetData(uvs_.Buffer());
 
+    // Use 16-bit indices unless the vertices can not be addressed with them
     indexBuffer_->SetShadowed(true);
-    indexBuffer_->SetSize(indices_.Size(), false);
-    indexBuffer_->SetData(indices_.Buffer());
+    if (vertices_.Size() > MAX_SHORT_INDEXED_VERTICES)
+    {
+        indexBuffer_->SetSize(indices_.Size(), true);
+        indexBuffer_->SetData(indices_.Buffer());
+    }
+    else
+    {
+        PODVector<unsigned short> shortIndices(indices_.Size());
+        for (unsigned i = 0; i < indices_.Size(); i++)
+            shortIndices[i] = (unsigned short)indices_[i];
+        indexBuffer_->SetSize(shortIndices.Size(), false);
+        indexBuffer_->SetData(shortIndices.Buffer());
+    }
 
     geometry_->SetNumVertexBuffers(2);
     geometry_->SetVertexBuffer(0, vertexBuffer_);
@@ -154,10 +333,168 @@ SharedPtr<Geometry> PodGeometryGen::Commit()
     return geometry_;
 }
 
+void PodGeometryGen::Save(Serializer& dest) const
+{
+    dest.WriteUInt(vertices_.Size());
+    dest.Write(vertices_.Buffer(), vertices_.Size() * sizeof(Vertex));
+    dest.WriteUInt(uvs_.Size());
+    dest.Write(uvs_.Buffer(), uvs_.Size() * sizeof(Vector2));
+    dest.WriteUInt(indices_.Size());
+    dest.Write(indices_.Buffer(), indices_.Size() * sizeof(unsigned));
+}
+
+bool PodGeometryGen::Load(Deserializer& source)
+{
+    vertices_.Resize(source.ReadUInt());
+    unsigned size = vertices_.Size() * sizeof(Vertex);
+    bool success = source.Read(vertices_.Buffer(), size) == size;
+
+    uvs_.Resize(source.ReadUInt());
+    size = uvs_.Size() * sizeof(Vector2);
+    success &= source.Read(uvs_.Buffer(), size) == size;
+
+    indices_.Resize(source.ReadUInt());
+    size = indices_.Size() * sizeof(unsigned);
+    success &= source.Read(indices_.Buffer(), size) == size;
+
+    if (!success)
+        Clear();
+    return success;
+}
+
+void PodGeometryGen::Clear()
+{
+    vertices_.Clear();
+    uvs_.Clear();
+    indices_.Clear();
+    staticVertices_.Clear();
+    staticUvs_.Clear();
+    dirtyUvRanges_.Clear();
+    partStarts_.Clear();
+}
+
+SharedPtr<Image> CreateImageFromRGB565(Context* context, const unsigned short* pixels, int width, int height)
+{
+    SharedPtr<Image> image(new Image(context));
+    image->SetSize(width, height, 4);
+
+    // Expand the 5 and 6 bit channels to 8 bits like ColorFromRGB565, writing RGBA bytes
+    unsigned count = (unsigned)(width * height);
+    unsigned char* dest = image->GetData();
+    unsigned i = 0;
+#ifdef URHO3D_SSE
+    const __m128i mask5 = _mm_set1_epi16(0x1f);
+    const __m128i mask6 = _mm_set1_epi16(0x3f);
+    const __m128i alpha = _mm_set1_epi16((short)0xff00);
+    for (; i + 8 <= count; i += 8)
+    {
+        __m128i pix = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels + i));
+        __m128i r = _mm_srli_epi16(pix, 11);
+        __m128i g = _mm_and_si128(_mm_srli_epi16(pix, 5), mask6);
+        __m128i b = _mm_and_si128(pix, mask5);
+        r = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(r, _mm_set1_epi16(527)), _mm_set1_epi16(23)), 6);
+        g = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(g, _mm_set1_epi16(259)), _mm_set1_epi16(33)), 6);
+        b = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(b, _mm_set1_epi16(527)), _mm_set1_epi16(23)), 6);
+
+        __m128i rg = _mm_or_si128(r, _mm_slli_epi16(g, 8));
+        __m128i ba = _mm_or_si128(b, alpha);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i * 4), _mm_unpacklo_epi16(rg, ba));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i * 4 + 16), _mm_unpackhi_epi16(rg, ba));
+    }
+#endif
+    for (; i < count; i++)
+    {
+        unsigned short pix = pixels[i];
+        dest[i * 4 + 0] = (unsigned char)((((pix >> 11) & 0x1f) * 527 + 23) >> 6);
+        dest[i * 4 + 1] = (unsigned char)((((pix >> 5) & 0x3f) * 259 + 33) >> 6);
+        dest[i * 4 + 2] = (unsigned char)(((pix & 0x1f) * 527 + 23) >> 6);
+        dest[i * 4 + 3] = 0xff;
+    }
+    return image;
+}
+
+PodTextureSet::PodTextureSet(Context* ctx, const TextureList& list)
+    : context_(ctx)
+    , textureList_(&list)
+    , textures_(list.Count)
+{
+}
+
+Texture2D* PodTextureSet::GetTexture(unsigned index)
+{
+    if (index >= textures_.Size())
+        return nullptr;
+    if (textures_[index])
+        return textures_[index];
+    // In headless mode there are no textures, like the textures loaded by the engine
+    if (!context_->GetSubsystem<Graphics>())
+        return nullptr;
+
+    const unsigned short* pixels = textureList_->PixelData.Get()[index].Pixels.Get();
+    unsigned format = nativeRGB565_ ? Graphics::GetRGB565Format() : 0;
+    if (format)
+        textures_[index] = CreateRGB565Texture(pixels, format);
+    else
+    {
+        SharedPtr<Image> image;
+        if (images_ && index < images_->Size())
+            image = (*images_)[index];
+        else
+            image = CreateImageFromRGB565(context_, pixels, textureList_->Width, textureList_->Height);
+
+        textures_[index] = new Texture2D(context_);
+        textures_[index]->SetData(image);
+    }
+    return textures_[index];
+}
+
+SharedPtr<Texture2D> PodTextureSet::CreateRGB565Texture(const unsigned short* pixels, unsigned format)
+{
+    int width = textureList_->Width;
+    int height = textureList_->Height;
+
+    SharedPtr<Texture2D> texture(new Texture2D(context_));
+    texture->SetSize(width, height, format);
+
+    PODVector<unsigned short> level(pixels, (unsigned)(width * height));
+    PODVector<unsigned short> nextLevel;
+    for (unsigned i = 0; i < texture->GetLevels(); i++)
+    {
+        texture->SetData(i, 0, 0, width, height, level.Buffer());
+        if (width == 1 && height == 1)
+            break;
+
+        // Box filter the next level, averaging the channels separately
+        int nextWidth = Max(width / 2, 1);
+        int nextHeight = Max(height / 2, 1);
+        nextLevel.Resize((unsigned)(nextWidth * nextHeight));
+        for (int y = 0; y < nextHeight; y++)
+        {
+            for (int x = 0; x < nextWidth; x++)
+            {
+                unsigned r = 0, g = 0, b = 0;
+                for (int j = 0; j < 4; j++)
+                {
+                    int sx = Min(x * 2 + (j & 1), width - 1);
+                    int sy = Min(y * 2 + (j >> 1), height - 1);
+                    unsigned short pix = level[sy * width + sx];
+                    r += pix >> 11;
+                    g += (pix >> 5) & 0x3f;
+                    b += pix & 0x1f;
+                }
+                nextLevel[y * nextWidth + x] = (unsigned short)(((r + 2) / 4) << 11 | ((g + 2) / 4) << 5 | (b + 2) / 4);
+            }
+        }
+        level.Swap(nextLevel);
+        width = nextWidth;
+        height = nextHeight;
+    }
+    return texture;
+}
 
 PodModelGen::PodModelGen(Context* ctx, const TextureList& tl)
     : context_(ctx)
-    , textureList_(&tl)
+    , textureSet_(new PodTextureSet(ctx, tl))
     , calcBounds_(true)
     , bmin_(Vector3(100000.0f, 100000.0f, 100000.0f))
     , bmax_(Vector3(-100000.0f, -100000.0f, -100000.0f))
@@ -165,21 +502,32 @@ PodModelGen::PodModelGen(Context* ctx, const TextureList& tl)
 }
 
 void PodModelGen::AddObject(const ObjectData& obj)
+{
+    AddFaces(obj, 0);
+}
+
+void PodModelGen::AddObject(const ObjectData& obj, unsigned part)
+{
+    numParts_ = Max(numParts_, part + 1);
+    AddFaces(obj, part);
+}
+
+void PodModelGen::AddFaces(const ObjectData& obj, unsigned part)
 {
     for (int fi = 0; fi < obj.FaceCount; fi++)
     {
         auto& face = obj.FaceData.Get()[fi];
-        if (face.MaterialType == "GOURAUD" || face.MaterialType == "FLAT")
-        {
-            colorMaterials_[face.ColorOrTexIndex].faces.Push(&face);
-            colorGeometries_.Push(UniquePtr<PodGeometryGen>(new PodGeometryGen(context_)));
-        }
-        else
-        {
-            textureMaterials_[face.ColorOrTexIndex].faces.Push(&face);
-            textureGeometries_.Push(UniquePtr<PodGeometryGen>(new PodGeometryGen(context_)));
-        }
+        MaterialFaceList& list = face.MaterialType == "GOURAUD" || face.MaterialType == "FLAT" ?
+            colorMaterials_[face.ColorOrTexIndex] : textureMaterials_[face.ColorOrTexIndex];
+        list.faces.Push(&face);
+        list.parts.Push(part);
     }
+
+    // One geometry per material
+    while (textureGeometries_.Size() < textureMaterials_.Size())
+        textureGeometries_.Push(UniquePtr<PodGeometryGen>(new PodGeometryGen(context_)));
+    while (colorGeometries_.Size() < colorMaterials_.Size())
+        colorGeometries_.Push(UniquePtr<PodGeometryGen>(new PodGeometryGen(context_)));
 }
 
 void PodModelGen::SetBounds(const Vector3& min, const Vector3& max)
@@ -189,53 +537,123 @@ void PodModelGen::SetBounds(const Vector3& min, const Vector3& max)
     bmax_ = max;
 }
 
+void PodModelGen::InvalidateTexCoords()
+{
+    for (const auto& pair : faceLocations_)
+        InvalidateFaceTexCoords(*pair.first_);
+}
+
+void PodModelGen::InvalidateFaceTexCoords(const FaceData& face)
+{
+    // Before the model is generated, the face is generated with its current coordinates anyway
+    auto it = faceLocations_.Find(&face);
+    if (it == faceLocations_.End())
+        return;
+
+    const FaceLocation& location = it->second_;
+    if (location.gen->dirtyUvRanges_.Empty())
+        dirtyGeometries_.Push(location.gen);
+    location.gen->InvalidateFaceTexCoords(face, location.start, location.count);
+}
+
 void PodModelGen::UpdateTexCoords()
 {
-    if (!uvDirty_) return;
+    for (PodGeometryGen* gen : dirtyGeometries_)
+        gen->CommitTexCoords();
+    dirtyGeometries_.Clear();
+}
 
-    int gi = 0;
-    for (const auto& pair : textureMaterials_)
+unsigned PodModelGen::GetVertexCount(const Vector<FaceData*>& faces)
+{
+    unsigned count = 0;
+    for (const FaceData* face : faces)
+        count += PodGeometryGen::GetFaceVertexCount(*face);
+    return count;
+}
+
+void PodModelGen::AddFaceLocations(PodGeometryGen& gen, const Vector<FaceData*>& faces)
+{
+    // Only the animated faces have their own vertices, at the start of the geometry in face order
+    unsigned start = 0;
+    for (const FaceData* face : faces)
     {
-        auto& faces = pair.second_.faces;
-        auto& gen = *textureGeometries_[gi++];
-        gen.SetUpdatingTexCoords(true);
-        for (int i = 0; i < faces.Size(); i++)
-            gen.GenerateDataFromFace(*faces[i]);
-        gen.Commit();
+        unsigned count = face->Animated ? PodGeometryGen::GetFaceVertexCount(*face) : 0;
+        faceLocations_[face] = { &gen, start, count };
+        start += count;
     }
+}
+
+void PodModelGen::GenerateGeometry()
+{
+    if (generated_) return;
+
+    int gi = 0;
+    for (const auto& pair : textureMaterials_)
+        GenerateGeometry(*textureGeometries_[gi++], pair.second_);
 
     gi = 0;
     for (const auto& pair : colorMaterials_)
+        GenerateGeometry(*colorGeometries_[gi++], pair.second_);
+
+    generated_ = true;
+}
+
+void PodModelGen::GenerateGeometry(PodGeometryGen& gen, const MaterialFaceList& list)
+{
+    if (numParts_)
     {
-        auto& faces = pair.second_.faces;
-        auto& gen = *colorGeometries_[gi++];
-        gen.SetUpdatingTexCoords(true);
-        for (int i = 0; i < faces.Size(); i++)
-            gen.GenerateDataFromFace(*faces[i]);
-        gen.Commit();
+        GeneratePartGeometry(gen, list);
+        return;
     }
 
-    uvDirty_ = false;
+    const Vector<FaceData*>& faces = list.faces;
+    AddFaceLocations(gen, faces);
+    if (baked_)
+        return;
+
+    gen.Reserve(GetVertexCount(faces));
+    for (int i = 0; i < faces.Size(); i++)
+        gen.GenerateDataFromFace(*faces[i]);
+    gen.Optimize();
+}
+
+void PodModelGen::GeneratePartGeometry(PodGeometryGen& gen, const MaterialFaceList& list)
+{
+    const Vector<FaceData*>& faces = list.faces;
+    gen.Reserve(GetVertexCount(faces));
+    gen.partStarts_.Resize(numParts_ + 1);
+
+    unsigned fi = 0;
+    for (unsigned part = 0; part < numParts_; part++)
+    {
+        gen.partStarts_[part] = gen.indices_.Size();
+        for (; fi < faces.Size() && list.parts[fi] == part; fi++)
+        {
+            // The vertices of an animated face are added as it is generated, after the previous parts
+            const FaceData& face = *faces[fi];
+            unsigned count = face.Animated ? PodGeometryGen::GetFaceVertexCount(face) : 0;
+            faceLocations_[&face] = { &gen, gen.vertices_.Size(), count };
+            gen.GenerateDataFromFace(face);
+        }
+        gen.Optimize();
+    }
+    gen.partStarts_[numParts_] = gen.indices_.Size();
 }
 
 SharedPtr<Model> PodModelGen::GetModel()
 {
     if (model_) return model_;
 
+    GenerateGeometry();
+
     BoundingBox bounds = { };
     Vector<SharedPtr<Geometry>> geoms;
     int gi = 0;
     for (const auto& pair : textureMaterials_)
     {
         unsigned int texIndex = pair.first_;
-        auto& faces = pair.second_.faces;
 
         PodGeometryGen& gen = *textureGeometries_[gi++];
-        gen.SetUpdatingTexCoords(false);
-        for (int i = 0; i < faces.Size(); i++)
-        {
-            gen.GenerateDataFromFace(*faces[i]);
-        }
         geoms.Push(gen.Commit());
         if (calcBounds_)
         {
@@ -244,23 +662,10 @@ SharedPtr<Model> PodModelGen::GetModel()
         }
 
         {
-            // Create material
-            auto image = new Image(context_);
-            auto& pixels = textureList_->PixelData.Get()[texIndex].Pixels;
-            image->SetSize(textureList_->Width, textureList_->Height, 4);
-            for (int y = 0; y < textureList_->Height; y++)
-            {
-                for (int x = 0; x < textureList_->Width; x++)
-                {
-                    image->SetPixel(x, y, ColorFromRGB565(pixels.Get()[y * textureList_->Width + x]));
-                }
-            }
-            auto texture = new Texture2D(context_);
-            texture->SetData(image);
-
+            // Create material, the texture is shared by all materials using the same texture index
             SharedPtr<Material> mat(new Material(context_));
             mat->SetCullMode(CULL_NONE);
-            mat->SetTexture(TU_DIFFUSE, texture);
+            mat->SetTexture(TU_DIFFUSE, textureSet_->GetTexture(texIndex));
             mat->SetTechnique(0, context_->GetSubsystem<ResourceCache>()->GetResource<Technique>("Techniques/Diff.xml"));
             materials_.Push(mat);
         }
@@ -270,14 +675,8 @@ SharedPtr<Model> PodModelGen::GetModel()
     for (const auto& pair : colorMaterials_)
     {
         unsigned int color = pair.first_;
-        auto& faces = pair.second_.faces;
 
         PodGeometryGen& gen = *colorGeometries_[gi++];
-        gen.SetUpdatingTexCoords(false);
-        for (int i = 0; i < faces.Size(); i++)
-        {
-            gen.GenerateDataFromFace(*faces[i]);
-        }
         geoms.Push(gen.Commit());
         if (calcBounds_)
         {
@@ -321,3 +720,71 @@ SharedPtr<Model> PodModelGen::GetModel()
     return model_;
 }
 
+void PodModelGen::CreatePartGeometries(unsigned firstPart, unsigned numParts, Vector<SharedPtr<Geometry>>& geometries,
+    Vector<SharedPtr<Material>>& materials, BoundingBox& bounds)
+{
+    // Uploads the shared buffers and creates the materials on first use
+    GetModel();
+
+    unsigned numTextureGeometries = textureGeometries_.Size();
+    for (unsigned i = 0; i < materials_.Size(); i++)
+    {
+        PodGeometryGen& gen = i < numTextureGeometries ? *textureGeometries_[i] :
+            *colorGeometries_[i - numTextureGeometries];
+        unsigned start = gen.partStarts_[firstPart];
+        unsigned count = gen.partStarts_[firstPart + numParts] - start;
+        if (!count)
+            continue;
+
+        SharedPtr<Geometry> geometry(new Geometry(context_));
+        geometry->SetNumVertexBuffers(2);
+        geometry->SetVertexBuffer(0, gen.vertexBuffer_);
+        geometry->SetVertexBuffer(1, gen.uvBuffer_);
+        geometry->SetIndexBuffer(gen.indexBuffer_);
+        geometry->SetDrawRange(TRIANGLE_LIST, start, count);
+        geometries.Push(geometry);
+        materials.Push(materials_[i]);
+
+        for (unsigned j = start; j < start + count; j++)
+            bounds.Merge(gen.vertices_[gen.indices_[j]].pos);
+    }
+}
+
+void PodModelGen::Save(Serializer& dest)
+{
+    GenerateGeometry();
+
+    dest.WriteUInt(textureMaterials_.Size());
+    for (unsigned i = 0; i < textureMaterials_.Size(); i++)
+        textureGeometries_[i]->Save(dest);
+
+    dest.WriteUInt(colorMaterials_.Size());
+    for (unsigned i = 0; i < colorMaterials_.Size(); i++)
+        colorGeometries_[i]->Save(dest);
+}
+
+bool PodModelGen::Load(Deserializer& source)
+{
+    // The baked data has no part ranges
+    if (numParts_)
+        return false;
+
+    // The geometries must match the material face lists built by AddObject
+    baked_ = source.ReadUInt() == textureMaterials_.Size();
+    for (unsigned i = 0; baked_ && i < textureMaterials_.Size(); i++)
+        baked_ = textureGeometries_[i]->Load(source);
+
+    baked_ = baked_ && source.ReadUInt() == colorMaterials_.Size();
+    for (unsigned i = 0; baked_ && i < colorMaterials_.Size(); i++)
+        baked_ = colorGeometries_[i]->Load(source);
+
+    if (!baked_)
+    {
+        // Drop any partially read geometry, it is generated from the faces instead
+        for (auto& gen : textureGeometries_)
+            gen->Clear();
+        for (auto& gen : colorGeometries_)
+            gen->Clear();
+    }
+    return baked_;
+}
@@ -12,6 +12,8 @@
 
 using namespace Urho3D;
 
+namespace Urho3D { class Serializer; class Deserializer; }
+
 struct ObjectData;
 struct FaceData;
 struct TextureList;
@@ -25,14 +27,53 @@ struct PodGeometryGen
         Vector3 normal;
     };
 
+    /// Vertex of a triangulated face: index into the object vertex array and texture coordinate.
+    struct FaceVertex
+    {
+        unsigned int idx;
+        Vector2 uv;
+    };
+
+    /// Range of the uv buffer holding the vertices of a face.
+    struct FaceRange
+    {
+        const FaceData* face;
+        unsigned start;
+        unsigned count;
+    };
+
     explicit PodGeometryGen(Context* ctx);
 
+    /// Return the number of vertices GenerateDataFromFace creates for the face.
+    static unsigned GetFaceVertexCount(const FaceData& face);
+
+    /// Reserve space for the given number of generated vertices.
+    void Reserve(unsigned vertexCount);
+
+    /// Generate the vertices of a face. Animated faces get their own vertices, the others are shared by Optimize.
     void GenerateDataFromFace(const FaceData& face);
 
-    void SetUpdatingTexCoords(bool b);
+    /// Weld the identical vertices of the non animated faces and reorder their triangles for the vertex cache.
+    /// Called once after all faces are generated.
+    void Optimize();
+
+    /// Mark the uvs of a face, located at start in the uv buffer, to be regenerated by CommitTexCoords.
+    void InvalidateFaceTexCoords(const FaceData& face, unsigned start, unsigned count);
+
+    /// Regenerate the uvs of the invalidated faces and upload them, merging neighbouring ranges.
+    void CommitTexCoords();
 
     SharedPtr<Geometry> Commit();
 
+    /// Write the generated vertex, uv and index data to a baked circuit cache.
+    void Save(Serializer& dest) const;
+
+    /// Read vertex, uv and index data written by Save, instead of generating it from the faces.
+    bool Load(Deserializer& source);
+
+    /// Remove all generated data.
+    void Clear();
+
     void GetBounds(Vector3& min, Vector3& max) { min = bmin_; max = bmax_; }
 
     Vector3 bmin_, bmax_;
@@ -43,10 +84,42 @@ struct PodGeometryGen
     SharedPtr<Geometry> geometry_;
     Vector<Vertex> vertices_;
     Vector<Vector2> uvs_;
-    PODVector<unsigned short> indices_;
+    /// Indices, uploaded as 16-bit when the vertex count allows it.
+    PODVector<unsigned> indices_;
+    Vector<Vertex> staticVertices_;
+    Vector<Vector2> staticUvs_;
+    PODVector<FaceRange> dirtyUvRanges_;
+    /// Scratch vertices of the face being generated, per generator as the circuit geometries are generated in parallel.
+    PODVector<FaceVertex> faceVerts_;
+    /// Index start of each part and the index count after the last one, when the faces are generated by part.
+    PODVector<unsigned> partStarts_;
     unsigned int indexOffset_ = 0;
-    bool updatingUv_ = false;
-    unsigned int updatingUvIdx_ = 0;
+};
+
+/// Textures of a texture list, created once per texture index and shared by all the materials using them.
+class PodTextureSet : public RefCounted
+{
+public:
+    PodTextureSet(Context* ctx, const TextureList& list);
+
+    /// Use already converted images, indexed like the texture list, instead of converting the texture list pixels.
+    void SetImages(const Vector<SharedPtr<Image>>* images) { images_ = images; }
+
+    /// Set whether to upload the RGB565 pixels as is when the graphics API supports it, halving the texture memory.
+    void SetNativeRGB565(bool enable) { nativeRGB565_ = enable; }
+
+    /// Return the texture of a texture list index, created on first use.
+    Texture2D* GetTexture(unsigned index);
+
+private:
+    /// Create a RGB565 texture with box filtered mip levels.
+    SharedPtr<Texture2D> CreateRGB565Texture(const unsigned short* pixels, unsigned format);
+
+    Context* context_;
+    const TextureList* textureList_;
+    const Vector<SharedPtr<Image>>* images_ = nullptr;
+    Vector<SharedPtr<Texture2D>> textures_;
+    bool nativeRGB565_ = false;
 };
 
 struct PodModelGen
@@ -54,32 +127,90 @@ struct PodModelGen
     struct MaterialFaceList
     {
         Vector<FaceData*> faces;
+        /// Part of each face.
+        PODVector<unsigned> parts;
     };
 
     explicit PodModelGen(Context* ctx, const TextureList& list);
 
+    /// Add the faces of an object. Several objects can be added, their faces are merged by material.
     void AddObject(const ObjectData& obj);
 
+    /// Add the faces of an object to a part. The triangles of each part are kept in their own index range of the
+    /// geometries, to draw any run of consecutive parts from the same buffers. Add the parts in increasing order.
+    void AddObject(const ObjectData& obj, unsigned part);
+
     void SetBounds(const Vector3& min, const Vector3& max);
 
+    /// Upload the uvs of the faces invalidated since the last update.
     void UpdateTexCoords();
 
-    void InvalidateTexCoords() { uvDirty_ = true; }
+    /// Invalidate the uvs of all faces.
+    void InvalidateTexCoords();
+
+    /// Invalidate the uvs of a single face after its texture coordinates changed.
+    void InvalidateFaceTexCoords(const FaceData& face);
+
+    /// Generate the vertex, uv and index data of all geometries, without creating any GPU resource.
+    /// Can be called from a worker thread.
+    void GenerateGeometry();
 
+    /// Return the model, generating its geometry first if needed. Creates the GPU resources, main thread only.
     SharedPtr<Model> GetModel();
 
     const Vector<SharedPtr<Material>>& GetMaterials() { return materials_; }
 
+    /// Create geometries drawing a run of consecutive parts, one for each material used by the parts, sharing the
+    /// buffers of the model. Appends the geometries and their materials, and merges the parts bounds. Main thread only.
+    void CreatePartGeometries(unsigned firstPart, unsigned numParts, Vector<SharedPtr<Geometry>>& geometries,
+        Vector<SharedPtr<Material>>& materials, BoundingBox& bounds);
+
+    /// Share the textures with other model generators of the same texture list. Set before the model is generated.
+    void SetTextureSet(PodTextureSet* textureSet) { textureSet_ = textureSet; }
+
+    /// Write the generated geometry data to a baked circuit cache. Generates the geometry if not done yet.
+    void Save(Serializer& dest);
+
+    /// Read geometry data written by Save. GetModel then builds the model from it without generating the faces.
+    bool Load(Deserializer& source);
+
 private:
+    /// Location of a face vertices in the geometries.
+    struct FaceLocation
+    {
+        PodGeometryGen* gen;
+        unsigned start;
+        unsigned count;
+    };
+
+    static unsigned GetVertexCount(const Vector<FaceData*>& faces);
+
+    void AddFaceLocations(PodGeometryGen& gen, const Vector<FaceData*>& faces);
+
+    void AddFaces(const ObjectData& obj, unsigned part);
+
+    void GenerateGeometry(PodGeometryGen& gen, const MaterialFaceList& list);
+
+    /// Generate the faces part by part, optimizing each part on its own.
+    void GeneratePartGeometry(PodGeometryGen& gen, const MaterialFaceList& list);
+
     Context* context_;
-    const TextureList* textureList_;
+    SharedPtr<PodTextureSet> textureSet_;
     HashMap<unsigned int, MaterialFaceList> textureMaterials_;
     HashMap<unsigned int, MaterialFaceList> colorMaterials_;
     Vector<SharedPtr<Material>> materials_;
     Vector<UniquePtr<PodGeometryGen>> textureGeometries_;
     Vector<UniquePtr<PodGeometryGen>> colorGeometries_;
+    HashMap<const FaceData*, FaceLocation> faceLocations_;
+    PODVector<PodGeometryGen*> dirtyGeometries_;
     SharedPtr<Model> model_;
     Vector3 bmin_, bmax_;
+    /// Number of parts of the objects added by part, 0 when not using parts.
+    unsigned numParts_ = 0;
     bool calcBounds_;
-    bool uvDirty_ = false;
-};
\ No newline at end of file
+    bool baked_ = false;
+    bool generated_ = false;
+};
+
+/// Convert RGB565 pixels to a RGBA image, with SSE2 when available.
+SharedPtr<Image> CreateImageFromRGB565(Context* context, const unsigned short* pixels, int width, int height);
\ No newline at end of file
@@ -0,0 +1,102 @@
+#include <stdexcept>
+#include <Urho3D/Core/Context.h>
+#include <Urho3D/IO/Deserializer.h>
+#include <Urho3D/IO/Log.h>
+#include "PodResource.h"
+
+PodVehicleResource::PodVehicleResource(Context* context) :
+    Resource(context)
+{
+}
+
+void PodVehicleResource::RegisterObject(Context* context)
+{
+    context->RegisterFactory<PodVehicleResource>();
+}
+
+bool PodVehicleResource::BeginLoad(Deserializer& source)
+{
+    vehicle_ = new PodVehicle(context_, GetName());
+    try
+    {
+        if (!vehicle_->Load(source))
+        {
+            vehicle_.Reset();
+            return false;
+        }
+    }
+    catch (const std::exception& e)
+    {
+        URHO3D_LOGERROR("Could not load vehicle " + GetName() + ": " + e.what());
+        vehicle_.Reset();
+        return false;
+    }
+
+    vehicle_->GenerateGeometry();
+    SetMemoryUse(source.GetSize());
+    return true;
+}
+
+bool PodVehicleResource::EndLoad()
+{
+    vehicle_->CreateModels();
+    return true;
+}
+
+PodCircuitResource::PodCircuitResource(Context* context) :
+    Resource(context)
+{
+}
+
+void PodCircuitResource::RegisterObject(Context* context)
+{
+    context->RegisterFactory<PodCircuitResource>();
+}
+
+bool PodCircuitResource::BeginLoad(Deserializer& source)
+{
+    circuit_ = new PodCircuit(context_, GetName());
+    circuit_->SetDeferCacheWrite(true);
+    modelGens_.Clear();
+    try
+    {
+        if (!circuit_->LoadCached(source, GetName() + CIRCUIT_CACHE_EXTENSION))
+        {
+            circuit_.Reset();
+            return false;
+        }
+    }
+    catch (const std::exception& e)
+    {
+        URHO3D_LOGERROR("Could not load circuit " + GetName() + ": " + e.what());
+        circuit_.Reset();
+        return false;
+    }
+
+    // The textures and geometry are generated before the cache write, in parallel when loading on the main thread
+    circuit_->PrepareGenerateTasks();
+    circuit_->RunGenerateTasks();
+    circuit_->WritePendingCache();
+    circuit_->GetDrawModelGens(modelGens_);
+
+    try
+    {
+        circuit_->LoadCollision(GetName() + COLLISION_CACHE_EXTENSION);
+    }
+    catch (const std::exception& e)
+    {
+        // The circuit is still drawn, without collision
+        URHO3D_LOGERROR("Could not build collision for circuit " + GetName() + ": " + e.what());
+    }
+
+    SetMemoryUse(source.GetSize());
+    return true;
+}
+
+bool PodCircuitResource::EndLoad()
+{
+    for (PodModelGen* modelGen : modelGens_)
+        modelGen->GetModel();
+    modelGens_.Clear();
+    return true;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <Urho3D/Resource/Resource.h>
+#include "PodCircuit.h"
+#include "PodVehicle.h"
+
+/// Vehicle file loaded through the resource cache, shared by all the vehicles using it. The file is decrypted, parsed
+/// and its geometry generated in BeginLoad, which can run on a background loading thread. The models and textures
+/// are created in EndLoad.
+class PodVehicleResource : public Resource
+{
+    URHO3D_OBJECT(PodVehicleResource, Resource)
+
+public:
+    /// Construct.
+    explicit PodVehicleResource(Context* context);
+
+    /// Register object factory.
+    static void RegisterObject(Context* context);
+
+    /// Load the vehicle file and generate its geometry. Can be called from a worker thread.
+    bool BeginLoad(Deserializer& source) override;
+    /// Create the models and textures. Main thread only.
+    bool EndLoad() override;
+
+    /// Return the vehicle, null if not loaded.
+    PodVehicle* GetVehicle() const { return vehicle_.Get(); }
+
+private:
+    UniquePtr<PodVehicle> vehicle_;
+};
+
+/// Circuit file loaded through the resource cache and its baked and collision caches. The file is decrypted, parsed,
+/// and its geometry and collision generated in BeginLoad, which can run on a background loading thread. The models
+/// and textures are created in EndLoad. Use PodCircuitLoader instead for time sliced uploads with progress events.
+class PodCircuitResource : public Resource
+{
+    URHO3D_OBJECT(PodCircuitResource, Resource)
+
+public:
+    /// Construct.
+    explicit PodCircuitResource(Context* context);
+
+    /// Register object factory.
+    static void RegisterObject(Context* context);
+
+    /// Load the circuit file and generate its geometry and collision. Can be called from a worker thread.
+    bool BeginLoad(Deserializer& source) override;
+    /// Create the models and textures. Main thread only.
+    bool EndLoad() override;
+
+    /// Return the circuit, null if not loaded.
+    PodCircuit* GetCircuit() const { return circuit_.Get(); }
+
+private:
+    UniquePtr<PodCircuit> circuit_;
+    /// Models generated by BeginLoad, created by EndLoad.
+    PODVector<PodModelGen*> modelGens_;
+};
@@ -0,0 +1,258 @@
+#include <cstdio>
+#include <stdexcept>
+#include <Urho3D/Core/ProcessUtils.h>
+#include <Urho3D/Core/Profiler.h>
+#include <Urho3D/Core/StringUtils.h>
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/Core/WorkQueue.h>
+#include <Urho3D/Graphics/Octree.h>
+#include <Urho3D/IO/File.h>
+#include <Urho3D/IO/Log.h>
+#include <Urho3D/Physics/PhysicsWorld.h>
+#include <Urho3D/Physics/RigidBody.h>
+#include <Urho3D/Resource/JSONFile.h>
+#include <Urho3D/Resource/ResourceCache.h>
+#include <Urho3D/Scene/Scene.h>
+#include "PodSimulation.h"
+#include "PodCircuitLoader.h"
+#include "PodTrackProgress.h"
+#include "PodResource.h"
+#include "CircuitComponent.h"
+#include "CompetitorAIComponent.h"
+#include "VehicleComponent.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#endif
+
+static const char* SIMULATION_VEHICLE = "Io/DATA/BINARY/VOITURES/GAMMA.BV4";
+
+/// Height above the circuit path at which the vehicles are spawned.
+static constexpr float SPAWN_HEIGHT = 2.0f;
+/// Distance between the vehicles when the circuit has no path.
+static constexpr float SPAWN_SPACING = 6.0f;
+
+/// Period of the scripted steering, in steps, and the number of steps steered left then right in each period.
+static constexpr unsigned STEER_PERIOD = 240;
+static constexpr unsigned STEER_STEPS = 40;
+
+/// Upload budget large enough to finish the loaded circuit in one update.
+static constexpr long long UNLIMITED_UPLOAD_USEC = 1000000000LL;
+
+/// Return the peak memory used by the process in bytes, or 0 if not available on the platform.
+static unsigned long long GetPeakMemoryUse()
+{
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return counters.PeakWorkingSetSize;
+#elif defined(__linux__)
+    FILE* status = fopen("/proc/self/status", "r");
+    if (status)
+    {
+        char line[256];
+        unsigned long long kiloBytes = 0;
+        while (fgets(line, sizeof(line), status))
+        {
+            if (sscanf(line, "VmHWM: %llu kB", &kiloBytes) == 1)
+                break;
+        }
+        fclose(status);
+        return kiloBytes * 1024;
+    }
+#endif
+    return 0;
+}
+
+/// Return the scripted controls of a vehicle: full throttle, weaving left and right. The vehicles are out of phase
+/// so that they do not all steer together. The script is fixed so that runs are comparable.
+static unsigned GetScriptedButtons(unsigned step, unsigned vehicleIdx)
+{
+    unsigned phase = (step + vehicleIdx * STEER_PERIOD / 7) % STEER_PERIOD;
+    unsigned buttons = CTRL_FORWARD;
+    if (phase < STEER_STEPS)
+        buttons |= CTRL_LEFT;
+    else if (phase >= STEER_PERIOD / 2 && phase < STEER_PERIOD / 2 + STEER_STEPS)
+        buttons |= CTRL_RIGHT;
+    return buttons;
+}
+
+/// Spread the vehicles evenly along the circuit path, facing along it. Without a path they are lined up at the
+/// circuit origin.
+static void GetSpawnTransform(PodCircuit* circuit, unsigned vehicleIdx, unsigned numVehicles, Vector3& position,
+    Quaternion& rotation)
+{
+    const Vector<Vector3>& path = circuit->difficultyForwardNormal_.Path.Positions;
+    if (path.Empty())
+    {
+        position = Vector3(vehicleIdx * SPAWN_SPACING, SPAWN_HEIGHT, 0.0f);
+        rotation = Quaternion::IDENTITY;
+        return;
+    }
+
+    unsigned idx = vehicleIdx * path.Size() / numVehicles;
+    position = path[idx] + Vector3::UP * SPAWN_HEIGHT;
+
+    Vector3 direction = path[(idx + 1) % path.Size()] - path[idx];
+    direction.y_ = 0.0f;
+    rotation = direction.LengthSquared() > M_EPSILON ? Quaternion(Vector3::FORWARD, direction) : Quaternion::IDENTITY;
+}
+
+/// Add the times of a profiler block and its children, named by their path from the root.
+static void AddProfilerBlocks(const ProfilerBlock* block, const String& parentPath, unsigned numSteps,
+    JSONArray& dest)
+{
+    String path = parentPath.Empty() ? String(block->name_) : parentPath + "/" + block->name_;
+
+    JSONValue value;
+    value.Set("block", path);
+    value.Set("count", block->totalCount_);
+    value.Set("total_usec", (double)block->totalTime_);
+    value.Set("step_usec", numSteps ? (double)block->totalTime_ / numSteps : 0.0);
+    value.Set("max_usec", (double)block->totalMaxTime_);
+    dest.Push(value);
+
+    for (const ProfilerBlock* child : block->children_)
+        AddProfilerBlocks(child, path, numSteps, dest);
+}
+
+bool RunPodSimulation(Context* context, const PodSimulationSettings& settings)
+{
+    HiresTimer loadTimer;
+
+    // Load the circuit with the same loader as the editor, waiting for it
+    SharedPtr<PodCircuitLoader> loader(new PodCircuitLoader(context, settings.CircuitFile));
+    loader->SetUseCache(settings.UseCache);
+    loader->Start();
+    auto* queue = context->GetSubsystem<WorkQueue>();
+    if (!queue->GetNumThreads())
+        queue->Complete(0);
+    while (!loader->Update(UNLIMITED_UPLOAD_USEC))
+        Time::Sleep(1);
+    if (!loader->IsLoaded())
+        return false;
+    UniquePtr<PodCircuit> circuit(loader->DetachCircuit());
+
+    // All the vehicles share the same resource, loaded once
+    SharedPtr<PodVehicleResource> vehicle(context->GetSubsystem<ResourceCache>()->GetResource<PodVehicleResource>(
+        SIMULATION_VEHICLE));
+    if (!vehicle)
+        return false;
+
+    SharedPtr<Scene> scene(new Scene(context));
+    scene->CreateComponent<Octree>();
+    auto* physicsWorld = scene->CreateComponent<PhysicsWorld>();
+
+    auto* circuitComponent = scene->CreateChild("Circuit")->CreateComponent<CircuitComponent>();
+    circuitComponent->SetPodCircuit(circuit.Get());
+
+    // Drives the vehicles from the physics pre-step, so that its controls apply in the same physics step
+    CompetitorAIComponent* competitorAI = nullptr;
+    if (settings.UseAI)
+    {
+        competitorAI = scene->CreateComponent<CompetitorAIComponent>();
+        competitorAI->SetPodCircuit(circuit.Get());
+    }
+
+    PODVector<VehicleComponent*> vehicles;
+    PODVector<VehicleComponent*> scriptedVehicles;
+    for (unsigned i = 0; i < settings.NumVehicles; i++)
+    {
+        Vector3 position;
+        Quaternion rotation;
+        GetSpawnTransform(circuit.Get(), i, settings.NumVehicles, position, rotation);
+
+        Node* vehicleNode = scene->CreateChild("Vehicle");
+        vehicleNode->SetPosition(position);
+        vehicleNode->SetRotation(rotation);
+        auto* vehicleComponent = vehicleNode->CreateComponent<VehicleComponent>();
+        vehicleComponent->SetPodVehicle(vehicle.Get());
+        circuitComponent->AddCollisionActivator(vehicleNode);
+        vehicles.Push(vehicleComponent);
+        if (competitorAI)
+            competitorAI->AddCompetitor(vehicleComponent, (CompetitorDifficulty)(i % MAX_COMPETITOR_DIFFICULTIES));
+        else
+            scriptedVehicles.Push(vehicleComponent);
+    }
+
+    PodTrackProgress trackProgress;
+    trackProgress.Build(circuit->difficultyForwardNormal_, circuit->GetRepairZones());
+    PODVector<PodVehicleProgress> progress(vehicles.Size());
+    PODVector<Vector3> positions(vehicles.Size());
+    PODVector<Vector3> velocities(vehicles.Size());
+    PODVector<unsigned> ranking;
+    long long loadUSec = loadTimer.GetUSec(false);
+
+    // One physics step per scene update, run back to back, then the race positions
+    auto* profiler = context->GetSubsystem<Profiler>();
+    float timeStep = 1.0f / physicsWorld->GetFps();
+    HiresTimer runTimer;
+    for (unsigned step = 0; step < settings.NumSteps; step++)
+    {
+        for (unsigned i = 0; i < scriptedVehicles.Size(); i++)
+            scriptedVehicles[i]->controls_.buttons_ = GetScriptedButtons(step, i);
+
+        if (profiler)
+            profiler->BeginFrame();
+        scene->Update(timeStep);
+        {
+            AutoProfileBlock profileBlock(profiler, "UpdateTrackProgress");
+            for (unsigned i = 0; i < vehicles.Size(); i++)
+            {
+                positions[i] = vehicles[i]->GetNode()->GetWorldPosition();
+                velocities[i] = vehicles[i]->GetHullBody()->GetLinearVelocity();
+            }
+            trackProgress.UpdateRanking(progress, positions, velocities, ranking);
+        }
+        if (profiler)
+            profiler->EndFrame();
+    }
+    long long runUSec = runTimer.GetUSec(false);
+    double stepsPerSecond = runUSec ? settings.NumSteps * 1000000.0 / runUSec : 0.0;
+
+    JSONFile results(context);
+    JSONValue& root = results.GetRoot();
+    root.Set("circuit", settings.CircuitFile);
+    root.Set("vehicles", settings.NumVehicles);
+    root.Set("steps", settings.NumSteps);
+    root.Set("time_step", timeStep);
+    root.Set("ai", settings.UseAI);
+    root.Set("load_usec", (double)loadUSec);
+    root.Set("run_usec", (double)runUSec);
+    root.Set("steps_per_second", stepsPerSecond);
+
+    JSONValue memory;
+    memory.Set("resource_bytes", (double)context->GetSubsystem<ResourceCache>()->GetTotalMemoryUse());
+    memory.Set("peak_process_bytes", (double)GetPeakMemoryUse());
+    root.Set("memory", memory);
+
+    JSONArray standings;
+    for (unsigned vehicleIdx : ranking)
+    {
+        const PodVehicleProgress& vehicleProgress = progress[vehicleIdx];
+        JSONValue value;
+        value.Set("vehicle", vehicleIdx);
+        value.Set("lap", vehicleProgress.Lap);
+        value.Set("lap_distance", vehicleProgress.LapDistance);
+        value.Set("wrong_way", vehicleProgress.WrongWay);
+        standings.Push(value);
+    }
+    root.Set("ranking", standings);
+
+    JSONArray blocks;
+    if (profiler)
+        AddProfilerBlocks(profiler->GetRootBlock(), String::EMPTY, settings.NumSteps, blocks);
+    root.Set("profiler", blocks);
+
+    PrintLine(ToString("%s: %u vehicles, %u steps, %.1f steps/s", settings.CircuitFile.CString(), settings.NumVehicles,
+        settings.NumSteps, stepsPerSecond));
+
+    File output(context, settings.OutputFile, FILE_WRITE);
+    if (!output.IsOpen() || !results.Save(output))
+    {
+        URHO3D_LOGERROR("Could not write simulation results " + settings.OutputFile);
+        return false;
+    }
+    return true;
+}
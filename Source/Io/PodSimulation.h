@@ -0,0 +1,27 @@
+#pragma once
+
+#include <Urho3D/Core/Context.h>
+
+using namespace Urho3D;
+
+/// Settings of a headless race simulation, from the -simulate command line options.
+struct PodSimulationSettings
+{
+    /// Circuit file to load, the simulation runs when not empty.
+    String CircuitFile;
+    /// Number of simulated vehicles.
+    unsigned NumVehicles = 8;
+    /// Number of fixed physics steps to run.
+    unsigned NumSteps = 3600;
+    /// File receiving the results as JSON.
+    String OutputFile = "simulation.json";
+    /// Whether the vehicles are driven by the competitor AI instead of the scripted controls.
+    bool UseAI = false;
+    /// Whether to load the circuit through its baked and collision caches.
+    bool UseCache = true;
+};
+
+/// Loads a circuit, spawns vehicles along its path driven by scripted controls or the competitor AI and steps the
+/// scene at the physics rate as fast as possible. Writes the steps per second, the profiler block times and the memory
+/// use to the output file. Returns false if the circuit or the vehicle could not be loaded, or the results could not be written.
+bool RunPodSimulation(Context* context, const PodSimulationSettings& settings);
@@ -0,0 +1,103 @@
+#include "PodTextureAnimator.h"
+
+void PodTextureAnimator::SetPodCircuit(PodCircuit* circ)
+{
+    keys_.Clear();
+    frames_.Clear();
+    tracks_.Clear();
+    faces_.Clear();
+    time_ = 0.0f;
+
+    for (const auto& section : circ->GetTextureAnimations())
+    {
+        // Each animation of the section becomes one track, referenced by index from the faces
+        unsigned firstTrack = tracks_.Size();
+        for (const auto& anim : section.Animations)
+        {
+            unsigned firstKey = keys_.Size();
+            for (const auto& key : anim.Keys)
+            {
+                Key k;
+                for (unsigned i = 0; i < 4; i++)
+                    k.texCoord[i] = key.TexCoord[i];
+                keys_.Push(k);
+            }
+
+            Track track;
+            track.firstFrame = frames_.Size();
+            track.numFrames = anim.Frames.Size();
+            track.loopFrame = -1;
+            track.onceFrame = -1;
+            for (const auto& frame : anim.Frames)
+                frames_.Push({ frame.Time, firstKey + frame.KeyIndex });
+
+            // Loop over the total time, or over the last frame like an attribute animation would
+            track.period = anim.TotalTime;
+            if (track.period <= 0.0f && track.numFrames)
+                track.period = frames_.Back().time;
+            tracks_.Push(track);
+        }
+
+        for (const auto& sectorAnim : section.SectorAnimations)
+        {
+            for (const auto& sec : sectorAnim.Sectors)
+            {
+                auto& modelGen = circ->GetSectorDrawModelGen(sec.SectorIndex);
+                for (const auto& face : sec.Faces)
+                {
+                    FaceData* faceData = circ->GetSectorFace(sec.SectorIndex, face.FaceType, face.FaceIndex);
+                    faces_.Push({ faceData, &modelGen, firstTrack + sectorAnim.AnimIndex, -1, face.Looping != 0 });
+                }
+            }
+        }
+    }
+}
+
+int PodTextureAnimator::FindFrame(const Track& track, float time) const
+{
+    const Frame* frames = frames_.Buffer() + track.firstFrame;
+    if (!track.numFrames || time < frames[0].time)
+        return -1;
+
+    // Frames are sorted by time
+    unsigned low = 0;
+    unsigned high = track.numFrames;
+    while (high - low > 1)
+    {
+        unsigned mid = (low + high) / 2;
+        if (frames[mid].time <= time)
+            low = mid;
+        else
+            high = mid;
+    }
+    return low;
+}
+
+void PodTextureAnimator::Update(float timeStep)
+{
+    if (faces_.Empty())
+        return;
+
+    time_ += timeStep;
+
+    for (auto& track : tracks_)
+    {
+        track.onceFrame = FindFrame(track, time_);
+        track.loopFrame = track.period > 0.0f ? FindFrame(track, Mod(time_, track.period)) : track.onceFrame;
+    }
+
+    for (auto& face : faces_)
+    {
+        const Track& track = tracks_[face.track];
+        int frame = face.looping ? track.loopFrame : track.onceFrame;
+        if (frame == face.frame || frame < 0)
+            continue;
+
+        face.frame = frame;
+        const Key& key = keys_[frames_[track.firstFrame + frame].keyIndex];
+        face.face->UseAnimTexCoord = true;
+        for (unsigned i = 0; i < 4; i++)
+            face.face->AnimTexCoord[i] = key.texCoord[i];
+        face.modelGen->InvalidateFaceTexCoords(*face.face);
+    }
+}
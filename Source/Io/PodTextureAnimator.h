@@ -0,0 +1,58 @@
+#pragma once
+
+#include "PodCircuit.h"
+
+/// Plays the circuit texture animations (Anim2Section) on the sector faces.
+/// All tracks, keys and animated faces are kept in flat arrays and stepped in a single pass per frame.
+class PodTextureAnimator
+{
+public:
+    /// Build the animation data for the circuit, replacing any previous circuit.
+    void SetPodCircuit(PodCircuit* circ);
+
+    /// Advance the animations and patch the uvs of the faces whose key changed.
+    void Update(float timeStep);
+
+    /// Return the number of animated faces.
+    unsigned GetNumFaces() const { return faces_.Size(); }
+
+private:
+    struct Key
+    {
+        Vector2 texCoord[4];
+    };
+
+    struct Frame
+    {
+        float time;
+        unsigned keyIndex;
+    };
+
+    struct Track
+    {
+        unsigned firstFrame;
+        unsigned numFrames;
+        float period;
+        /// Current frame when looping and when played once, -1 before the first frame.
+        int loopFrame;
+        int onceFrame;
+    };
+
+    struct Face
+    {
+        FaceData* face;
+        PodModelGen* modelGen;
+        unsigned track;
+        int frame;
+        bool looping;
+    };
+
+    /// Return the last frame of the track starting at or before time, -1 if none.
+    int FindFrame(const Track& track, float time) const;
+
+    PODVector<Key> keys_;
+    PODVector<Frame> frames_;
+    PODVector<Track> tracks_;
+    PODVector<Face> faces_;
+    float time_ = 0.0f;
+};
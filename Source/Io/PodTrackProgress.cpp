@@ -0,0 +1,118 @@
+#include "PodTrackProgress.h"
+#include <Urho3D/Container/Sort.h>
+
+/// Speed along the track over which the vehicle direction is decided, below it the wrong way state is kept.
+static constexpr float WRONG_WAY_SPEED = 2.0f;
+
+void PodTrackProgress::Build(const PodCircuit::Difficulty& difficulty,
+    const Vector<PodCircuit::RepairZone>& repairZones)
+{
+    const PodCircuit::DifficultyLevel& level = difficulty.Level;
+    if (!level.Config1s.Empty())
+    {
+        // The segments count the remaining track length down to the finish line
+        Vector<Vector3> positions;
+        PODVector<float> distances;
+        for (const PodCircuit::LevelConfig1& segment : level.Config1s)
+        {
+            positions.Push(segment.Position);
+            distances.Push(level.TrackLength - segment.RemainingLength);
+        }
+        track_.Build(positions, distances, level.TrackLength);
+    }
+    else
+        track_.Build(difficulty.Path.Positions);
+
+    repairZones_.Clear();
+    for (const PodCircuit::RepairZone& zone : repairZones)
+    {
+        RepairZoneBounds bounds;
+        bounds.MinY = M_INFINITY;
+        bounds.MaxY = -M_INFINITY;
+        for (unsigned i = 0; i < 4; i++)
+        {
+            bounds.Corners[i] = Vector2(zone.Positions[i].x_, zone.Positions[i].z_);
+            bounds.MinY = Min(bounds.MinY, zone.Positions[i].y_);
+            bounds.MaxY = Max(bounds.MaxY, zone.Positions[i].y_);
+        }
+        bounds.MaxY += zone.Height;
+        repairZones_.Push(bounds);
+    }
+}
+
+void PodTrackProgress::Update(PodVehicleProgress& progress, const Vector3& position, const Vector3& velocity) const
+{
+    if (track_.IsEmpty())
+        return;
+
+    float length = track_.GetLength();
+    PodCircuitPath::Projection nearest = track_.FindNearest(position, progress.Segment);
+
+    // Count the laps when the distance wraps around the start line
+    if (progress.Segment < 0)
+        progress.Lap = nearest.Distance > length * 0.5f ? -1 : 0;
+    else
+    {
+        float delta = nearest.Distance - progress.LapDistance;
+        if (delta < -length * 0.5f)
+            progress.Lap++;
+        else if (delta > length * 0.5f)
+            progress.Lap--;
+    }
+
+    progress.Segment = nearest.Segment;
+    progress.LapDistance = nearest.Distance;
+    progress.RaceDistance = progress.Lap * length + nearest.Distance;
+
+    float trackSpeed = velocity.DotProduct(track_.GetSegmentDirection(nearest.Segment));
+    if (trackSpeed < -WRONG_WAY_SPEED)
+        progress.WrongWay = true;
+    else if (trackSpeed > WRONG_WAY_SPEED)
+        progress.WrongWay = false;
+
+    progress.RepairZone = FindRepairZone(position);
+}
+
+void PodTrackProgress::UpdateRanking(PODVector<PodVehicleProgress>& progress, const PODVector<Vector3>& positions,
+    const PODVector<Vector3>& velocities, PODVector<unsigned>& ranking) const
+{
+    ranking.Resize(progress.Size());
+    for (unsigned i = 0; i < progress.Size(); i++)
+    {
+        Update(progress[i], positions[i], velocities[i]);
+        ranking[i] = i;
+    }
+
+    Sort(ranking.Begin(), ranking.End(), [&progress](unsigned lhs, unsigned rhs)
+    {
+        float lhsDistance = progress[lhs].RaceDistance;
+        float rhsDistance = progress[rhs].RaceDistance;
+        return lhsDistance != rhsDistance ? lhsDistance > rhsDistance : lhs < rhs;
+    });
+}
+
+int PodTrackProgress::FindRepairZone(const Vector3& position) const
+{
+    Vector2 point(position.x_, position.z_);
+    for (unsigned i = 0; i < repairZones_.Size(); i++)
+    {
+        const RepairZoneBounds& zone = repairZones_[i];
+        if (position.y_ < zone.MinY || position.y_ > zone.MaxY)
+            continue;
+
+        // Inside the convex quad when on the same side of all its edges, whatever the corner order
+        bool front = false;
+        bool back = false;
+        for (unsigned j = 0; j < 4; j++)
+        {
+            Vector2 edge = zone.Corners[(j + 1) % 4] - zone.Corners[j];
+            Vector2 toPoint = point - zone.Corners[j];
+            float side = edge.x_ * toPoint.y_ - edge.y_ * toPoint.x_;
+            front |= side > 0.0f;
+            back |= side < 0.0f;
+        }
+        if (!(front && back))
+            return i;
+    }
+    return -1;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "PodCircuit.h"
+#include "PodCircuitPath.h"
+
+/// Position of a vehicle on the track, kept by the caller and updated every tick by PodTrackProgress.
+struct PodVehicleProgress
+{
+    /// Track segment found by the last update, -1 before the first one.
+    int Segment = -1;
+    /// Completed laps, -1 while behind the start line before the first lap.
+    int Lap = 0;
+    /// Distance from the start line in the current lap.
+    float LapDistance = 0.0f;
+    /// Distance from the start line over all the laps, which orders the race positions.
+    float RaceDistance = 0.0f;
+    /// Whether the vehicle drives against the track direction.
+    bool WrongWay = false;
+    /// Repair zone containing the vehicle, or -1.
+    int RepairZone = -1;
+};
+
+/// Track progress of the vehicles: where they are on the track, their laps, wrong way driving and repair zones.
+/// Built from the track segments of a difficulty level, each segment position with its remaining track length, or
+/// from the difficulty path when the level has none.
+class PodTrackProgress
+{
+public:
+    /// Build the track segments and repair zones.
+    void Build(const PodCircuit::Difficulty& difficulty, const Vector<PodCircuit::RepairZone>& repairZones);
+
+    /// Return whether the track has segments.
+    bool IsEmpty() const { return track_.IsEmpty(); }
+    /// Return the track length.
+    float GetTrackLength() const { return track_.GetLength(); }
+    /// Return the track segments.
+    const PodCircuitPath& GetTrack() const { return track_; }
+
+    /// Update the progress of a vehicle from its position and velocity. The search starts from the segment of the
+    /// previous update, so the vehicle should be updated every tick.
+    void Update(PodVehicleProgress& progress, const Vector3& position, const Vector3& velocity) const;
+
+    /// Update the progress of all the vehicles and return their indices by race position, the leader first.
+    void UpdateRanking(PODVector<PodVehicleProgress>& progress, const PODVector<Vector3>& positions,
+        const PODVector<Vector3>& velocities, PODVector<unsigned>& ranking) const;
+
+    /// Return the repair zone containing a position, or -1.
+    int FindRepairZone(const Vector3& position) const;
+
+private:
+    /// Repair zone quad on the ground plane and its height range.
+    struct RepairZoneBounds
+    {
+        Vector2 Corners[4];
+        float MinY;
+        float MaxY;
+    };
+
+    PodCircuitPath track_;
+
+    PODVector<RepairZoneBounds> repairZones_;
+};
@@ -17,6 +17,15 @@
 static constexpr int TEXTURE_WIDTH = 128;
 static constexpr int TEXTURE_HEIGHT = 128;
 
+/// Parts of the vehicle geometry: the chassis objects by condition, the wheels, then the shadows by condition.
+static constexpr unsigned WHEEL_PART = MAX_VEHICLE_CONDITIONS * MAX_VEHICLE_REGIONS;
+static constexpr unsigned SHADOW_PART = WHEEL_PART + 4;
+
+/// Region of each chassis object, in file order.
+static const PodVehicleRegion CHASSIS_OBJECT_REGIONS[MAX_VEHICLE_REGIONS] = {
+    VR_REAR_R, VR_REAR_L, VR_SIDE_R, VR_SIDE_L, VR_FRONT_R, VR_FRONT_L
+};
+
 // Unknown data structures
 struct PositionData
 {
@@ -198,30 +207,136 @@ bool PodVehicle::LoadData()
     // Read characteristics
     Read(&charsData_, sizeof(charsData_));
 
-    // Generate models
-    bodyModelGen_ = new PodModelGen(context_, materialData_.TexList);
-    for (int i = 0; i < 6; i++)
-        bodyModelGen_->AddObject(objectsData_.ChassisObjects[0][i]);
+    // All the objects go to the same geometries, one part each, so that every chassis condition, wheel and shadow
+    // is a draw range of the same buffers
+    modelGen_ = new PodModelGen(context_, materialData_.TexList);
+    for (unsigned i = 0; i < MAX_VEHICLE_CONDITIONS; i++)
+    {
+        for (unsigned j = 0; j < MAX_VEHICLE_REGIONS; j++)
+            modelGen_->AddObject(objectsData_.ChassisObjects[i][j], i * MAX_VEHICLE_REGIONS + j);
+    }
+    for (unsigned i = 0; i < 4; i++)
+        modelGen_->AddObject(objectsData_.WheelObjects[i], WHEEL_PART + i);
+    for (unsigned i = 0; i < 2; i++)
+    {
+        for (unsigned j = 0; j < 2; j++)
+            modelGen_->AddObject(objectsData_.ShadowObjects[i][j], SHADOW_PART + i * 2 + j);
+    }
 
-    for (int i = 0; i < 4; i++)
-        wheelsModelGen_.Push(UniquePtr<PodModelGen>(new PodModelGen(context_, materialData_.TexList)));
+    return true;
+}
 
-    wheelsModelGen_[RegionToWheelIndex(VR_FRONT_L)]->AddObject(objectsData_.WheelObjects[RegionToWheelIndex(VR_FRONT_L)]);
-    wheelsModelGen_[RegionToWheelIndex(VR_FRONT_R)]->AddObject(objectsData_.WheelObjects[RegionToWheelIndex(VR_FRONT_R)]);
-    wheelsModelGen_[RegionToWheelIndex(VR_REAR_L)]->AddObject(objectsData_.WheelObjects[RegionToWheelIndex(VR_REAR_L)]);
-    wheelsModelGen_[RegionToWheelIndex(VR_REAR_R)]->AddObject(objectsData_.WheelObjects[RegionToWheelIndex(VR_REAR_R)]);
+void PodVehicle::GenerateGeometry()
+{
+    modelGen_->GenerateGeometry();
+}
 
-    return true;
+void PodVehicle::CreateModels()
+{
+    for (unsigned i = 0; i < 4; i++)
+    {
+        PartModel& wheel = wheelModels_[i];
+        Vector<SharedPtr<Geometry>> geometries;
+        BoundingBox bounds;
+        modelGen_->CreatePartGeometries(WHEEL_PART + i, 1, geometries, wheel.Materials, bounds);
+
+        wheel.Mesh = new Model(context_);
+        wheel.Mesh->SetNumGeometries(geometries.Size());
+        for (unsigned j = 0; j < geometries.Size(); j++)
+            wheel.Mesh->SetGeometry(j, 0, geometries[j]);
+        wheel.Mesh->SetBoundingBox(bounds);
+    }
+
+    // The chassis models of the other conditions are created on first use
+    GetChassis(VC_GOOD);
+}
+
+Model* PodVehicle::GetChassisModel(const PodVehicleCondition* conditions)
+{
+    return GetChassis(conditions).Mesh;
+}
+
+const Vector<SharedPtr<Material>>& PodVehicle::GetChassisMaterials(const PodVehicleCondition* conditions)
+{
+    return GetChassis(conditions).Materials;
 }
 
 Model* PodVehicle::GetChassisModel(PodVehicleCondition cond)
 {
-    return bodyModelGen_->GetModel();
+    return GetChassis(cond).Mesh;
 }
 
 const Vector<SharedPtr<Material>>& PodVehicle::GetChassisMaterials(PodVehicleCondition cond)
 {
-    return bodyModelGen_->GetMaterials();
+    return GetChassis(cond).Materials;
+}
+
+const PodVehicle::PartModel& PodVehicle::GetChassis(PodVehicleCondition cond)
+{
+    PodVehicleCondition conditions[MAX_VEHICLE_REGIONS];
+    for (PodVehicleCondition& condition : conditions)
+        condition = cond;
+    return GetChassis(conditions);
+}
+
+const PodVehicle::PartModel& PodVehicle::GetChassis(const PodVehicleCondition* conditions)
+{
+    unsigned key = 0;
+    for (unsigned i = 0; i < MAX_VEHICLE_REGIONS; i++)
+        key = key * MAX_VEHICLE_CONDITIONS + conditions[i];
+    auto it = chassisModels_.Find(key);
+    if (it != chassisModels_.End())
+        return it->second_;
+
+    PartModel& chassis = chassisModels_[key];
+    Vector<SharedPtr<Geometry>> geometries;
+    BoundingBox bounds;
+
+    // Draw each run of consecutive chassis objects in the same condition with one geometry per material. The chassis
+    // in a single condition is one run.
+    for (unsigned i = 0; i < MAX_VEHICLE_REGIONS;)
+    {
+        PodVehicleCondition condition = conditions[CHASSIS_OBJECT_REGIONS[i]];
+        unsigned count = 1;
+        while (i + count < MAX_VEHICLE_REGIONS && conditions[CHASSIS_OBJECT_REGIONS[i + count]] == condition)
+            count++;
+        modelGen_->CreatePartGeometries(condition * MAX_VEHICLE_REGIONS + i, count, geometries, chassis.Materials,
+            bounds);
+        i += count;
+    }
+    unsigned numChassisGeometries = geometries.Size();
+
+    // The front and rear shadows switch to their ruined shape with a ruined region at that end
+    bool frontRuined = conditions[VR_FRONT_R] == VC_RUINED || conditions[VR_FRONT_L] == VC_RUINED;
+    bool rearRuined = conditions[VR_REAR_R] == VC_RUINED || conditions[VR_REAR_L] == VC_RUINED;
+    modelGen_->CreatePartGeometries(SHADOW_PART + (frontRuined ? 2 : 0), 1, geometries, chassis.Materials, bounds);
+    modelGen_->CreatePartGeometries(SHADOW_PART + (rearRuined ? 2 : 0) + 1, 1, geometries, chassis.Materials, bounds);
+
+    chassis.Mesh = new Model(context_);
+    chassis.Mesh->SetNumGeometries(geometries.Size());
+    chassis.Mesh->SetBoundingBox(bounds);
+    for (unsigned i = 0; i < numChassisGeometries; i++)
+        chassis.Mesh->SetGeometry(i, 0, geometries[i]);
+
+    // The blob shadows are only drawn beyond the shadow distance, as the second LOD level of an empty geometry. The
+    // LOD distance is the camera distance divided by the model size.
+    float shadowLodDistance = VEHICLE_SHADOW_DISTANCE / Max(bounds.Size().DotProduct(DOT_SCALE), M_EPSILON);
+    for (unsigned i = numChassisGeometries; i < geometries.Size(); i++)
+    {
+        Geometry* shadow = geometries[i];
+        SharedPtr<Geometry> empty(new Geometry(context_));
+        empty->SetNumVertexBuffers(shadow->GetNumVertexBuffers());
+        for (unsigned j = 0; j < shadow->GetNumVertexBuffers(); j++)
+            empty->SetVertexBuffer(j, shadow->GetVertexBuffer(j));
+        empty->SetIndexBuffer(shadow->GetIndexBuffer());
+        shadow->SetLodDistance(shadowLodDistance);
+
+        chassis.Mesh->SetNumGeometryLodLevels(i, 2);
+        chassis.Mesh->SetGeometry(i, 0, empty);
+        chassis.Mesh->SetGeometry(i, 1, shadow);
+    }
+
+    return chassis;
 }
 
 Vector3 PodVehicle::GetChassisOffset()
@@ -231,12 +346,12 @@ Vector3 PodVehicle::GetChassisOffset()
 
 Model* PodVehicle::GetWheelModel(PodVehicleRegion reg)
 {
-    return wheelsModelGen_[RegionToWheelIndex(reg)]->GetModel();
+    return wheelModels_[RegionToWheelIndex(reg)].Mesh;
 }
 
 const Vector<SharedPtr<Material>>& PodVehicle::GetWheelMaterials(PodVehicleRegion reg)
 {
-    return wheelsModelGen_[RegionToWheelIndex(reg)]->GetMaterials();
+    return wheelModels_[RegionToWheelIndex(reg)].Materials;
 }
 
 Vector3 PodVehicle::GetWheelOffset(PodVehicleRegion region)
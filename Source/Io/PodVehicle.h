@@ -4,16 +4,16 @@
 #include <string>
 #include "Application.h"
 #include "PodCommon.h"
+#include "PodModelGen.h"
 
 namespace Urho3D { class Model; class Texture2D; class Material; }
 
-class PodModelGen;
-
 enum PodVehicleCondition
 {
     VC_GOOD = 0,
     VC_DAMAGED = 1,
     VC_RUINED = 2,
+    MAX_VEHICLE_CONDITIONS
 };
 
 enum PodVehicleRegion
@@ -24,8 +24,15 @@ enum PodVehicleRegion
     VR_FRONT_L,
     VR_SIDE_L,
     VR_REAR_L,
+    MAX_VEHICLE_REGIONS
 };
 
+/// Distance beyond which the vehicles stop casting shadow maps and draw their blob shadows instead.
+static constexpr float VEHICLE_SHADOW_DISTANCE = 60.0f;
+
+/// Distance beyond which the vehicle wheels are not drawn.
+static constexpr float VEHICLE_WHEEL_DRAW_DISTANCE = 120.0f;
+
 class PodVehicle : public PodBdfFile
 {
 public:
@@ -81,6 +88,20 @@ public:
 
     bool LoadData() override;
 
+    /// Generate the vertex data of the chassis and wheel models, without creating any GPU resource. Can be called
+    /// from a worker thread.
+    void GenerateGeometry();
+
+    /// Create the models and their textures. Main thread only.
+    void CreateModels();
+
+    /// Return the chassis model of the region conditions, indexed by PodVehicleRegion. Created on first use and shared
+    /// by the vehicles in the same state, all the conditions draw ranges of the same buffers. Main thread only.
+    Model* GetChassisModel(const PodVehicleCondition* conditions);
+
+    const Vector<SharedPtr<Material>>& GetChassisMaterials(const PodVehicleCondition* conditions);
+
+    /// Return the chassis model with all the regions in the same condition.
     Model* GetChassisModel(PodVehicleCondition cond);
 
     const Vector<SharedPtr<Material>>& GetChassisMaterials(PodVehicleCondition cond);
@@ -109,7 +130,24 @@ private:
     
     CharacteristicsData charsData_;
 
-    UniquePtr<PodModelGen> bodyModelGen_;
+    /// Model drawing parts of the vehicle geometry, with the material of each geometry.
+    struct PartModel
+    {
+        SharedPtr<Model> Mesh;
+        Vector<SharedPtr<Material>> Materials;
+    };
+
+    /// Return the chassis model of the region conditions, creating it on first use.
+    const PartModel& GetChassis(const PodVehicleCondition* conditions);
+
+    /// Return the chassis model with all the regions in the same condition.
+    const PartModel& GetChassis(PodVehicleCondition cond);
+
+    /// Chassis, wheel and shadow objects, each one a part of the same geometries.
+    UniquePtr<PodModelGen> modelGen_;
+
+    /// Chassis models by region conditions, the condition of each region in a base 3 digit.
+    HashMap<unsigned, PartModel> chassisModels_;
 
-    Vector<UniquePtr<PodModelGen>> wheelsModelGen_;
+    PartModel wheelModels_[4];
 };
\ No newline at end of file
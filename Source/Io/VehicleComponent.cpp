@@ -119,26 +119,25 @@ void VehicleComponent::FixedUpdate(float timeStep)
     hullBody_->ApplyForce(hullRot * Vector3::DOWN * Abs(localVelocity.z_) * DOWN_FORCE);
 }
 
-void VehicleComponent::SetPodVehicle(PodVehicle* podv)
+void VehicleComponent::SetPodVehicle(PodVehicleResource* resource)
 {
-    podv_ = podv;
+    vehicleResource_ = resource;
+    podv_ = resource->GetVehicle();
 
     // This function is called only from the main program when initially creating the vehicle, not on scene load
     auto* cache = GetSubsystem<ResourceCache>();
 
-    auto* hullObject = node_->CreateComponent<StaticModel>();
+    hullObject_ = node_->CreateComponent<StaticModel>();
     hullBody_ = node_->CreateComponent<RigidBody>();
     auto* hullShape = node_->CreateComponent<CollisionShape>();
 
     //node_->Rotate(Quaternion(0.0f, 90.0f, 0.0f));
 
     //node_->SetScale(Vector3(1.5f, 1.0f, 3.0f));
-    hullObject->SetModel(podv_->GetChassisModel(VC_GOOD));
-    const auto& mats = podv_->GetChassisMaterials(VC_GOOD);
-    for (int i = 0; i < mats.Size(); i++)
-        hullObject->SetMaterial(i, mats[i]);
+    UpdateChassisModel();
 
-    hullObject->SetCastShadows(true);
+    hullObject_->SetCastShadows(true);
+    hullObject_->SetShadowDistance(VEHICLE_SHADOW_DISTANCE);
     hullShape->SetBox(Vector3::ONE);
     hullBody_->SetMass(4.0f);
     hullBody_->SetLinearDamping(0.2f); // Some air resistance
@@ -156,6 +155,34 @@ void VehicleComponent::SetPodVehicle(PodVehicle* podv)
     GetWheelComponents();
 }
 
+void VehicleComponent::SetCondition(PodVehicleRegion region, PodVehicleCondition condition)
+{
+    if (conditions_[region] == condition)
+        return;
+
+    conditions_[region] = condition;
+    UpdateChassisModel();
+}
+
+void VehicleComponent::SetCondition(PodVehicleCondition condition)
+{
+    for (PodVehicleCondition& regionCondition : conditions_)
+        regionCondition = condition;
+    UpdateChassisModel();
+}
+
+void VehicleComponent::UpdateChassisModel()
+{
+    if (!hullObject_ || !podv_)
+        return;
+
+    // The models of the same conditions are shared by all the vehicles, which can then be drawn instanced
+    hullObject_->SetModel(podv_->GetChassisModel(conditions_));
+    const auto& mats = podv_->GetChassisMaterials(conditions_);
+    for (unsigned i = 0; i < mats.Size(); i++)
+        hullObject_->SetMaterial(i, mats[i]);
+}
+
 void VehicleComponent::InitWheel(const String& name, PodVehicleRegion reg, WeakPtr<Node>& wheelNode, unsigned& wheelNodeID)
 {
     auto* cache = GetSubsystem<ResourceCache>();
@@ -184,6 +211,8 @@ void VehicleComponent::InitWheel(const String& name, PodVehicleRegion reg, WeakP
         wheelObject->SetMaterial(i, mats[i]);
 
     wheelObject->SetCastShadows(true);
+    wheelObject->SetShadowDistance(VEHICLE_SHADOW_DISTANCE);
+    wheelObject->SetDrawDistance(VEHICLE_WHEEL_DRAW_DISTANCE);
     wheelShape->SetSphere(1.0f);
     wheelBody->SetFriction(1.0f);
     wheelBody->SetMass(1.0f);
@@ -24,7 +24,7 @@
 
 #include <Urho3D/Input/Controls.h>
 #include <Urho3D/Scene/LogicComponent.h>
-#include "PodVehicle.h"
+#include "PodResource.h"
 
 namespace Urho3D
 {
@@ -32,6 +32,7 @@ namespace Urho3D
 class Constraint;
 class Node;
 class RigidBody;
+class StaticModel;
 
 }
 
@@ -64,8 +65,20 @@ public:
     /// Handle physics world update. Called by LogicComponent base class.
     void FixedUpdate(float timeStep) override;
 
-    /// Initialize the vehicle. Create rendering and physics components. Called by the application.
-    void SetPodVehicle(PodVehicle* podv);
+    /// Initialize the vehicle from a vehicle resource, shared with the other vehicles using it. Create rendering and
+    /// physics components. Called by the application.
+    void SetPodVehicle(PodVehicleResource* resource);
+
+    /// Return the hull rigid body.
+    RigidBody* GetHullBody() const { return hullBody_; }
+
+    /// Set the chassis condition of a region. Switches to the chassis model of the new conditions, which draws other
+    /// ranges of the vehicle buffers.
+    void SetCondition(PodVehicleRegion region, PodVehicleCondition condition);
+    /// Set the chassis condition of all the regions.
+    void SetCondition(PodVehicleCondition condition);
+    /// Return the chassis condition of a region.
+    PodVehicleCondition GetCondition(PodVehicleRegion region) const { return conditions_[region]; }
 
     /// Movement controls.
     Controls controls_;
@@ -75,8 +88,18 @@ private:
     void InitWheel(const String& name, PodVehicleRegion reg, WeakPtr<Node>& wheelNode, unsigned& wheelNodeID);
     /// Acquire wheel components from wheel scene nodes.
     void GetWheelComponents();
+    /// Set the hull model of the current chassis conditions.
+    void UpdateChassisModel();
+
+    /// Vehicle resource, kept alive while the vehicle uses its models.
+    SharedPtr<PodVehicleResource> vehicleResource_;
+
+    PodVehicle* podv_{};
 
-    PodVehicle* podv_;
+    /// Hull model.
+    WeakPtr<StaticModel> hullObject_;
+    /// Chassis condition of each region.
+    PodVehicleCondition conditions_[MAX_VEHICLE_REGIONS]{};
 
     /// Wheel scene front-left node.
     WeakPtr<Node> frontLeft_;
@@ -435,6 +435,24 @@ void Context::RemoveEventSender(Object* sender)
         }
         specificEventReceivers_.Erase(i);
     }
+
+    HashMap<Object*, Vector<SharedPtr<EventReceiverGroup> > >::Iterator j = specificTypedEventReceivers_.Find(sender);
+    if (j != specificTypedEventReceivers_.End())
+    {
+        for (Vector<SharedPtr<EventReceiverGroup> >::Iterator k = j->second_.Begin(); k != j->second_.End(); ++k)
+        {
+            if (!*k)
+                continue;
+
+            for (PODVector<Object*>::Iterator l = (*k)->receivers_.Begin(); l != (*k)->receivers_.End(); ++l)
+            {
+                Object* receiver = *l;
+                if (receiver)
+                    receiver->RemoveEventSender(sender);
+            }
+        }
+        specificTypedEventReceivers_.Erase(j);
+    }
 }
 
 void Context::RemoveEventReceiver(Object* receiver, StringHash eventType)
@@ -451,6 +469,41 @@ void Context::RemoveEventReceiver(Object* receiver, Object* sender, StringHash e
         group->Remove(receiver);
 }
 
+void Context::AddTypedEventReceiver(Object* receiver, unsigned eventIndex)
+{
+    if (typedEventReceivers_.Size() <= eventIndex)
+        typedEventReceivers_.Resize(eventIndex + 1);
+    SharedPtr<EventReceiverGroup>& group = typedEventReceivers_[eventIndex];
+    if (!group)
+        group = new EventReceiverGroup();
+    group->Add(receiver);
+}
+
+void Context::AddTypedEventReceiver(Object* receiver, Object* sender, unsigned eventIndex)
+{
+    Vector<SharedPtr<EventReceiverGroup> >& groups = specificTypedEventReceivers_[sender];
+    if (groups.Size() <= eventIndex)
+        groups.Resize(eventIndex + 1);
+    SharedPtr<EventReceiverGroup>& group = groups[eventIndex];
+    if (!group)
+        group = new EventReceiverGroup();
+    group->Add(receiver);
+}
+
+void Context::RemoveTypedEventReceiver(Object* receiver, Object* sender, unsigned eventIndex)
+{
+    EventReceiverGroup* group = GetTypedEventReceivers(sender, eventIndex);
+    if (group)
+        group->Remove(receiver);
+}
+
+void Context::RemoveTypedEventReceiver(Object* receiver, unsigned eventIndex)
+{
+    EventReceiverGroup* group = GetTypedEventReceivers(eventIndex);
+    if (group)
+        group->Remove(receiver);
+}
+
 void Context::BeginSendEvent(Object* sender, StringHash eventType)
 {
 #ifdef URHO3D_PROFILING
@@ -203,6 +203,34 @@ public:
         return i != eventReceivers_.End() ? i->second_ : nullptr;
     }
 
+    /// Return whether an event sent by a sender has VariantMap event receivers.
+    bool HasEventReceivers(Object* sender, StringHash eventType)
+    {
+        EventReceiverGroup* group = GetEventReceivers(sender, eventType);
+        if (group && !group->receivers_.Empty())
+            return true;
+        group = GetEventReceivers(eventType);
+        return group && !group->receivers_.Empty();
+    }
+
+    /// Return typed event receivers for a sender and typed event index, or null if they do not exist.
+    EventReceiverGroup* GetTypedEventReceivers(Object* sender, unsigned eventIndex)
+    {
+        if (specificTypedEventReceivers_.Empty())
+            return nullptr;
+        HashMap<Object*, Vector<SharedPtr<EventReceiverGroup> > >::Iterator i = specificTypedEventReceivers_.Find(sender);
+        if (i != specificTypedEventReceivers_.End())
+            return eventIndex < i->second_.Size() ? i->second_[eventIndex].Get() : nullptr;
+        else
+            return nullptr;
+    }
+
+    /// Return typed event receivers for a typed event index, or null if they do not exist.
+    EventReceiverGroup* GetTypedEventReceivers(unsigned eventIndex)
+    {
+        return eventIndex < typedEventReceivers_.Size() ? typedEventReceivers_[eventIndex].Get() : nullptr;
+    }
+
 private:
     /// Add event receiver.
     void AddEventReceiver(Object* receiver, StringHash eventType);
@@ -214,6 +242,14 @@ private:
     void RemoveEventReceiver(Object* receiver, Object* sender, StringHash eventType);
     /// Remove event receiver from non-specific events.
     void RemoveEventReceiver(Object* receiver, StringHash eventType);
+    /// Add typed event receiver.
+    void AddTypedEventReceiver(Object* receiver, unsigned eventIndex);
+    /// Add typed event receiver for specific event.
+    void AddTypedEventReceiver(Object* receiver, Object* sender, unsigned eventIndex);
+    /// Remove typed event receiver from specific events.
+    void RemoveTypedEventReceiver(Object* receiver, Object* sender, unsigned eventIndex);
+    /// Remove typed event receiver from non-specific events.
+    void RemoveTypedEventReceiver(Object* receiver, unsigned eventIndex);
     /// Begin event send.
     void BeginSendEvent(Object* sender, StringHash eventType);
     /// End event send. Clean up event receivers removed in the meanwhile.
@@ -234,6 +270,10 @@ private:
     HashMap<StringHash, SharedPtr<EventReceiverGroup> > eventReceivers_;
     /// Event receivers for specific senders' events.
     HashMap<Object*, HashMap<StringHash, SharedPtr<EventReceiverGroup> > > specificEventReceivers_;
+    /// Typed event receivers for non-specific events by typed event index.
+    Vector<SharedPtr<EventReceiverGroup> > typedEventReceivers_;
+    /// Typed event receivers for specific senders' events by typed event index.
+    HashMap<Object*, Vector<SharedPtr<EventReceiverGroup> > > specificTypedEventReceivers_;
     /// Event sender stack.
     PODVector<Object*> eventSenders_;
     /// Event data stack.
@@ -40,6 +40,18 @@ URHO3D_EVENT(E_UPDATE, Update)
     URHO3D_PARAM(P_TIMESTEP, TimeStep);            // float
 }
 
+/// Typed payload of the application-wide logic update event.
+struct UpdateEventData
+{
+    URHO3D_TYPED_EVENT(E_UPDATE)
+
+    /// Fill the event parameters.
+    void ToVariantMap(VariantMap& eventData) const { eventData[Update::P_TIMESTEP] = timeStep_; }
+
+    /// Time step.
+    float timeStep_;
+};
+
 /// Application-wide logic post-update event.
 URHO3D_EVENT(E_POSTUPDATE, PostUpdate)
 {
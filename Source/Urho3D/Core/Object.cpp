@@ -242,6 +242,18 @@ void Object::UnsubscribeFromEvents(Object* sender)
         else
             break;
     }
+
+    TypedEventHandler* typedHandler = typedEventHandlers_.First();
+    TypedEventHandler* previous = nullptr;
+    while (typedHandler)
+    {
+        TypedEventHandler* next = typedEventHandlers_.Next(typedHandler);
+        if (typedHandler->GetSender() == sender)
+            RemoveTypedEventHandler(typedHandler, previous);
+        else
+            previous = typedHandler;
+        typedHandler = next;
+    }
 }
 
 void Object::UnsubscribeFromAllEvents()
@@ -260,6 +272,9 @@ void Object::UnsubscribeFromAllEvents()
         else
             break;
     }
+
+    while (TypedEventHandler* typedHandler = typedEventHandlers_.First())
+        RemoveTypedEventHandler(typedHandler, nullptr);
 }
 
 void Object::UnsubscribeFromAllEventsExcept(const PODVector<StringHash>& exceptions, bool onlyUserData)
@@ -285,6 +300,22 @@ void Object::UnsubscribeFromAllEventsExcept(const PODVector<StringHash>& excepti
 
         handler = next;
     }
+
+    // Typed event handlers have no userdata
+    if (onlyUserData)
+        return;
+
+    TypedEventHandler* typedHandler = typedEventHandlers_.First();
+    TypedEventHandler* typedPrevious = nullptr;
+    while (typedHandler)
+    {
+        TypedEventHandler* next = typedEventHandlers_.Next(typedHandler);
+        if (!exceptions.Contains(typedHandler->GetEventType()))
+            RemoveTypedEventHandler(typedHandler, typedPrevious);
+        else
+            typedPrevious = typedHandler;
+        typedHandler = next;
+    }
 }
 
 void Object::SendEvent(StringHash eventType)
@@ -528,6 +559,214 @@ void Object::RemoveEventSender(Object* sender)
             handler = eventHandlers_.Next(handler);
         }
     }
+
+    // The context has already dropped the sender's typed event receivers
+    TypedEventHandler* typedHandler = typedEventHandlers_.First();
+    TypedEventHandler* typedPrevious = nullptr;
+
+    while (typedHandler)
+    {
+        if (typedHandler->GetSender() == sender)
+        {
+            TypedEventHandler* next = typedEventHandlers_.Next(typedHandler);
+            typedEventHandlers_.Erase(typedHandler, typedPrevious);
+            typedHandler = next;
+        }
+        else
+        {
+            typedPrevious = typedHandler;
+            typedHandler = typedEventHandlers_.Next(typedHandler);
+        }
+    }
+}
+
+void Object::SubscribeToTypedEvent(Object* sender, unsigned eventIndex, TypedEventHandler* handler)
+{
+    // The event type is only needed for the exceptions of UnsubscribeFromAllEventsExcept(), look it up from the index
+    handler->SetSenderAndEventType(sender, GetTypedEventType(eventIndex), eventIndex);
+    // Remove old event handler first
+    TypedEventHandler* previous;
+    TypedEventHandler* oldHandler = FindTypedEventHandler(sender, eventIndex, &previous);
+    if (oldHandler)
+    {
+        typedEventHandlers_.Erase(oldHandler, previous);
+        typedEventHandlers_.InsertFront(handler);
+    }
+    else
+    {
+        typedEventHandlers_.InsertFront(handler);
+        if (sender)
+            context_->AddTypedEventReceiver(this, sender, eventIndex);
+        else
+            context_->AddTypedEventReceiver(this, eventIndex);
+    }
+}
+
+void Object::UnsubscribeFromTypedEvent(unsigned eventIndex)
+{
+    TypedEventHandler* handler = typedEventHandlers_.First();
+    TypedEventHandler* previous = nullptr;
+    while (handler)
+    {
+        TypedEventHandler* next = typedEventHandlers_.Next(handler);
+        if (handler->GetEventIndex() == eventIndex)
+            RemoveTypedEventHandler(handler, previous);
+        else
+            previous = handler;
+        handler = next;
+    }
+}
+
+void Object::UnsubscribeFromTypedEvent(Object* sender, unsigned eventIndex)
+{
+    if (!sender)
+        return;
+
+    TypedEventHandler* previous;
+    TypedEventHandler* handler = FindTypedEventHandler(sender, eventIndex, &previous);
+    if (handler)
+        RemoveTypedEventHandler(handler, previous);
+}
+
+void Object::RemoveTypedEventHandler(TypedEventHandler* handler, TypedEventHandler* previous)
+{
+    if (handler->GetSender())
+        context_->RemoveTypedEventReceiver(this, handler->GetSender(), handler->GetEventIndex());
+    else
+        context_->RemoveTypedEventReceiver(this, handler->GetEventIndex());
+    typedEventHandlers_.Erase(handler, previous);
+}
+
+void Object::SendTypedEvent(StringHash eventType, unsigned eventIndex, void* eventData, void (*convert)(const void*, VariantMap&))
+{
+    if (!Thread::IsMainThread())
+    {
+        URHO3D_LOGERROR("Sending events is only supported from the main thread");
+        return;
+    }
+
+    if (blockEvents_)
+        return;
+
+    Context* context = context_;
+
+    // Note: groups are held alive with shared ptrs, as they may get destroyed along with the sender
+    SharedPtr<EventReceiverGroup> specificGroup(context->GetTypedEventReceivers(this, eventIndex));
+    SharedPtr<EventReceiverGroup> group(context->GetTypedEventReceivers(eventIndex));
+    bool hasSpecific = specificGroup && !specificGroup->receivers_.Empty();
+    if (hasSpecific || (group && !group->receivers_.Empty()))
+    {
+        // Make a weak pointer to self to check for destruction during event handling
+        WeakPtr<Object> self(this);
+        context->BeginSendEvent(this, eventType);
+
+        if (hasSpecific)
+        {
+            specificGroup->BeginSendEvent();
+
+            const unsigned numReceivers = specificGroup->receivers_.Size();
+            for (unsigned i = 0; i < numReceivers; ++i)
+            {
+                Object* receiver = specificGroup->receivers_[i];
+                // Holes may exist if receivers removed during send
+                if (!receiver)
+                    continue;
+
+                receiver->OnTypedEvent(this, eventIndex, eventData);
+
+                if (self.Expired())
+                {
+                    specificGroup->EndSendEvent();
+                    context->EndSendEvent();
+                    return;
+                }
+            }
+
+            specificGroup->EndSendEvent();
+        }
+
+        if (group)
+        {
+            group->BeginSendEvent();
+
+            const unsigned numReceivers = group->receivers_.Size();
+            for (unsigned i = 0; i < numReceivers; ++i)
+            {
+                Object* receiver = group->receivers_[i];
+                // Check that the event is not sent doubly to the specific receivers. Few objects subscribe to a
+                // specific sender, so a search is cheaper than building a set of the processed receivers
+                if (!receiver || (hasSpecific && specificGroup->receivers_.Contains(receiver)))
+                    continue;
+
+                receiver->OnTypedEvent(this, eventIndex, eventData);
+
+                if (self.Expired())
+                {
+                    group->EndSendEvent();
+                    context->EndSendEvent();
+                    return;
+                }
+            }
+
+            group->EndSendEvent();
+        }
+
+        context->EndSendEvent();
+    }
+
+    // Fall back to a VariantMap only for the script and legacy event handlers
+    if (context->HasEventReceivers(this, eventType))
+    {
+        VariantMap& variantMap = GetEventDataMap();
+        convert(eventData, variantMap);
+        SendEvent(eventType, variantMap);
+    }
+}
+
+void Object::OnTypedEvent(Object* sender, unsigned eventIndex, void* eventData)
+{
+    if (blockEvents_)
+        return;
+
+    TypedEventHandler* nonSpecific = nullptr;
+
+    TypedEventHandler* handler = typedEventHandlers_.First();
+    while (handler)
+    {
+        if (handler->GetEventIndex() == eventIndex)
+        {
+            if (!handler->GetSender())
+                nonSpecific = handler;
+            else if (handler->GetSender() == sender)
+            {
+                // Specific event handlers have priority
+                handler->Invoke(eventData);
+                return;
+            }
+        }
+        handler = typedEventHandlers_.Next(handler);
+    }
+
+    if (nonSpecific)
+        nonSpecific->Invoke(eventData);
+}
+
+TypedEventHandler* Object::FindTypedEventHandler(Object* sender, unsigned eventIndex, TypedEventHandler** previous) const
+{
+    TypedEventHandler* handler = typedEventHandlers_.First();
+    if (previous)
+        *previous = nullptr;
+
+    while (handler)
+    {
+        if (handler->GetSender() == sender && handler->GetEventIndex() == eventIndex)
+            return handler;
+        if (previous)
+            *previous = handler;
+        handler = typedEventHandlers_.Next(handler);
+    }
+
+    return nullptr;
 }
 
 StringHashRegister& GetEventNameRegister()
@@ -536,4 +775,28 @@ StringHashRegister& GetEventNameRegister()
     return eventNameRegister;
 }
 
+/// Return the registered typed event types by index.
+static PODVector<StringHash>& GetTypedEventTypes()
+{
+    static PODVector<StringHash> typedEventTypes;
+    return typedEventTypes;
+}
+
+unsigned GetTypedEventIndex(StringHash eventType)
+{
+    PODVector<StringHash>& typedEventTypes = GetTypedEventTypes();
+    PODVector<StringHash>::ConstIterator i = typedEventTypes.Find(eventType);
+    if (i != typedEventTypes.End())
+        return (unsigned)(i - typedEventTypes.Begin());
+
+    typedEventTypes.Push(eventType);
+    return typedEventTypes.Size() - 1;
+}
+
+StringHash GetTypedEventType(unsigned eventIndex)
+{
+    const PODVector<StringHash>& typedEventTypes = GetTypedEventTypes();
+    return eventIndex < typedEventTypes.Size() ? typedEventTypes[eventIndex] : StringHash::ZERO;
+}
+
 }
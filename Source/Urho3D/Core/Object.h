@@ -33,6 +33,7 @@ namespace Urho3D
 
 class Context;
 class EventHandler;
+class TypedEventHandler;
 
 /// Type info.
 class URHO3D_API TypeInfo
@@ -140,6 +141,24 @@ public:
         SendEvent(eventType, GetEventDataMap().Populate(args...));
     }
 
+    /// Subscribe to a typed event that can be sent by any sender. The handler is a member function taking the event payload struct by reference.
+    template <class T, class E> void SubscribeToTypedEvent(void (T::*function)(E&));
+    /// Subscribe to a specific sender's typed event.
+    template <class T, class E> void SubscribeToTypedEvent(Object* sender, void (T::*function)(E&));
+    /// Subscribe to a typed event that can be sent by any sender.
+    template <class E> void SubscribeToTypedEvent(const std::function<void(E&)>& function);
+    /// Subscribe to a specific sender's typed event.
+    template <class E> void SubscribeToTypedEvent(Object* sender, const std::function<void(E&)>& function);
+    /// Unsubscribe from a typed event.
+    template <class E> void UnsubscribeFromTypedEvent() { UnsubscribeFromTypedEvent(E::GetEventIndexStatic()); }
+    /// Unsubscribe from a specific sender's typed event.
+    template <class E> void UnsubscribeFromTypedEvent(Object* sender) { UnsubscribeFromTypedEvent(sender, E::GetEventIndexStatic()); }
+    /// Send a typed event. The typed handlers receive the payload by reference, without hashing or conversion. The payload is converted to the preallocated event data map and sent as a VariantMap event only when there are VariantMap (script or legacy) receivers, which are called after all the typed handlers.
+    template <class E> void SendTypedEvent(E& eventData)
+    {
+        SendTypedEvent(E::GetEventTypeStatic(), E::GetEventIndexStatic(), &eventData, &Object::ConvertTypedEvent<E>);
+    }
+
     /// Return execution context.
     Context* GetContext() const { return context_; }
     /// Return global variable based on key
@@ -159,8 +178,13 @@ public:
     /// Return whether has subscribed to a specific sender's event.
     bool HasSubscribedToEvent(Object* sender, StringHash eventType) const;
 
+    /// Return whether has subscribed to a typed event without specific sender.
+    template <class E> bool HasSubscribedToTypedEvent() const { return FindTypedEventHandler(nullptr, E::GetEventIndexStatic()) != nullptr; }
+    /// Return whether has subscribed to a specific sender's typed event.
+    template <class E> bool HasSubscribedToTypedEvent(Object* sender) const { return sender && FindTypedEventHandler(sender, E::GetEventIndexStatic()) != nullptr; }
+
     /// Return whether has subscribed to any event.
-    bool HasEventHandlers() const { return !eventHandlers_.Empty(); }
+    bool HasEventHandlers() const { return !eventHandlers_.Empty() || !typedEventHandlers_.Empty(); }
 
     /// Template version of returning a subsystem.
     template <class T> T* GetSubsystem() const;
@@ -185,9 +209,30 @@ private:
     EventHandler* FindSpecificEventHandler(Object* sender, StringHash eventType, EventHandler** previous = nullptr) const;
     /// Remove event handlers related to a specific sender.
     void RemoveEventSender(Object* sender);
+    /// Subscribe to a typed event by index, or to a specific sender's typed event if the sender is not null.
+    void SubscribeToTypedEvent(Object* sender, unsigned eventIndex, TypedEventHandler* handler);
+    /// Unsubscribe from a typed event by index, including the specific senders.
+    void UnsubscribeFromTypedEvent(unsigned eventIndex);
+    /// Unsubscribe from a specific sender's typed event by index.
+    void UnsubscribeFromTypedEvent(Object* sender, unsigned eventIndex);
+    /// Remove a typed event handler and its receiver registration.
+    void RemoveTypedEventHandler(TypedEventHandler* handler, TypedEventHandler* previous);
+    /// Send a type-erased typed event payload, converting it to a VariantMap for the VariantMap receivers.
+    void SendTypedEvent(StringHash eventType, unsigned eventIndex, void* eventData, void (*convert)(const void*, VariantMap&));
+    /// Handle a typed event. Specific event handlers have priority like in OnEvent().
+    void OnTypedEvent(Object* sender, unsigned eventIndex, void* eventData);
+    /// Find the typed event handler with specific sender, or with no specific sender if the sender is null.
+    TypedEventHandler* FindTypedEventHandler(Object* sender, unsigned eventIndex, TypedEventHandler** previous = nullptr) const;
+    /// Convert a typed event payload to a VariantMap.
+    template <class E> static void ConvertTypedEvent(const void* eventData, VariantMap& variantMap)
+    {
+        static_cast<const E*>(eventData)->ToVariantMap(variantMap);
+    }
 
     /// Event handlers. Sender is null for non-specific handlers.
     LinkedList<EventHandler> eventHandlers_;
+    /// Typed event handlers. Sender is null for non-specific handlers.
+    LinkedList<TypedEventHandler> typedEventHandlers_;
 
     /// Block object from sending and receiving any events.
     bool blockEvents_;
@@ -355,13 +400,142 @@ private:
     std::function<void(StringHash, VariantMap&)> function_;
 };
 
+/// Internal helper class for invoking typed event handler functions.
+class URHO3D_API TypedEventHandler : public LinkedListNode
+{
+public:
+    /// Construct with specified receiver.
+    explicit TypedEventHandler(Object* receiver) :
+        receiver_(receiver),
+        sender_(nullptr),
+        eventIndex_(0)
+    {
+    }
+
+    /// Destruct.
+    virtual ~TypedEventHandler() = default;
+
+    /// Set sender, event type and typed event index.
+    void SetSenderAndEventType(Object* sender, StringHash eventType, unsigned eventIndex)
+    {
+        sender_ = sender;
+        eventType_ = eventType;
+        eventIndex_ = eventIndex;
+    }
+
+    /// Invoke event handler function with the event payload.
+    virtual void Invoke(void* eventData) = 0;
+
+    /// Return event receiver.
+    Object* GetReceiver() const { return receiver_; }
+
+    /// Return event sender. Null if the handler is non-specific.
+    Object* GetSender() const { return sender_; }
+
+    /// Return event type.
+    const StringHash& GetEventType() const { return eventType_; }
+
+    /// Return typed event index.
+    unsigned GetEventIndex() const { return eventIndex_; }
+
+protected:
+    /// Event receiver.
+    Object* receiver_;
+    /// Event sender.
+    Object* sender_;
+    /// Event type.
+    StringHash eventType_;
+    /// Typed event index.
+    unsigned eventIndex_;
+};
+
+/// Template implementation of the typed event handler invoke helper (stores a function pointer of specific class.)
+template <class T, class E> class TypedEventHandlerImpl : public TypedEventHandler
+{
+public:
+    using HandlerFunctionPtr = void (T::*)(E&);
+
+    /// Construct with receiver and function pointers.
+    TypedEventHandlerImpl(T* receiver, HandlerFunctionPtr function) :
+        TypedEventHandler(receiver),
+        function_(function)
+    {
+        assert(receiver_);
+        assert(function_);
+    }
+
+    /// Invoke event handler function.
+    void Invoke(void* eventData) override
+    {
+        auto* receiver = static_cast<T*>(receiver_);
+        (receiver->*function_)(*static_cast<E*>(eventData));
+    }
+
+private:
+    /// Class-specific pointer to handler function.
+    HandlerFunctionPtr function_;
+};
+
+/// Template implementation of the typed event handler invoke helper (std::function instance).
+template <class E> class TypedEventHandler11Impl : public TypedEventHandler
+{
+public:
+    /// Construct with receiver and function.
+    TypedEventHandler11Impl(Object* receiver, std::function<void(E&)> function) :
+        TypedEventHandler(receiver),
+        function_(std::move(function))
+    {
+        assert(function_);
+    }
+
+    /// Invoke event handler function.
+    void Invoke(void* eventData) override
+    {
+        function_(*static_cast<E*>(eventData));
+    }
+
+private:
+    /// Handler function.
+    std::function<void(E&)> function_;
+};
+
+template <class T, class E> void Object::SubscribeToTypedEvent(void (T::*function)(E&))
+{
+    SubscribeToTypedEvent(nullptr, E::GetEventIndexStatic(), new TypedEventHandlerImpl<T, E>(static_cast<T*>(this), function));
+}
+
+template <class T, class E> void Object::SubscribeToTypedEvent(Object* sender, void (T::*function)(E&))
+{
+    if (sender)
+        SubscribeToTypedEvent(sender, E::GetEventIndexStatic(), new TypedEventHandlerImpl<T, E>(static_cast<T*>(this), function));
+}
+
+template <class E> void Object::SubscribeToTypedEvent(const std::function<void(E&)>& function)
+{
+    SubscribeToTypedEvent(nullptr, E::GetEventIndexStatic(), new TypedEventHandler11Impl<E>(this, function));
+}
+
+template <class E> void Object::SubscribeToTypedEvent(Object* sender, const std::function<void(E&)>& function)
+{
+    if (sender)
+        SubscribeToTypedEvent(sender, E::GetEventIndexStatic(), new TypedEventHandler11Impl<E>(this, function));
+}
+
 /// Get register of event names.
 URHO3D_API StringHashRegister& GetEventNameRegister();
+/// Return the index of a typed event, assigned on first use. Typed event receivers are stored by index to avoid hashing on send.
+URHO3D_API unsigned GetTypedEventIndex(StringHash eventType);
+/// Return the event type of a typed event index.
+URHO3D_API StringHash GetTypedEventType(unsigned eventIndex);
 
 /// Describe an event's hash ID and begin a namespace in which to define its parameters.
 #define URHO3D_EVENT(eventID, eventName) static const Urho3D::StringHash eventID(Urho3D::GetEventNameRegister().RegisterString(#eventName)); namespace eventName
 /// Describe an event's parameter hash ID. Should be used inside an event namespace.
 #define URHO3D_PARAM(paramID, paramName) static const Urho3D::StringHash paramID(#paramName)
+/// Declare a struct as the typed payload of an event. Should be used inside the struct, which must also define a ToVariantMap(VariantMap&) const function filling the event parameters for the VariantMap receivers.
+#define URHO3D_TYPED_EVENT(eventID) \
+    static Urho3D::StringHash GetEventTypeStatic() { return eventID; } \
+    static unsigned GetEventIndexStatic() { static const unsigned eventIndex = Urho3D::GetTypedEventIndex(eventID); return eventIndex; }
 /// Convenience macro to construct an EventHandler that points to a receiver object and its member function.
 #define URHO3D_HANDLER(className, function) (new Urho3D::EventHandlerImpl<className>(this, &className::function))
 /// Convenience macro to construct an EventHandler that points to a receiver object and its member function, and also defines a userdata pointer.
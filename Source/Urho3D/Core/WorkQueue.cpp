@@ -31,6 +31,95 @@
 namespace Urho3D
 {
 
+/// Initial capacity of a task deque, grown when full.
+static const unsigned INITIAL_TASK_DEQUE_SIZE = 64;
+
+/// Index of the worker thread running on this thread, or M_MAX_UNSIGNED outside the worker threads.
+static thread_local unsigned workerThreadIndex = M_MAX_UNSIGNED;
+
+/// Return the work queue thread index of the calling thread: 0 for the main thread, M_MAX_UNSIGNED for threads not
+/// managed by the work queue.
+static unsigned GetThreadIndex()
+{
+    return Thread::IsMainThread() ? 0 : workerThreadIndex;
+}
+
+/// Task deque of a thread. The owner thread pushes and pops at the back, the other threads steal from the front, so
+/// that the owner works on its most recent tasks while the oldest, usually largest, are stolen.
+class TaskDeque
+{
+public:
+    /// Construct.
+    TaskDeque() :
+        tasks_(INITIAL_TASK_DEQUE_SIZE),
+        head_(0),
+        count_(0)
+    {
+    }
+
+    /// Push a task at the back.
+    void PushBack(Task* task)
+    {
+        MutexLock lock(mutex_);
+        if (count_ == tasks_.Size())
+        {
+            // Unwrap the ring into a buffer of twice the size
+            PODVector<Task*> tasks(tasks_.Size() * 2);
+            for (unsigned i = 0; i < count_; ++i)
+                tasks[i] = tasks_[(head_ + i) & (tasks_.Size() - 1)];
+            tasks_.Swap(tasks);
+            head_ = 0;
+        }
+        tasks_[(head_ + count_++) & (tasks_.Size() - 1)] = task;
+    }
+
+    /// Pop the most recent task, or return null if empty.
+    Task* PopBack()
+    {
+        MutexLock lock(mutex_);
+        if (!count_)
+            return nullptr;
+        return tasks_[(head_ + --count_) & (tasks_.Size() - 1)];
+    }
+
+    /// Pop the oldest task, or return null if empty.
+    Task* PopFront()
+    {
+        MutexLock lock(mutex_);
+        if (!count_)
+            return nullptr;
+        Task* task = tasks_[head_];
+        head_ = (head_ + 1) & (tasks_.Size() - 1);
+        --count_;
+        return task;
+    }
+
+private:
+    /// Deque mutex.
+    Mutex mutex_;
+    /// Task ring buffer, its size is a power of two.
+    PODVector<Task*> tasks_;
+    /// Index of the oldest task.
+    unsigned head_;
+    /// Number of tasks.
+    unsigned count_;
+};
+
+Task::Task(const TaskFunction& function, Task* parent) :
+    function_(function),
+    parent_(parent),
+    pending_(1),
+    dependencies_(1),
+    refs_(0)
+{
+}
+
+void Task::ReleaseRef()
+{
+    if (refs_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        delete this;
+}
+
 /// Worker thread managed by the work queue.
 class WorkerThread : public Thread, public RefCounted
 {
@@ -47,6 +136,7 @@ public:
     {
         // Init FPU state first
         InitFPU();
+        workerThreadIndex = index_;
         owner_->ProcessItems(index_);
     }
 
@@ -68,8 +158,10 @@ WorkQueue::WorkQueue(Context* context) :
     completing_(false),
     tolerance_(10),
     lastSize_(0),
-    maxNonThreadedWorkMs_(5)
+    maxNonThreadedWorkMs_(5),
+    numQueuedTasks_(0)
 {
+    taskDeques_.Push(UniquePtr<TaskDeque>(new TaskDeque()));
     SubscribeToEvent(E_BEGINFRAME, URHO3D_HANDLER(WorkQueue, HandleBeginFrame));
 }
 
@@ -94,6 +186,10 @@ void WorkQueue::CreateThreads(unsigned numThreads)
     // Start threads in paused mode
     Pause();
 
+    // The deques are created before the threads, which read them without locking
+    for (unsigned i = 0; i < numThreads; ++i)
+        taskDeques_.Push(UniquePtr<TaskDeque>(new TaskDeque()));
+
     for (unsigned i = 0; i < numThreads; ++i)
     {
         SharedPtr<WorkerThread> thread(new WorkerThread(this, i + 1));
@@ -274,7 +370,7 @@ void WorkQueue::Complete(unsigned priority)
         }
 
         // If no work at all remaining, pause worker threads by leaving the mutex locked
-        if (queue_.Empty())
+        if (queue_.Empty() && !numQueuedTasks_.load(std::memory_order_acquire))
             Pause();
     }
     else
@@ -293,6 +389,170 @@ void WorkQueue::Complete(unsigned priority)
     completing_ = false;
 }
 
+TaskPtr WorkQueue::CreateTask(const TaskFunction& function, Task* parent)
+{
+    // The child holds a reference to the parent until it finishes
+    if (parent)
+    {
+        parent->pending_.fetch_add(1, std::memory_order_relaxed);
+        parent->AddRef();
+    }
+
+    return TaskPtr(new Task(function, parent));
+}
+
+void WorkQueue::AddContinuation(Task* task, Task* continuation)
+{
+    if (!task || !continuation)
+        return;
+
+    continuation->dependencies_.fetch_add(1, std::memory_order_relaxed);
+    continuation->AddRef();
+    task->continuations_.Push(continuation);
+}
+
+void WorkQueue::SubmitTask(Task* task)
+{
+    if (!task)
+        return;
+
+    if (task->dependencies_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        ScheduleTask(task);
+}
+
+void WorkQueue::WaitTask(Task* task)
+{
+    if (!task)
+        return;
+
+    unsigned threadIndex = GetThreadIndex();
+    if (threadIndex == 0)
+        Resume();
+
+    // Threads not managed by the work queue have no deque, they only wait
+    while (!task->IsFinished())
+    {
+        if (threadIndex == M_MAX_UNSIGNED || !RunTask(threadIndex))
+            Time::Sleep(0);
+    }
+}
+
+void WorkQueue::ParallelFor(unsigned begin, unsigned end, unsigned grainSize, const ParallelForFunction& function)
+{
+    if (begin >= end)
+        return;
+
+    // Run on the calling thread when there is nothing to split, or when the shared counter could wrap around past the
+    // range end, as each thread overshoots it once
+    grainSize = Max(grainSize, 1U);
+    unsigned threadIndex = GetThreadIndex();
+    unsigned numChunks = (end - begin - 1) / grainSize + 1;
+    unsigned long long maxCounter = (unsigned long long)end + (unsigned long long)grainSize * (threads_.Size() + 1);
+    if (threads_.Empty() || threadIndex == M_MAX_UNSIGNED || numChunks == 1 || maxCounter > M_MAX_UNSIGNED)
+    {
+        function(begin, end, threadIndex == M_MAX_UNSIGNED ? 0 : threadIndex);
+        return;
+    }
+
+    // The threads take the chunks from a shared counter, so a thread which is late to start does not hold back the
+    // range. The tasks reference the state on this stack, which outlives them as the root task is waited for.
+    struct ParallelForState
+    {
+        std::atomic<unsigned> next_;
+        unsigned end_;
+        unsigned grainSize_;
+        const ParallelForFunction* function_;
+
+        void RunChunks(unsigned threadIndex)
+        {
+            for (;;)
+            {
+                unsigned start = next_.fetch_add(grainSize_, std::memory_order_relaxed);
+                if (start >= end_)
+                    break;
+                (*function_)(start, end_ - start > grainSize_ ? start + grainSize_ : end_, threadIndex);
+            }
+        }
+    };
+
+    ParallelForState state;
+    state.next_ = begin;
+    state.end_ = end;
+    state.grainSize_ = grainSize;
+    state.function_ = &function;
+
+    TaskPtr root = CreateTask(TaskFunction());
+    unsigned numTasks = Min(numChunks, threads_.Size() + 1) - 1;
+    for (unsigned i = 0; i < numTasks; ++i)
+    {
+        TaskPtr task = CreateTask([&state](unsigned taskThreadIndex) { state.RunChunks(taskThreadIndex); }, root.Get());
+        SubmitTask(task.Get());
+    }
+    SubmitTask(root.Get());
+
+    state.RunChunks(threadIndex);
+    WaitTask(root.Get());
+}
+
+unsigned WorkQueue::GetCurrentThreadIndex()
+{
+    return GetThreadIndex();
+}
+
+void WorkQueue::ScheduleTask(Task* task)
+{
+    // Outside the work queue threads, queue on the main thread deque
+    unsigned threadIndex = GetThreadIndex();
+    if (threadIndex == M_MAX_UNSIGNED)
+        threadIndex = 0;
+
+    task->AddRef();
+    numQueuedTasks_.fetch_add(1, std::memory_order_release);
+    taskDeques_[threadIndex]->PushBack(task);
+
+    // Paused worker threads are waiting for the queue mutex, which only the main thread can release
+    if (threadIndex == 0 && Thread::IsMainThread())
+        Resume();
+}
+
+bool WorkQueue::RunTask(unsigned threadIndex)
+{
+    Task* task = taskDeques_[threadIndex]->PopBack();
+    for (unsigned i = 1; !task && i < taskDeques_.Size(); ++i)
+        task = taskDeques_[(threadIndex + i) % taskDeques_.Size()]->PopFront();
+    if (!task)
+        return false;
+
+    if (task->function_)
+        task->function_(threadIndex);
+    FinishTask(task);
+    task->ReleaseRef();
+    numQueuedTasks_.fetch_sub(1, std::memory_order_release);
+    return true;
+}
+
+void WorkQueue::FinishTask(Task* task)
+{
+    if (task->pending_.fetch_sub(1, std::memory_order_acq_rel) != 1)
+        return;
+
+    // The continuations are not modified once the task is submitted
+    for (unsigned i = 0; i < task->continuations_.Size(); ++i)
+    {
+        Task* continuation = task->continuations_[i];
+        if (continuation->dependencies_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            ScheduleTask(continuation);
+        continuation->ReleaseRef();
+    }
+
+    Task* parent = task->parent_;
+    if (parent)
+    {
+        FinishTask(parent);
+        parent->ReleaseRef();
+    }
+}
+
 bool WorkQueue::IsCompleted(unsigned priority) const
 {
     for (List<SharedPtr<WorkItem> >::ConstIterator i = workItems_.Begin(); i != workItems_.End(); ++i)
@@ -313,6 +573,13 @@ void WorkQueue::ProcessItems(unsigned threadIndex)
         if (shutDown_)
             return;
 
+        // Tasks go first, they do not contend for the queue mutex
+        if (RunTask(threadIndex))
+        {
+            wasActive = true;
+            continue;
+        }
+
         if (pausing_ && !wasActive)
             Time::Sleep(0);
         else
@@ -416,6 +683,19 @@ void WorkQueue::HandleBeginFrame(StringHash eventType, VariantMap& eventData)
         }
     }
 
+    // Without worker threads, run the tasks nobody waited for. Else make sure the worker threads are running them
+    if (numQueuedTasks_.load(std::memory_order_acquire))
+    {
+        if (threads_.Empty())
+        {
+            while (RunTask(0))
+            {
+            }
+        }
+        else
+            Resume();
+    }
+
     // Complete and signal items down to the lowest priority
     PurgeCompleted(0);
     PurgePool();
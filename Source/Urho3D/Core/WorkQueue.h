@@ -26,6 +26,9 @@
 #include "../Core/Mutex.h"
 #include "../Core/Object.h"
 
+#include <atomic>
+#include <functional>
+
 namespace Urho3D
 {
 
@@ -35,6 +38,7 @@ URHO3D_EVENT(E_WORKITEMCOMPLETED, WorkItemCompleted)
     URHO3D_PARAM(P_ITEM, Item);                        // WorkItem ptr
 }
 
+class TaskDeque;
 class WorkerThread;
 
 /// Work queue item.
@@ -62,6 +66,91 @@ private:
     bool pooled_{};
 };
 
+/// Task function. Called with the thread index (0 = main thread) as parameter.
+using TaskFunction = std::function<void(unsigned)>;
+/// Parallel for function. Called with the begin and end of an index range and the thread index as parameters.
+using ParallelForFunction = std::function<void(unsigned, unsigned, unsigned)>;
+
+/// Work queue task. Finishes once its function and all its child tasks have run, then schedules its continuations.
+class URHO3D_API Task
+{
+    friend class TaskPtr;
+    friend class WorkQueue;
+
+public:
+    /// Return whether the task and its children have run.
+    bool IsFinished() const { return pending_.load(std::memory_order_acquire) == 0; }
+
+private:
+    /// Construct. Use WorkQueue::CreateTask.
+    Task(const TaskFunction& function, Task* parent);
+    /// Add a reference.
+    void AddRef() { refs_.fetch_add(1, std::memory_order_relaxed); }
+    /// Remove a reference and delete the task when none remain.
+    void ReleaseRef();
+
+    /// Task function, may be empty for a task only waiting for its children.
+    TaskFunction function_;
+    /// Parent task, which finishes after this one.
+    Task* parent_;
+    /// Tasks scheduled when this one finishes.
+    PODVector<Task*> continuations_;
+    /// Unfinished work: the task function until it has run, plus the unfinished child tasks.
+    std::atomic<int> pending_;
+    /// Holds before the task is scheduled: its submission, plus the unfinished tasks it continues.
+    std::atomic<int> dependencies_;
+    /// References from the task pointers and the work queue.
+    std::atomic<int> refs_;
+};
+
+/// Task pointer keeping a task alive. Unlike SharedPtr, the reference count is safe to share between threads.
+class URHO3D_API TaskPtr
+{
+public:
+    /// Construct a null pointer.
+    TaskPtr() = default;
+
+    /// Construct from a raw task.
+    explicit TaskPtr(Task* task) :
+        task_(task)
+    {
+        if (task_)
+            task_->AddRef();
+    }
+
+    /// Copy-construct.
+    TaskPtr(const TaskPtr& rhs) :
+        TaskPtr(rhs.task_)
+    {
+    }
+
+    /// Destruct. Release the task reference.
+    ~TaskPtr()
+    {
+        if (task_)
+            task_->ReleaseRef();
+    }
+
+    /// Assign from another task pointer.
+    TaskPtr& operator =(const TaskPtr& rhs)
+    {
+        TaskPtr copy(rhs);
+        Swap(task_, copy.task_);
+        return *this;
+    }
+
+    /// Point to the task.
+    Task* operator ->() const { return task_; }
+    /// Return the raw task.
+    Task* Get() const { return task_; }
+    /// Return whether the pointer is null.
+    bool Null() const { return task_ == nullptr; }
+
+private:
+    /// Task.
+    Task* task_{};
+};
+
 /// Work queue subsystem for multithreading.
 class URHO3D_API WorkQueue : public Object
 {
@@ -92,6 +181,19 @@ public:
     /// Finish all queued work which has at least the specified priority. Main thread will also execute priority work. Pause worker threads if no more work remains.
     void Complete(unsigned priority);
 
+    /// Create a task. A child task is waited for by its parent, create it from the parent function or before submitting the parent. Can be called from any thread.
+    TaskPtr CreateTask(const TaskFunction& function, Task* parent = nullptr);
+    /// Run a task after another one finishes. Add the continuations before submitting the task they continue.
+    void AddContinuation(Task* task, Task* continuation);
+    /// Submit a task. Once the tasks it continues have finished, it is queued on the calling thread, from which idle threads steal it. Can be called from any thread.
+    void SubmitTask(Task* task);
+    /// Wait for a task to finish, running queued tasks meanwhile.
+    void WaitTask(Task* task);
+    /// Call a function over an index range split in chunks of grainSize indices, run by the worker threads and the calling thread. Return when the whole range is done. Can be nested in tasks and work items.
+    void ParallelFor(unsigned begin, unsigned end, unsigned grainSize, const ParallelForFunction& function);
+    /// Return the thread index of the calling thread as passed to the work functions: 0 for the main thread, M_MAX_UNSIGNED for threads not managed by the work queue.
+    static unsigned GetCurrentThreadIndex();
+
     /// Set the pool telerance before it starts deleting pool items.
     void SetTolerance(int tolerance) { tolerance_ = tolerance; }
 
@@ -123,11 +225,21 @@ private:
     void ReturnToPool(SharedPtr<WorkItem>& item);
     /// Handle frame start event. Purge completed work from the main thread queue, and perform work if no threads at all.
     void HandleBeginFrame(StringHash eventType, VariantMap& eventData);
+    /// Queue a task on the deque of the calling thread.
+    void ScheduleTask(Task* task);
+    /// Run a queued task: from the deque of the thread, else stolen from another thread. Return false if none was found.
+    bool RunTask(unsigned threadIndex);
+    /// Complete one unit of pending work of a task. When none remains, schedule its continuations and finish its parent.
+    void FinishTask(Task* task);
 
     /// Worker threads.
     Vector<SharedPtr<WorkerThread> > threads_;
     /// Work item pool for reuse to cut down on allocation. The bool is a flag for item pooling and whether it is available or not.
     List<SharedPtr<WorkItem> > poolItems_;
+    /// Task deques, one per thread with the main thread first. Created with the threads.
+    Vector<UniquePtr<TaskDeque> > taskDeques_;
+    /// Number of queued and running tasks. The worker threads are not paused while there are any.
+    std::atomic<int> numQueuedTasks_;
     /// Work item collection. Accessed only by the main thread.
     List<SharedPtr<WorkItem> > workItems_;
     /// Work item prioritized queue for worker threads. Pointers are guaranteed to be valid (point to workItems.)
@@ -685,12 +685,14 @@ void Engine::Update()
 {
     URHO3D_PROFILE(Update);
 
-    // Logic update event
+    // Logic update event. Sent typed, the VariantMap is filled only for the VariantMap event receivers
+    UpdateEventData updateData{timeStep_};
+    SendTypedEvent(updateData);
+
     using namespace Update;
 
     VariantMap& eventData = GetEventDataMap();
     eventData[P_TIMESTEP] = timeStep_;
-    SendEvent(E_UPDATE, eventData);
 
     // Logic post-update event
     SendEvent(E_POSTUPDATE, eventData);
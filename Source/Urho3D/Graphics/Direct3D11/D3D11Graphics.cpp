@@ -1937,6 +1937,11 @@ unsigned Graphics::GetRGBA16Format()
     return DXGI_FORMAT_R16G16B16A16_UNORM;
 }
 
+unsigned Graphics::GetRGB565Format()
+{
+    return DXGI_FORMAT_B5G6R5_UNORM;
+}
+
 unsigned Graphics::GetRGBAFloat16Format()
 {
     return DXGI_FORMAT_R16G16B16A16_FLOAT;
@@ -92,6 +92,7 @@ unsigned Texture::GetRowDataSize(int width) const
 
     case DXGI_FORMAT_R8G8_UNORM:
     case DXGI_FORMAT_R16_UNORM:
+    case DXGI_FORMAT_B5G6R5_UNORM:
     case DXGI_FORMAT_R16_FLOAT:
     case DXGI_FORMAT_R16_TYPELESS:
         return (unsigned)(width * 2);
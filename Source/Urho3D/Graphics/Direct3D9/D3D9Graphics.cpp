@@ -2170,6 +2170,11 @@ unsigned Graphics::GetRGBA16Format()
     return D3DFMT_A16B16G16R16;
 }
 
+unsigned Graphics::GetRGB565Format()
+{
+    return D3DFMT_R5G6B5;
+}
+
 unsigned Graphics::GetRGBAFloat16Format()
 {
     return D3DFMT_A16B16G16R16F;
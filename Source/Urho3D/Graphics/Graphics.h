@@ -540,6 +540,8 @@ public:
     static unsigned GetRGBAFormat();
     /// Return the API-specific RGBA 16-bit texture format.
     static unsigned GetRGBA16Format();
+    /// Return the API-specific 16-bit RGB565 texture format, or 0 if not supported.
+    static unsigned GetRGB565Format();
     /// Return the API-specific RGBA 16-bit float texture format.
     static unsigned GetRGBAFloat16Format();
     /// Return the API-specific RGBA 32-bit float texture format.
@@ -45,24 +45,10 @@ namespace Urho3D
 
 static const float DEFAULT_OCTREE_SIZE = 1000.0f;
 static const int DEFAULT_OCTREE_LEVELS = 8;
+static const unsigned DRAWABLE_UPDATES_PER_CHUNK = 16;
 
 extern const char* SUBSYSTEM_CATEGORY;
 
-void UpdateDrawablesWork(const WorkItem* item, unsigned threadIndex)
-{
-    const FrameInfo& frame = *(reinterpret_cast<FrameInfo*>(item->aux_));
-    auto** start = reinterpret_cast<Drawable**>(item->start_);
-    auto** end = reinterpret_cast<Drawable**>(item->end_);
-
-    while (start != end)
-    {
-        Drawable* drawable = *start;
-        if (drawable)
-            drawable->Update(frame);
-        ++start;
-    }
-}
-
 inline bool CompareRayQueryResults(const RayQueryResult& lhs, const RayQueryResult& rhs)
 {
     return lhs.distance_ < rhs.distance_;
@@ -369,6 +355,11 @@ void Octree::Update(const FrameInfo& frame)
         return;
     }
 
+    // With batched transform updates, notify the moved drawables first so that they queue their updates
+    Scene* scene = GetScene();
+    if (scene)
+        scene->UpdateTransforms();
+
     // Let drawables update themselves before reinsertion. This can be used for animation
     if (!drawableUpdates_.Empty())
     {
@@ -376,35 +367,33 @@ void Octree::Update(const FrameInfo& frame)
 
         // Perform updates in worker threads. Notify the scene that a threaded update is going on and components
         // (for example physics objects) should not perform non-threadsafe work when marked dirty
-        Scene* scene = GetScene();
         auto* queue = GetSubsystem<WorkQueue>();
         scene->BeginThreadedUpdate();
 
-        int numWorkItems = queue->GetNumThreads() + 1; // Worker threads + main thread
-        int drawablesPerItem = Max((int)(drawableUpdates_.Size() / numWorkItems), 1);
-
-        PODVector<Drawable*>::Iterator start = drawableUpdates_.Begin();
-        // Create a work item for each thread
-        for (int i = 0; i < numWorkItems; ++i)
+        // The threads take small chunks in turn, so that expensive drawables such as animated models even out
+        queue->ParallelFor(0, drawableUpdates_.Size(), DRAWABLE_UPDATES_PER_CHUNK,
+            [this, &frame](unsigned begin, unsigned end, unsigned threadIndex)
         {
-            SharedPtr<WorkItem> item = queue->GetFreeItem();
-            item->priority_ = M_MAX_UNSIGNED;
-            item->workFunction_ = UpdateDrawablesWork;
-            item->aux_ = const_cast<FrameInfo*>(&frame);
-
-            PODVector<Drawable*>::Iterator end = drawableUpdates_.End();
-            if (i < numWorkItems - 1 && end - start > drawablesPerItem)
-                end = start + drawablesPerItem;
+            for (unsigned i = begin; i < end; ++i)
+            {
+                Drawable* drawable = drawableUpdates_[i];
+                if (drawable)
+                    drawable->Update(frame);
+            }
+        });
 
-            item->start_ = &(*start);
-            item->end_ = &(*end);
-            queue->AddWorkItem(item);
+        scene->EndThreadedUpdate();
 
-            start = end;
+        // With batched transform updates, notify the listeners of the nodes moved by the drawable updates, such as
+        // animated bones. The drawables they queue are updated below like the ones queued during the threaded update
+        if (scene->GetBatchedTransforms())
+        {
+            unsigned numUpdates = drawableUpdates_.Size();
+            scene->UpdateTransforms();
+            for (unsigned i = numUpdates; i < drawableUpdates_.Size(); ++i)
+                threadedDrawableUpdates_.Push(drawableUpdates_[i]);
+            drawableUpdates_.Resize(numUpdates);
         }
-
-        queue->Complete(M_MAX_UNSIGNED);
-        scene->EndThreadedUpdate();
     }
 
     // If any drawables were inserted during threaded update, update them now from the main thread
@@ -426,7 +415,6 @@ void Octree::Update(const FrameInfo& frame)
     }
 
     // Notify drawable update being finished. Custom animation (eg. IK) can be done at this point
-    Scene* scene = GetScene();
     if (scene)
     {
         using namespace SceneDrawableUpdateFinished;
@@ -435,6 +423,7 @@ void Octree::Update(const FrameInfo& frame)
         eventData[P_SCENE] = scene;
         eventData[P_TIMESTEP] = frame.timeStep_;
         scene->SendEvent(E_SCENEDRAWABLEUPDATEFINISHED, eventData);
+        scene->UpdateTransforms();
     }
 
     // Reinsert drawables that have been moved or resized, or that have been newly added to the octree and do not sit inside
@@ -2607,6 +2607,15 @@ unsigned Graphics::GetRGBA16Format()
 #endif
 }
 
+unsigned Graphics::GetRGB565Format()
+{
+#ifndef GL_ES_VERSION_2_0
+    return GL_RGB565;
+#else
+    return 0;
+#endif
+}
+
 unsigned Graphics::GetRGBAFloat16Format()
 {
 #ifndef GL_ES_VERSION_2_0
@@ -215,6 +215,7 @@ unsigned Texture::GetRowDataSize(int width) const
 
     case GL_RG8:
     case GL_R16F:
+    case GL_RGB565:
         return (unsigned)(width * 2);
 
     case GL_RGBA16:
@@ -265,7 +266,7 @@ unsigned Texture::GetExternalFormat(unsigned format)
         return GL_RG;
     else if (format == GL_RGBA16 || format == GL_RGBA16F_ARB || format == GL_RGBA32F_ARB || format == GL_SRGB_ALPHA_EXT)
         return GL_RGBA;
-    else if (format == GL_SRGB_EXT)
+    else if (format == GL_SRGB_EXT || format == GL_RGB565)
         return GL_RGB;
     else
         return format;
@@ -285,6 +286,8 @@ unsigned Texture::GetDataType(unsigned format)
         return GL_FLOAT;
     else if (format == GL_RGBA16F_ARB || format == GL_RG16F || format == GL_R16F)
         return GL_HALF_FLOAT_ARB;
+    else if (format == GL_RGB565)
+        return GL_UNSIGNED_SHORT_5_6_5;
     else
         return GL_UNSIGNED_BYTE;
 #else
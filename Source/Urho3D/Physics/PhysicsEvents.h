@@ -27,6 +27,10 @@
 namespace Urho3D
 {
 
+class Node;
+class PhysicsWorld;
+class RigidBody;
+
 /// Physics world is about to be stepped.
 URHO3D_EVENT(E_PHYSICSPRESTEP, PhysicsPreStep)
 {
@@ -65,6 +69,30 @@ URHO3D_EVENT(E_PHYSICSCOLLISION, PhysicsCollision)
     URHO3D_PARAM(P_CONTACTS, Contacts);            // Buffer containing position (Vector3), normal (Vector3), distance (float), impulse (float) for each contact
 }
 
+/// Typed payload of the ongoing physics collision event.
+struct URHO3D_API PhysicsCollisionEventData
+{
+    URHO3D_TYPED_EVENT(E_PHYSICSCOLLISION)
+
+    /// Fill the event parameters.
+    void ToVariantMap(VariantMap& eventData) const;
+
+    /// Physics world.
+    PhysicsWorld* world_;
+    /// First node.
+    Node* nodeA_;
+    /// Second node.
+    Node* nodeB_;
+    /// First rigid body.
+    RigidBody* bodyA_;
+    /// Second rigid body.
+    RigidBody* bodyB_;
+    /// Whether either body is a trigger.
+    bool trigger_;
+    /// Position (Vector3), normal (Vector3), distance (float), impulse (float) for each contact.
+    const PODVector<unsigned char>* contacts_;
+};
+
 /// Physics collision ended. Global event sent by the PhysicsWorld.
 URHO3D_EVENT(E_PHYSICSCOLLISIONEND, PhysicsCollisionEnd)
 {
@@ -96,6 +124,26 @@ URHO3D_EVENT(E_NODECOLLISION, NodeCollision)
     URHO3D_PARAM(P_CONTACTS, Contacts);            // Buffer containing position (Vector3), normal (Vector3), distance (float), impulse (float) for each contact
 }
 
+/// Typed payload of the node's ongoing physics collision event.
+struct URHO3D_API NodeCollisionEventData
+{
+    URHO3D_TYPED_EVENT(E_NODECOLLISION)
+
+    /// Fill the event parameters.
+    void ToVariantMap(VariantMap& eventData) const;
+
+    /// Rigid body of the node.
+    RigidBody* body_;
+    /// Other node.
+    Node* otherNode_;
+    /// Other rigid body.
+    RigidBody* otherBody_;
+    /// Whether either body is a trigger.
+    bool trigger_;
+    /// Position (Vector3), normal (Vector3), distance (float), impulse (float) for each contact, seen from the node.
+    const PODVector<unsigned char>* contacts_;
+};
+
 /// Node's physics collision ended. Sent by scene nodes participating in a collision.
 URHO3D_EVENT(E_NODECOLLISIONEND, NodeCollisionEnd)
 {
@@ -807,6 +807,15 @@ void PhysicsWorld::PreStep(float timeStep)
     eventData[P_TIMESTEP] = timeStep;
     SendEvent(E_PHYSICSPRESTEP, eventData);
 
+    // Fixed timestep logic components, when this world is their fixed update source
+    Scene* scene = GetScene();
+    if (scene && GetFixedUpdateSource() == this)
+        scene->UpdateLogicComponents(LUP_FIXEDUPDATE, timeStep);
+
+    // Apply the transform changes made before the step to the physics bodies
+    if (scene)
+        scene->UpdateTransforms();
+
     // Start profiling block for the actual simulation step
 #ifdef URHO3D_PROFILING
     auto* profiler = GetSubsystem<Profiler>();
@@ -832,6 +841,10 @@ void PhysicsWorld::PostStep(float timeStep)
     eventData[P_WORLD] = this;
     eventData[P_TIMESTEP] = timeStep;
     SendEvent(E_PHYSICSPOSTSTEP, eventData);
+
+    Scene* scene = GetScene();
+    if (scene && GetFixedUpdateSource() == this)
+        scene->UpdateLogicComponents(LUP_FIXEDPOSTUPDATE, timeStep);
 }
 
 void PhysicsWorld::SendCollisionEvents()
@@ -846,8 +859,6 @@ void PhysicsWorld::SendCollisionEvents()
 
     if (numManifolds)
     {
-        physicsCollisionData_[PhysicsCollision::P_WORLD] = this;
-
         for (int i = 0; i < numManifolds; ++i)
         {
             btPersistentManifold* contactManifold = collisionDispatcher_->getManifoldByIndexInternal(i);
@@ -907,12 +918,6 @@ void PhysicsWorld::SendCollisionEvents()
             bool trigger = bodyA->IsTrigger() || bodyB->IsTrigger();
             bool newCollision = !previousCollisions_.Contains(i->first_);
 
-            physicsCollisionData_[PhysicsCollision::P_NODEA] = nodeA;
-            physicsCollisionData_[PhysicsCollision::P_NODEB] = nodeB;
-            physicsCollisionData_[PhysicsCollision::P_BODYA] = bodyA;
-            physicsCollisionData_[PhysicsCollision::P_BODYB] = bodyB;
-            physicsCollisionData_[PhysicsCollision::P_TRIGGER] = trigger;
-
             contacts_.Clear();
 
             // "Pointers not flipped"-manifold, send unmodified normals
@@ -942,11 +947,14 @@ void PhysicsWorld::SendCollisionEvents()
                 }
             }
 
-            physicsCollisionData_[PhysicsCollision::P_CONTACTS] = contacts_.GetBuffer();
+            // The ongoing collision events are sent with typed payloads, which fill a VariantMap only for the VariantMap
+            // event receivers
+            PhysicsCollisionEventData collision{this, nodeA, nodeB, bodyA, bodyB, trigger, &contacts_.GetBuffer()};
 
             // Send separate collision start event if collision is new
             if (newCollision)
             {
+                collision.ToVariantMap(physicsCollisionData_);
                 SendEvent(E_PHYSICSCOLLISIONSTART, physicsCollisionData_);
                 // Skip rest of processing if either of the nodes or bodies is removed as a response to the event
                 if (!nodeWeakA || !nodeWeakB || !i->first_.first_ || !i->first_.second_)
@@ -954,24 +962,21 @@ void PhysicsWorld::SendCollisionEvents()
             }
 
             // Then send the ongoing collision event
-            SendEvent(E_PHYSICSCOLLISION, physicsCollisionData_);
+            SendTypedEvent(collision);
             if (!nodeWeakA || !nodeWeakB || !i->first_.first_ || !i->first_.second_)
                 continue;
 
-            nodeCollisionData_[NodeCollision::P_BODY] = bodyA;
-            nodeCollisionData_[NodeCollision::P_OTHERNODE] = nodeB;
-            nodeCollisionData_[NodeCollision::P_OTHERBODY] = bodyB;
-            nodeCollisionData_[NodeCollision::P_TRIGGER] = trigger;
-            nodeCollisionData_[NodeCollision::P_CONTACTS] = contacts_.GetBuffer();
+            NodeCollisionEventData nodeCollision{bodyA, nodeB, bodyB, trigger, &contacts_.GetBuffer()};
 
             if (newCollision)
             {
+                nodeCollision.ToVariantMap(nodeCollisionData_);
                 nodeA->SendEvent(E_NODECOLLISIONSTART, nodeCollisionData_);
                 if (!nodeWeakA || !nodeWeakB || !i->first_.first_ || !i->first_.second_)
                     continue;
             }
 
-            nodeA->SendEvent(E_NODECOLLISION, nodeCollisionData_);
+            nodeA->SendTypedEvent(nodeCollision);
             if (!nodeWeakA || !nodeWeakB || !i->first_.first_ || !i->first_.second_)
                 continue;
 
@@ -1002,19 +1007,19 @@ void PhysicsWorld::SendCollisionEvents()
                 }
             }
 
-            nodeCollisionData_[NodeCollision::P_BODY] = bodyB;
-            nodeCollisionData_[NodeCollision::P_OTHERNODE] = nodeA;
-            nodeCollisionData_[NodeCollision::P_OTHERBODY] = bodyA;
-            nodeCollisionData_[NodeCollision::P_CONTACTS] = contacts_.GetBuffer();
+            nodeCollision.body_ = bodyB;
+            nodeCollision.otherNode_ = nodeA;
+            nodeCollision.otherBody_ = bodyA;
 
             if (newCollision)
             {
+                nodeCollision.ToVariantMap(nodeCollisionData_);
                 nodeB->SendEvent(E_NODECOLLISIONSTART, nodeCollisionData_);
                 if (!nodeWeakA || !nodeWeakB || !i->first_.first_ || !i->first_.second_)
                     continue;
             }
 
-            nodeB->SendEvent(E_NODECOLLISION, nodeCollisionData_);
+            nodeB->SendTypedEvent(nodeCollision);
         }
     }
 
@@ -1080,6 +1085,30 @@ void PhysicsWorld::SendCollisionEvents()
     previousCollisions_ = currentCollisions_;
 }
 
+void PhysicsCollisionEventData::ToVariantMap(VariantMap& eventData) const
+{
+    using namespace PhysicsCollision;
+
+    eventData[P_WORLD] = world_;
+    eventData[P_NODEA] = nodeA_;
+    eventData[P_NODEB] = nodeB_;
+    eventData[P_BODYA] = bodyA_;
+    eventData[P_BODYB] = bodyB_;
+    eventData[P_TRIGGER] = trigger_;
+    eventData[P_CONTACTS] = *contacts_;
+}
+
+void NodeCollisionEventData::ToVariantMap(VariantMap& eventData) const
+{
+    using namespace NodeCollision;
+
+    eventData[P_BODY] = body_;
+    eventData[P_OTHERNODE] = otherNode_;
+    eventData[P_OTHERBODY] = otherBody_;
+    eventData[P_TRIGGER] = trigger_;
+    eventData[P_CONTACTS] = *contacts_;
+}
+
 void RegisterPhysicsLibrary(Context* context)
 {
     CollisionShape::RegisterObject(context);
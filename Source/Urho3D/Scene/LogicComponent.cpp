@@ -22,23 +22,32 @@
 
 #include "../Precompiled.h"
 
-#include "../IO/Log.h"
-#if defined(URHO3D_PHYSICS) || defined(URHO3D_URHO2D)
-#include "../Physics/PhysicsEvents.h"
-#endif
 #include "../Scene/LogicComponent.h"
 #include "../Scene/Scene.h"
-#include "../Scene/SceneEvents.h"
 
 namespace Urho3D
 {
 
+/// Update event flags by logic update phase.
+static const UpdateEvent phaseEvents[] =
+{
+    USE_UPDATE,
+    USE_PARALLELUPDATE,
+    USE_POSTUPDATE,
+    USE_FIXEDUPDATE,
+    USE_FIXEDPOSTUPDATE
+};
+
 LogicComponent::LogicComponent(Context* context) :
     Component(context),
     updateEventMask_(USE_UPDATE | USE_POSTUPDATE | USE_FIXEDUPDATE | USE_FIXEDPOSTUPDATE),
     currentEventMask_(0),
+    updateScene_(nullptr),
+    updateGroup_(M_MAX_UNSIGNED),
     delayedStartCalled_(false)
 {
+    for (unsigned i = 0; i < MAX_LOGIC_UPDATE_PHASES; ++i)
+        updateIndices_[i] = M_MAX_UNSIGNED;
 }
 
 LogicComponent::~LogicComponent() = default;
@@ -52,6 +61,10 @@ void LogicComponent::Update(float timeStep)
 {
 }
 
+void LogicComponent::ParallelUpdate(float timeStep)
+{
+}
+
 void LogicComponent::PostUpdate(float timeStep)
 {
 }
@@ -90,138 +103,104 @@ void LogicComponent::OnNodeSet(Node* node)
 void LogicComponent::OnSceneSet(Scene* scene)
 {
     if (scene)
+    {
+        updateScene_ = scene;
         UpdateEventSubscription();
-    else
+    }
+    else if (updateScene_)
     {
-        UnsubscribeFromEvent(E_SCENEUPDATE);
-        UnsubscribeFromEvent(E_SCENEPOSTUPDATE);
-#if defined(URHO3D_PHYSICS) || defined(URHO3D_URHO2D)
-        UnsubscribeFromEvent(E_PHYSICSPRESTEP);
-        UnsubscribeFromEvent(E_PHYSICSPOSTSTEP);
-#endif
+        for (unsigned i = 0; i < MAX_LOGIC_UPDATE_PHASES; ++i)
+        {
+            if (currentEventMask_ & phaseEvents[i])
+                updateScene_->RemoveLogicComponent(this, (LogicUpdatePhase)i);
+        }
         currentEventMask_ = USE_NO_EVENT;
+        updateScene_ = nullptr;
+        updateGroup_ = M_MAX_UNSIGNED;
     }
 }
 
 void LogicComponent::UpdateEventSubscription()
 {
-    Scene* scene = GetScene();
-    if (!scene)
+    if (!updateScene_)
         return;
 
     bool enabled = IsEnabledEffective();
 
-    bool needUpdate = enabled && ((updateEventMask_ & USE_UPDATE) || !delayedStartCalled_);
-    if (needUpdate && !(currentEventMask_ & USE_UPDATE))
-    {
-        SubscribeToEvent(scene, E_SCENEUPDATE, URHO3D_HANDLER(LogicComponent, HandleSceneUpdate));
-        currentEventMask_ |= USE_UPDATE;
-    }
-    else if (!needUpdate && (currentEventMask_ & USE_UPDATE))
-    {
-        UnsubscribeFromEvent(scene, E_SCENEUPDATE);
-        currentEventMask_ &= ~USE_UPDATE;
-    }
-
-    bool needPostUpdate = enabled && (updateEventMask_ & USE_POSTUPDATE);
-    if (needPostUpdate && !(currentEventMask_ & USE_POSTUPDATE))
-    {
-        SubscribeToEvent(scene, E_SCENEPOSTUPDATE, URHO3D_HANDLER(LogicComponent, HandleScenePostUpdate));
-        currentEventMask_ |= USE_POSTUPDATE;
-    }
-    else if (!needPostUpdate && (currentEventMask_ & USE_POSTUPDATE))
-    {
-        UnsubscribeFromEvent(scene, E_SCENEPOSTUPDATE);
-        currentEventMask_ &= ~USE_POSTUPDATE;
-    }
-
-#if defined(URHO3D_PHYSICS) || defined(URHO3D_URHO2D)
-    Component* world = GetFixedUpdateSource();
-    if (!world)
-        return;
-
-    bool needFixedUpdate = enabled && (updateEventMask_ & USE_FIXEDUPDATE);
-    if (needFixedUpdate && !(currentEventMask_ & USE_FIXEDUPDATE))
-    {
-        SubscribeToEvent(world, E_PHYSICSPRESTEP, URHO3D_HANDLER(LogicComponent, HandlePhysicsPreStep));
-        currentEventMask_ |= USE_FIXEDUPDATE;
-    }
-    else if (!needFixedUpdate && (currentEventMask_ & USE_FIXEDUPDATE))
-    {
-        UnsubscribeFromEvent(world, E_PHYSICSPRESTEP);
-        currentEventMask_ &= ~USE_FIXEDUPDATE;
-    }
-
-    bool needFixedPostUpdate = enabled && (updateEventMask_ & USE_FIXEDPOSTUPDATE);
-    if (needFixedPostUpdate && !(currentEventMask_ & USE_FIXEDPOSTUPDATE))
-    {
-        SubscribeToEvent(world, E_PHYSICSPOSTSTEP, URHO3D_HANDLER(LogicComponent, HandlePhysicsPostStep));
-        currentEventMask_ |= USE_FIXEDPOSTUPDATE;
-    }
-    else if (!needFixedPostUpdate && (currentEventMask_ & USE_FIXEDPOSTUPDATE))
+    for (unsigned i = 0; i < MAX_LOGIC_UPDATE_PHASES; ++i)
     {
-        UnsubscribeFromEvent(world, E_PHYSICSPOSTSTEP);
-        currentEventMask_ &= ~USE_FIXEDPOSTUPDATE;
-    }
+        UpdateEvent phaseEvent = phaseEvents[i];
+#if !defined(URHO3D_PHYSICS) && !defined(URHO3D_URHO2D)
+        // Without a physics world the fixed timestep phases are never updated
+        if (i >= LUP_FIXEDUPDATE)
+            break;
 #endif
-}
-
-void LogicComponent::HandleSceneUpdate(StringHash eventType, VariantMap& eventData)
-{
-    using namespace SceneUpdate;
-
-    // Execute user-defined delayed start function before first update
-    if (!delayedStartCalled_)
-    {
-        DelayedStart();
-        delayedStartCalled_ = true;
 
-        // If did not need actual update events, unsubscribe now
-        if (!(updateEventMask_ & USE_UPDATE))
+        // The update phase is also needed for the delayed start
+        bool needPhase = enabled && ((updateEventMask_ & phaseEvent) || (phaseEvent == USE_UPDATE && !delayedStartCalled_));
+        if (needPhase && !(currentEventMask_ & phaseEvent))
         {
-            UnsubscribeFromEvent(GetScene(), E_SCENEUPDATE);
-            currentEventMask_ &= ~USE_UPDATE;
-            return;
+            updateScene_->AddLogicComponent(this, (LogicUpdatePhase)i);
+            currentEventMask_ |= phaseEvent;
+        }
+        else if (!needPhase && (currentEventMask_ & phaseEvent))
+        {
+            updateScene_->RemoveLogicComponent(this, (LogicUpdatePhase)i);
+            currentEventMask_ &= ~phaseEvent;
         }
     }
-
-    // Then execute user-defined update function
-    Update(eventData[P_TIMESTEP].GetFloat());
 }
 
-void LogicComponent::HandleScenePostUpdate(StringHash eventType, VariantMap& eventData)
+void LogicComponent::CallUpdate(LogicUpdatePhase phase, float timeStep)
 {
-    using namespace ScenePostUpdate;
+    switch (phase)
+    {
+    case LUP_UPDATE:
+        // Execute user-defined delayed start function before first update
+        if (!delayedStartCalled_)
+        {
+            DelayedStart();
+            delayedStartCalled_ = true;
+
+            // If did not need actual updates, remove from the update list now
+            if (!(updateEventMask_ & USE_UPDATE))
+            {
+                UpdateEventSubscription();
+                return;
+            }
+        }
 
-    // Execute user-defined post-update function
-    PostUpdate(eventData[P_TIMESTEP].GetFloat());
-}
+        // Then execute user-defined update function
+        Update(timeStep);
+        break;
 
-#if defined(URHO3D_PHYSICS) || defined(URHO3D_URHO2D)
+    case LUP_PARALLELUPDATE:
+        ParallelUpdate(timeStep);
+        break;
 
-void LogicComponent::HandlePhysicsPreStep(StringHash eventType, VariantMap& eventData)
-{
-    using namespace PhysicsPreStep;
+    case LUP_POSTUPDATE:
+        PostUpdate(timeStep);
+        break;
 
-    // Execute user-defined delayed start function before first fixed update if not called yet
-    if (!delayedStartCalled_)
-    {
-        DelayedStart();
-        delayedStartCalled_ = true;
-    }
+    case LUP_FIXEDUPDATE:
+        // Execute user-defined delayed start function before first fixed update if not called yet
+        if (!delayedStartCalled_)
+        {
+            DelayedStart();
+            delayedStartCalled_ = true;
+            UpdateEventSubscription();
+        }
 
-    // Execute user-defined fixed update function
-    FixedUpdate(eventData[P_TIMESTEP].GetFloat());
-}
+        FixedUpdate(timeStep);
+        break;
 
-void LogicComponent::HandlePhysicsPostStep(StringHash eventType, VariantMap& eventData)
-{
-    using namespace PhysicsPostStep;
+    case LUP_FIXEDPOSTUPDATE:
+        FixedPostUpdate(timeStep);
+        break;
 
-    // Execute user-defined fixed post-update function
-    FixedPostUpdate(eventData[P_TIMESTEP].GetFloat());
+    default:
+        break;
+    }
 }
 
-#endif
-
 }
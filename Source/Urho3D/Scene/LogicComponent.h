@@ -42,26 +42,46 @@ enum UpdateEvent : unsigned
     USE_FIXEDUPDATE = 0x4,
     /// Bitmask for using the physics post-update event.
     USE_FIXEDPOSTUPDATE = 0x8,
+    /// Bitmask for using the parallel scene update.
+    USE_PARALLELUPDATE = 0x10,
 };
 URHO3D_FLAGSET(UpdateEvent, UpdateEventFlags);
 
-/// Helper base class for user-defined game logic components that hooks up to update events and forwards them to virtual functions similar to ScriptInstance class.
+/// Logic component update phase, called directly by the scene from its per-phase update lists.
+enum LogicUpdatePhase
+{
+    /// Scene update, variable timestep.
+    LUP_UPDATE = 0,
+    /// Scene update on the worker threads after the scene update, variable timestep.
+    LUP_PARALLELUPDATE,
+    /// Scene post-update, variable timestep.
+    LUP_POSTUPDATE,
+    /// Physics update, fixed timestep.
+    LUP_FIXEDUPDATE,
+    /// Physics post-update, fixed timestep.
+    LUP_FIXEDPOSTUPDATE,
+    MAX_LOGIC_UPDATE_PHASES
+};
+
+/// Helper base class for user-defined game logic components that forwards the scene and physics updates to virtual functions similar to ScriptInstance class. The scene keeps the components in packed per-phase update lists grouped by type and calls them directly instead of sending update events to each of them.
 class URHO3D_API LogicComponent : public Component
 {
     URHO3D_OBJECT(LogicComponent, Component);
 
+    friend class Scene;
+
     /// Construct.
     explicit LogicComponent(Context* context);
     /// Destruct.
     ~LogicComponent() override;
 
-    /// Handle enabled/disabled state change. Changes update event subscription.
+    /// Handle enabled/disabled state change. Changes the update list registration.
     void OnSetEnabled() override;
 
     /// Called when the component is added to a scene node. Other components may not yet exist.
     virtual void Start() { }
 
-    /// Called before the first update. At this point all other components of the node should exist. Will also be called if update events are not wanted; in that case the event is immediately unsubscribed afterward.
+    /// Called before the first update. At this point all other components of the node should exist. Will also be called if update events are not wanted; in that case the component is immediately removed from the update list afterward.
     virtual void DelayedStart() { }
 
     /// Called when the component is detached from a scene node, usually on destruction. Note that you will no longer have access to the node and scene at that point.
@@ -69,6 +89,8 @@ class URHO3D_API LogicComponent : public Component
 
     /// Called on scene update, variable timestep.
     virtual void Update(float timeStep);
+    /// Called on scene update from the worker threads after Update(), variable timestep. Only called after DelayedStart() and when the update event mask includes USE_PARALLELUPDATE. Runs within the scene threaded update, so it may only change the component's own state and its own node, and must not take new references to objects shared with other components. Node and component creation and removal, and event sends should be recorded in the calling thread's Scene::GetCommandBuffer(), which is applied on the main thread after all the parallel updates.
+    virtual void ParallelUpdate(float timeStep);
     /// Called on scene post-update, variable timestep.
     virtual void PostUpdate(float timeStep);
     /// Called on physics update, fixed timestep.
@@ -76,10 +98,10 @@ class URHO3D_API LogicComponent : public Component
     /// Called on physics post-update, fixed timestep.
     virtual void FixedPostUpdate(float timeStep);
 
-    /// Set what update events should be subscribed to. Use this for optimization: by default all are in use. Note that this is not an attribute and is not saved or network-serialized, therefore it should always be called eg. in the subclass constructor.
+    /// Set what update events should be received. Use this for optimization: by default all except the parallel update are in use. Note that this is not an attribute and is not saved or network-serialized, therefore it should always be called eg. in the subclass constructor.
     void SetUpdateEventMask(UpdateEventFlags mask);
 
-    /// Return what update events are subscribed to.
+    /// Return what update events are received.
     UpdateEventFlags GetUpdateEventMask() const { return updateEventMask_; }
 
     /// Return whether the DelayedStart() function has been called.
@@ -92,22 +114,21 @@ protected:
     void OnSceneSet(Scene* scene) override;
 
 private:
-    /// Subscribe/unsubscribe to update events based on current enabled state and update event mask.
+    /// Add to/remove from the scene update lists based on current enabled state and update event mask.
     void UpdateEventSubscription();
-    /// Handle scene update event.
-    void HandleSceneUpdate(StringHash eventType, VariantMap& eventData);
-    /// Handle scene post-update event.
-    void HandleScenePostUpdate(StringHash eventType, VariantMap& eventData);
-#if defined(URHO3D_PHYSICS) || defined(URHO3D_URHO2D)
-    /// Handle physics pre-step event.
-    void HandlePhysicsPreStep(StringHash eventType, VariantMap& eventData);
-    /// Handle physics post-step event.
-    void HandlePhysicsPostStep(StringHash eventType, VariantMap& eventData);
-#endif
+    /// Call the user-defined update function of a phase, with the delayed start before the first update. Called by Scene.
+    void CallUpdate(LogicUpdatePhase phase, float timeStep);
+
     /// Requested event subscription mask.
     UpdateEventFlags updateEventMask_;
-    /// Current event subscription mask.
+    /// Current update list registration mask.
     UpdateEventFlags currentEventMask_;
+    /// Scene whose update lists the component is registered to.
+    Scene* updateScene_;
+    /// Type group index in the scene update lists, assigned on first registration.
+    unsigned updateGroup_;
+    /// Indices in the scene update lists by phase, M_MAX_UNSIGNED when not registered.
+    unsigned updateIndices_[MAX_LOGIC_UPDATE_PHASES];
     /// Flag for delayed start.
     bool delayedStartCalled_;
 };
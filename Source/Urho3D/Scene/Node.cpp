@@ -54,6 +54,7 @@ Node::Node(Context* context) :
     networkUpdate_(false),
     parent_(nullptr),
     scene_(nullptr),
+    hierarchyIndex_(M_MAX_UNSIGNED),
     id_(0),
     position_(Vector3::ZERO),
     rotation_(Quaternion::IDENTITY),
@@ -735,6 +736,9 @@ void Node::SetOwner(Connection* owner)
 
 void Node::MarkDirty()
 {
+    // With batched transform updates the scene notifies the listeners of all the changed nodes in one pass
+    TransformHierarchy* hierarchy = scene_ ? scene_->GetTransformHierarchy() : nullptr;
+
     Node *cur = this;
     for (;;)
     {
@@ -750,21 +754,10 @@ void Node::MarkDirty()
         cur->dirty_ = true;
 
         // Notify listener components first, then mark child nodes
-        for (Vector<WeakPtr<Component> >::Iterator i = cur->listeners_.Begin(); i != cur->listeners_.End();)
-        {
-            Component *c = *i;
-            if (c)
-            {
-                c->OnMarkedDirty(cur);
-                ++i;
-            }
-            // If listener has expired, erase from list (swap with the last element to avoid O(n^2) behavior)
-            else
-            {
-                *i = cur->listeners_.Back();
-                cur->listeners_.Pop();
-            }
-        }
+        if (hierarchy && cur->hierarchyIndex_ != M_MAX_UNSIGNED)
+            hierarchy->MarkDirty(cur->hierarchyIndex_);
+        else
+            cur->NotifyListeners();
 
         // Tail call optimization: Don't recurse to mark the first child dirty, but
         // instead process it in the context of the current function. If there are more
@@ -837,6 +830,8 @@ void Node::AddChild(Node* node, unsigned index)
 
     node->parent_ = this;
     node->MarkDirty();
+    if (scene_ && scene_->GetTransformHierarchy())
+        scene_->GetTransformHierarchy()->MarkOrderDirty();
     node->MarkNetworkUpdate();
     // If the child node has components, also mark network update on them to ensure they have a valid NetworkState
     for (Vector<SharedPtr<Component> >::Iterator i = node->components_.Begin(); i != node->components_.End(); ++i)
@@ -2096,6 +2091,25 @@ void Node::UpdateWorldTransform() const
     dirty_ = false;
 }
 
+void Node::NotifyListeners()
+{
+    for (Vector<WeakPtr<Component> >::Iterator i = listeners_.Begin(); i != listeners_.End();)
+    {
+        Component *c = *i;
+        if (c)
+        {
+            c->OnMarkedDirty(this);
+            ++i;
+        }
+        // If listener has expired, erase from list (swap with the last element to avoid O(n^2) behavior)
+        else
+        {
+            *i = listeners_.Back();
+            listeners_.Pop();
+        }
+    }
+}
+
 void Node::RemoveChild(Vector<SharedPtr<Node> >::Iterator i)
 {
     // Keep a shared pointer to the child about to be removed, to make sure the erase from container completes first. Otherwise
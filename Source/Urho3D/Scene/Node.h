@@ -77,6 +77,7 @@ class URHO3D_API Node : public Animatable
     URHO3D_OBJECT(Node, Animatable);
 
     friend class Connection;
+    friend class TransformHierarchy;
 
 public:
     /// Construct.
@@ -281,7 +282,7 @@ public:
     void SetEnabledRecursive(bool enable);
     /// Set owner connection for networking.
     void SetOwner(Connection* owner);
-    /// Mark node and child nodes to need world transform recalculation. Notify listener components.
+    /// Mark node and child nodes to need world transform recalculation. Notify listener components, or with batched transform updates in the scene, leave them to the next transform update.
     void MarkDirty();
     /// Create a child scene node (with specified ID if provided).
     Node* CreateChild(const String& name = String::EMPTY, CreateMode mode = REPLICATED, unsigned id = 0, bool temporary = false);
@@ -646,6 +647,8 @@ private:
     Component* SafeCreateComponent(const String& typeName, StringHash type, CreateMode mode, unsigned id);
     /// Recalculate the world transform.
     void UpdateWorldTransform() const;
+    /// Notify the listener components of a transform change, erasing the expired ones.
+    void NotifyListeners();
     /// Remove child node by iterator.
     void RemoveChild(Vector<SharedPtr<Node> >::Iterator i);
     /// Return child nodes recursively.
@@ -681,6 +684,8 @@ private:
     Node* parent_;
     /// Scene (root node.)
     Scene* scene_;
+    /// Index in the scene transform hierarchy, M_MAX_UNSIGNED when the scene does not batch transform updates.
+    unsigned hierarchyIndex_;
     /// Unique ID within the scene.
     unsigned id_;
     /// Position.
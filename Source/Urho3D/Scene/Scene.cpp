@@ -55,6 +55,9 @@ const char* SUBSYSTEM_CATEGORY = "Subsystem";
 static const float DEFAULT_SMOOTHING_CONSTANT = 50.0f;
 static const float DEFAULT_SNAP_THRESHOLD = 5.0f;
 
+/// Number of logic components per parallel update chunk.
+static const unsigned PARALLEL_UPDATES_PER_CHUNK = 16;
+
 Scene::Scene(Context* context) :
     Node(context),
     replicatedNodeID_(FIRST_REPLICATED_ID),
@@ -69,8 +72,16 @@ Scene::Scene(Context* context) :
     snapThreshold_(DEFAULT_SNAP_THRESHOLD),
     updateEnabled_(true),
     asyncLoading_(false),
-    threadedUpdate_(false)
+    threadedUpdate_(false),
+    batchedTransforms_(false),
+    parallelUpdate_(false)
 {
+    for (unsigned i = 0; i < MAX_LOGIC_UPDATE_PHASES; ++i)
+    {
+        logicPhaseUpdating_[i] = false;
+        logicPhaseRemoved_[i] = false;
+    }
+
     // Assign an ID to self so that nodes can refer to this node as a parent
     SetID(GetFreeNodeID(REPLICATED));
     NodeAdded(this);
@@ -779,10 +790,17 @@ void Scene::Update(float timeStep)
 
     // Update variable timestep logic
     SendEvent(E_SCENEUPDATE, eventData);
+    UpdateLogicComponents(LUP_UPDATE, timeStep);
+
+    // Update thread-safe logic on the worker threads
+    UpdateLogicComponents(LUP_PARALLELUPDATE, timeStep);
 
     // Update scene attribute animation.
     SendEvent(E_ATTRIBUTEANIMATIONUPDATE, eventData);
 
+    // Let the scene subsystems see the transform changes of the logic update
+    UpdateTransforms();
+
     // Update scene subsystems. If a physics world is present, it will be updated, triggering fixed timestep logic updates
     SendEvent(E_SCENESUBSYSTEMUPDATE, eventData);
 
@@ -802,6 +820,8 @@ void Scene::Update(float timeStep)
 
     // Post-update variable timestep logic
     SendEvent(E_SCENEPOSTUPDATE, eventData);
+    UpdateLogicComponents(LUP_POSTUPDATE, timeStep);
+    UpdateTransforms();
 
     // Note: using a float for elapsed time accumulation is inherently inaccurate. The purpose of this value is
     // primarily to update material animation effects, as it is available to shaders. It can be reset by calling
@@ -839,6 +859,191 @@ void Scene::DelayedMarkedDirty(Component* component)
     delayedDirtyComponents_.Push(component);
 }
 
+void Scene::UpdateLogicComponents(LogicUpdatePhase phase, float timeStep)
+{
+    if (logicComponentGroups_.Empty())
+        return;
+
+    if (phase == LUP_PARALLELUPDATE)
+    {
+        UpdateParallelLogicComponents(timeStep);
+        return;
+    }
+
+    // Components added during the update are appended and called in the same pass, removed ones leave null entries.
+    // The lists are indexed anew on each call, as the calls may add component groups
+    bool wasUpdating = logicPhaseUpdating_[phase];
+    logicPhaseUpdating_[phase] = true;
+
+    for (unsigned i = 0; i < logicComponentGroups_.Size(); ++i)
+    {
+        for (unsigned j = 0; j < logicComponentGroups_[i].components_[phase].Size(); ++j)
+        {
+            LogicComponent* component = logicComponentGroups_[i].components_[phase][j];
+            if (component)
+                component->CallUpdate(phase, timeStep);
+        }
+    }
+
+    logicPhaseUpdating_[phase] = wasUpdating;
+    if (!wasUpdating && logicPhaseRemoved_[phase])
+        CompactLogicComponents(phase);
+}
+
+void Scene::AddLogicComponent(LogicComponent* component, LogicUpdatePhase phase)
+{
+    if (!component || component->updateIndices_[phase] != M_MAX_UNSIGNED)
+        return;
+
+    if (component->updateGroup_ == M_MAX_UNSIGNED)
+    {
+        StringHash type = component->GetType();
+        HashMap<StringHash, unsigned>::ConstIterator i = logicComponentGroupIndices_.Find(type);
+        if (i != logicComponentGroupIndices_.End())
+            component->updateGroup_ = i->second_;
+        else
+        {
+            component->updateGroup_ = logicComponentGroups_.Size();
+            logicComponentGroupIndices_[type] = component->updateGroup_;
+            logicComponentGroups_.Resize(logicComponentGroups_.Size() + 1);
+            logicComponentGroups_.Back().type_ = type;
+        }
+    }
+
+    PODVector<LogicComponent*>& components = logicComponentGroups_[component->updateGroup_].components_[phase];
+    component->updateIndices_[phase] = components.Size();
+    components.Push(component);
+}
+
+void Scene::RemoveLogicComponent(LogicComponent* component, LogicUpdatePhase phase)
+{
+    if (!component || component->updateIndices_[phase] == M_MAX_UNSIGNED)
+        return;
+
+    PODVector<LogicComponent*>& components = logicComponentGroups_[component->updateGroup_].components_[phase];
+    unsigned index = component->updateIndices_[phase];
+    component->updateIndices_[phase] = M_MAX_UNSIGNED;
+
+    if (logicPhaseUpdating_[phase])
+    {
+        // Keep the order while iterating, compact when the phase ends
+        components[index] = nullptr;
+        logicPhaseRemoved_[phase] = true;
+    }
+    else
+    {
+        LogicComponent* last = components.Back();
+        components.Pop();
+        if (last != component)
+        {
+            components[index] = last;
+            last->updateIndices_[phase] = index;
+        }
+    }
+}
+
+void Scene::SetBatchedTransforms(bool enable)
+{
+    if (enable == batchedTransforms_)
+        return;
+
+    // Nodes marked dirty from the listeners notified on clear are no longer batched
+    batchedTransforms_ = enable;
+    if (enable)
+        transformHierarchy_.Initialize(this);
+    else
+        transformHierarchy_.Clear();
+}
+
+void Scene::UpdateTransforms()
+{
+    if (batchedTransforms_)
+    {
+        URHO3D_PROFILE(UpdateTransforms);
+        transformHierarchy_.Update(GetSubsystem<WorkQueue>());
+    }
+}
+
+SceneCommandBuffer* Scene::GetCommandBuffer() const
+{
+    if (!parallelUpdate_)
+        return nullptr;
+
+    unsigned threadIndex = WorkQueue::GetCurrentThreadIndex();
+    return threadIndex < commandBuffers_.Size() ? const_cast<SceneCommandBuffer*>(&commandBuffers_[threadIndex]) : nullptr;
+}
+
+void Scene::CompactLogicComponents(LogicUpdatePhase phase)
+{
+    for (unsigned i = 0; i < logicComponentGroups_.Size(); ++i)
+    {
+        PODVector<LogicComponent*>& components = logicComponentGroups_[i].components_[phase];
+        unsigned count = 0;
+        for (unsigned j = 0; j < components.Size(); ++j)
+        {
+            LogicComponent* component = components[j];
+            if (component)
+            {
+                components[count] = component;
+                component->updateIndices_[phase] = count;
+                ++count;
+            }
+        }
+        components.Resize(count);
+    }
+
+    logicPhaseRemoved_[phase] = false;
+}
+
+void Scene::UpdateParallelLogicComponents(float timeStep)
+{
+    // Take the components first: the lists only change on the main thread, when the command buffers are applied.
+    // Components which have not had their delayed start yet wait for the next update
+    parallelLogicComponents_.Clear();
+    for (unsigned i = 0; i < logicComponentGroups_.Size(); ++i)
+    {
+        const PODVector<LogicComponent*>& components = logicComponentGroups_[i].components_[LUP_PARALLELUPDATE];
+        for (unsigned j = 0; j < components.Size(); ++j)
+        {
+            if (components[j]->IsDelayedStartCalled())
+                parallelLogicComponents_.Push(components[j]);
+        }
+    }
+    if (parallelLogicComponents_.Empty())
+        return;
+
+    URHO3D_PROFILE(ParallelUpdateLogic);
+
+    auto* queue = GetSubsystem<WorkQueue>();
+    commandBuffers_.Resize(queue->GetNumThreads() + 1);
+
+    BeginThreadedUpdate();
+    parallelUpdate_ = true;
+
+    LogicComponent** components = parallelLogicComponents_.Buffer();
+    queue->ParallelFor(0, parallelLogicComponents_.Size(), PARALLEL_UPDATES_PER_CHUNK,
+        [this, components, timeStep](unsigned start, unsigned end, unsigned threadIndex)
+    {
+        // A nested parallel loop may run another chunk on this thread meanwhile, so restore the previous order after
+        SceneCommandBuffer* buffer = &commandBuffers_[threadIndex];
+        unsigned previousOrder = buffer->GetOrder();
+
+        for (unsigned i = start; i < end; ++i)
+        {
+            // Order the recorded changes as a serial update would
+            buffer->SetOrder(i);
+            components[i]->CallUpdate(LUP_PARALLELUPDATE, timeStep);
+        }
+
+        buffer->SetOrder(previousOrder);
+    });
+
+    parallelUpdate_ = false;
+    EndThreadedUpdate();
+
+    SceneCommandBuffer::Execute(commandBuffers_.Buffer(), commandBuffers_.Size());
+}
+
 unsigned Scene::GetFreeNodeID(CreateMode mode)
 {
     if (mode == REPLICATED)
@@ -914,6 +1119,8 @@ void Scene::NodeAdded(Node* node)
         oldScene->NodeRemoved(node);
 
     node->SetScene(this);
+    if (batchedTransforms_)
+        transformHierarchy_.AddNode(node);
 
     // If the new node has an ID of zero (default), assign a replicated ID now
     unsigned id = node->GetID();
@@ -981,6 +1188,9 @@ void Scene::NodeRemoved(Node* node)
     if (!node || node->GetScene() != this)
         return;
 
+    if (batchedTransforms_)
+        transformHierarchy_.RemoveNode(node);
+
     unsigned id = node->GetID();
     if (Scene::IsReplicatedID(id))
     {
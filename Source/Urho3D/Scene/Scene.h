@@ -28,8 +28,11 @@
 #include "../Core/Mutex.h"
 #include "../Resource/XMLElement.h"
 #include "../Resource/JSONFile.h"
+#include "../Scene/LogicComponent.h"
 #include "../Scene/Node.h"
+#include "../Scene/SceneCommandBuffer.h"
 #include "../Scene/SceneResolver.h"
+#include "../Scene/TransformHierarchy.h"
 
 namespace Urho3D
 {
@@ -83,6 +86,15 @@ struct AsyncProgress
     unsigned totalNodes_;
 };
 
+/// Logic components of one type registered for direct update calls.
+struct LogicComponentGroup
+{
+    /// Component type.
+    StringHash type_;
+    /// Packed components by update phase. Components removed while their phase is updating leave null entries until it ends.
+    PODVector<LogicComponent*> components_[MAX_LOGIC_UPDATE_PHASES];
+};
+
 /// Root scene node, represents the whole scene.
 class URHO3D_API Scene : public Node
 {
@@ -221,9 +233,25 @@ public:
     void EndThreadedUpdate();
     /// Add a component to the delayed dirty notify queue. Is thread-safe.
     void DelayedMarkedDirty(Component* component);
+    /// Call the logic components registered for an update phase. Called by Update() for the variable timestep phases and by the physics world for the fixed timestep phases.
+    void UpdateLogicComponents(LogicUpdatePhase phase, float timeStep);
+    /// Register a logic component for an update phase. Called by LogicComponent.
+    void AddLogicComponent(LogicComponent* component, LogicUpdatePhase phase);
+    /// Unregister a logic component from an update phase. Called by LogicComponent.
+    void RemoveLogicComponent(LogicComponent* component, LogicUpdatePhase phase);
+    /// Return the command buffer of the calling thread during the parallel logic update of this scene, or null outside it. Each scene has its own buffers, indexed by work queue thread index. The recorded scene changes are applied on the main thread after the parallel update.
+    SceneCommandBuffer* GetCommandBuffer() const;
 
     /// Return threaded update flag.
     bool IsThreadedUpdate() const { return threadedUpdate_; }
+    /// Enable or disable batched transform updates. When enabled, the scene keeps its nodes sorted by hierarchy depth, recomputes the changed world transforms in one pass and notifies the transform listeners, such as drawables and physics bodies, once per pass instead of on each transform change.
+    void SetBatchedTransforms(bool enable);
+    /// Recompute the changed world transforms and notify their listeners when transform updates are batched. Called during the scene update, before the physics steps and before the octree update. Call manually when a component caching transform-derived data, such as the camera view, has to see a change before that.
+    void UpdateTransforms();
+    /// Return whether transform updates are batched.
+    bool GetBatchedTransforms() const { return batchedTransforms_; }
+    /// Return the transform hierarchy when transform updates are batched, otherwise null.
+    TransformHierarchy* GetTransformHierarchy() { return batchedTransforms_ ? &transformHierarchy_ : nullptr; }
 
     /// Get free node ID, either non-local or local.
     unsigned GetFreeNodeID(CreateMode mode);
@@ -279,6 +307,10 @@ private:
     void PreloadResourcesXML(const XMLElement& element);
     /// Preload resources from a JSON scene or object prefab file.
     void PreloadResourcesJSON(const JSONValue& value);
+    /// Remove the null entries left by logic components removed during an update phase.
+    void CompactLogicComponents(LogicUpdatePhase phase);
+    /// Call the parallel updates of the logic components over the worker threads within a threaded update, then apply their command buffers.
+    void UpdateParallelLogicComponents(float timeStep);
 
     /// Replicated scene nodes by ID.
     HashMap<unsigned, Node*> replicatedNodes_;
@@ -308,6 +340,16 @@ private:
     PODVector<Component*> delayedDirtyComponents_;
     /// Mutex for the delayed dirty notification queue.
     Mutex sceneMutex_;
+    /// Logic components registered for direct update calls, grouped by type.
+    Vector<LogicComponentGroup> logicComponentGroups_;
+    /// Logic component group indices by type.
+    HashMap<StringHash, unsigned> logicComponentGroupIndices_;
+    /// Logic components of the current parallel update.
+    PODVector<LogicComponent*> parallelLogicComponents_;
+    /// Command buffers of the parallel update by work queue thread index.
+    Vector<SceneCommandBuffer> commandBuffers_;
+    /// Node hierarchy for batched transform updates.
+    TransformHierarchy transformHierarchy_;
     /// Preallocated event data map for smoothing update events.
     VariantMap smoothingData_;
     /// Next free non-local node ID.
@@ -336,6 +378,14 @@ private:
     bool asyncLoading_;
     /// Threaded update flag.
     bool threadedUpdate_;
+    /// Batched transform updates flag.
+    bool batchedTransforms_;
+    /// Parallel logic update in progress flag.
+    bool parallelUpdate_;
+    /// Logic update phases being iterated.
+    bool logicPhaseUpdating_[MAX_LOGIC_UPDATE_PHASES];
+    /// Logic update phases with null entries to compact.
+    bool logicPhaseRemoved_[MAX_LOGIC_UPDATE_PHASES];
 };
 
 /// Register Scene library objects.
@@ -0,0 +1,185 @@
+//
+// Copyright (c) 2008-2019 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "../Precompiled.h"
+
+#include "../Container/Sort.h"
+#include "../Scene/Component.h"
+#include "../Scene/SceneCommandBuffer.h"
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+/// Return whether a recorded change applies before another. The changes of one update are recorded consecutively in the same buffer.
+static bool CompareSceneCommands(const SceneCommand* lhs, const SceneCommand* rhs)
+{
+    return lhs->order_ != rhs->order_ ? lhs->order_ < rhs->order_ : lhs < rhs;
+}
+
+SceneCommandBuffer::SceneCommandBuffer() :
+    order_(0)
+{
+}
+
+SceneCommandBuffer::~SceneCommandBuffer() = default;
+
+void SceneCommandBuffer::CreateChild(Node* parent, const String& name, CreateMode mode, unsigned id,
+    const std::function<void(Node*)>& function)
+{
+    if (!parent)
+        return;
+
+    SceneCommand& command = AddCommand(SCT_CREATECHILD, parent);
+    command.name_ = name;
+    command.mode_ = mode;
+    command.id_ = id;
+    if (function)
+        command.function_ = [function](Object* object) { function(static_cast<Node*>(object)); };
+}
+
+void SceneCommandBuffer::CreateComponent(Node* node, StringHash type, CreateMode mode, unsigned id,
+    const std::function<void(Component*)>& function)
+{
+    if (!node)
+        return;
+
+    SceneCommand& command = AddCommand(SCT_CREATECOMPONENT, node);
+    command.typeHash_ = type;
+    command.mode_ = mode;
+    command.id_ = id;
+    if (function)
+        command.function_ = [function](Object* object) { function(static_cast<Component*>(object)); };
+}
+
+void SceneCommandBuffer::RemoveNode(Node* node)
+{
+    if (node)
+        AddCommand(SCT_REMOVENODE, node);
+}
+
+void SceneCommandBuffer::RemoveComponent(Component* component)
+{
+    if (component)
+        AddCommand(SCT_REMOVECOMPONENT, component);
+}
+
+void SceneCommandBuffer::SendEvent(Object* sender, StringHash eventType, const VariantMap& eventData)
+{
+    if (!sender)
+        return;
+
+    SceneCommand& command = AddCommand(SCT_SENDEVENT, sender);
+    command.typeHash_ = eventType;
+    command.eventData_ = eventData;
+}
+
+void SceneCommandBuffer::Call(const std::function<void()>& function)
+{
+    if (!function)
+        return;
+
+    SceneCommand& command = AddCommand(SCT_CALL, nullptr);
+    command.function_ = [function](Object*) { function(); };
+}
+
+void SceneCommandBuffer::Execute(SceneCommandBuffer* buffers, unsigned numBuffers)
+{
+    // Take the weak references first, as a change may destroy the target of a later one
+    PODVector<SceneCommand*> commands;
+    for (unsigned i = 0; i < numBuffers; ++i)
+    {
+        for (Vector<SceneCommand>::Iterator j = buffers[i].commands_.Begin(); j != buffers[i].commands_.End(); ++j)
+        {
+            j->weakTarget_ = j->target_;
+            commands.Push(&(*j));
+        }
+    }
+    if (commands.Empty())
+        return;
+
+    // Apply in the update order, whichever thread ran the updates
+    Sort(commands.Begin(), commands.End(), CompareSceneCommands);
+
+    for (PODVector<SceneCommand*>::ConstIterator i = commands.Begin(); i != commands.End(); ++i)
+    {
+        SceneCommand& command = **i;
+        Object* target = command.weakTarget_.Get();
+        if (!target && command.type_ != SCT_CALL)
+            continue;
+
+        switch (command.type_)
+        {
+        case SCT_CREATECHILD:
+            {
+                Node* child = static_cast<Node*>(target)->CreateChild(command.name_, command.mode_, command.id_);
+                if (child && command.function_)
+                    command.function_(child);
+            }
+            break;
+
+        case SCT_CREATECOMPONENT:
+            {
+                Component* component = static_cast<Node*>(target)->CreateComponent(command.typeHash_, command.mode_,
+                    command.id_);
+                if (component && command.function_)
+                    command.function_(component);
+            }
+            break;
+
+        case SCT_REMOVENODE:
+            static_cast<Node*>(target)->Remove();
+            break;
+
+        case SCT_REMOVECOMPONENT:
+            static_cast<Component*>(target)->Remove();
+            break;
+
+        case SCT_SENDEVENT:
+            target->SendEvent(command.typeHash_, command.eventData_);
+            break;
+
+        case SCT_CALL:
+            command.function_(nullptr);
+            break;
+        }
+    }
+
+    for (unsigned i = 0; i < numBuffers; ++i)
+        buffers[i].commands_.Clear();
+}
+
+SceneCommand& SceneCommandBuffer::AddCommand(SceneCommandType type, Object* target)
+{
+    commands_.Resize(commands_.Size() + 1);
+    SceneCommand& command = commands_.Back();
+    command.type_ = type;
+    command.order_ = order_;
+    command.target_ = target;
+    command.mode_ = REPLICATED;
+    command.id_ = 0;
+    return command;
+}
+
+}
@@ -0,0 +1,114 @@
+//
+// Copyright (c) 2008-2019 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#pragma once
+
+#include "../Container/Ptr.h"
+#include "../Scene/Node.h"
+
+#include <functional>
+
+namespace Urho3D
+{
+
+/// Deferred scene change type.
+enum SceneCommandType
+{
+    SCT_CREATECHILD = 0,
+    SCT_CREATECOMPONENT,
+    SCT_REMOVENODE,
+    SCT_REMOVECOMPONENT,
+    SCT_SENDEVENT,
+    SCT_CALL
+};
+
+/// Deferred scene change.
+struct SceneCommand
+{
+    /// Change type.
+    SceneCommandType type_;
+    /// Order of the recording update, the changes of all the buffers are applied in this order.
+    unsigned order_;
+    /// Target node, component or event sender. Recorded as a raw pointer, as reference counts may only change on the main thread.
+    Object* target_;
+    /// Weak reference to the target taken on the main thread before applying, in case an earlier change destroys it.
+    WeakPtr<Object> weakTarget_;
+    /// Component or event type.
+    StringHash typeHash_;
+    /// Node name.
+    String name_;
+    /// Create mode.
+    CreateMode mode_;
+    /// Node or component ID.
+    unsigned id_;
+    /// Event data.
+    VariantMap eventData_;
+    /// Function called with the created node or component, or called alone.
+    std::function<void(Object*)> function_;
+};
+
+/// Buffer of scene changes recorded by a thread during the parallel logic update, applied on the main thread after it. Node and component creation, removal and event sends are not thread-safe, so parallel updates record them here instead.
+class URHO3D_API SceneCommandBuffer
+{
+public:
+    /// Construct.
+    SceneCommandBuffer();
+    /// Destruct.
+    ~SceneCommandBuffer();
+
+    /// Defer creating a child node. The function, if any, is called with the new node.
+    void CreateChild(Node* parent, const String& name = String::EMPTY, CreateMode mode = REPLICATED, unsigned id = 0, const std::function<void(Node*)>& function = std::function<void(Node*)>());
+    /// Defer creating a component. The function, if any, is called with the new component.
+    void CreateComponent(Node* node, StringHash type, CreateMode mode = REPLICATED, unsigned id = 0, const std::function<void(Component*)>& function = std::function<void(Component*)>());
+    /// Defer removing a node from its parent.
+    void RemoveNode(Node* node);
+    /// Defer removing a component from its node.
+    void RemoveComponent(Component* component);
+    /// Defer sending an event. The event data is copied now: pointers in it are weakly referenced on the calling thread, so they should only point to objects that no other thread references meanwhile. The copy allocates the map and its Variants on the worker thread, so for events recorded by many components each update prefer Call() with a function capturing the plain parameter values, which sends the event or its typed payload on the main thread.
+    void SendEvent(Object* sender, StringHash eventType, const VariantMap& eventData = Variant::emptyVariantMap);
+    /// Defer calling a function on the main thread.
+    void Call(const std::function<void()>& function);
+
+    /// Set the order of the following changes. Called by Scene before each parallel update.
+    void SetOrder(unsigned order) { order_ = order; }
+    /// Return the order of the following changes.
+    unsigned GetOrder() const { return order_; }
+    /// Return whether no changes are recorded.
+    bool IsEmpty() const { return commands_.Empty(); }
+    /// Return the number of recorded changes.
+    unsigned GetNumCommands() const { return commands_.Size(); }
+
+    /// Apply the changes of several buffers in their recording order and clear them. Call only on the main thread.
+    static void Execute(SceneCommandBuffer* buffers, unsigned numBuffers);
+
+private:
+    /// Add a change and return it.
+    SceneCommand& AddCommand(SceneCommandType type, Object* target);
+
+    /// Recorded changes.
+    Vector<SceneCommand> commands_;
+    /// Order of the following changes.
+    unsigned order_;
+};
+
+}
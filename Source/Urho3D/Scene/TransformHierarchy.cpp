@@ -0,0 +1,247 @@
+//
+// Copyright (c) 2008-2019 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "../Precompiled.h"
+
+#include "../Core/WorkQueue.h"
+#include "../Scene/Node.h"
+#include "../Scene/Scene.h"
+#include "../Scene/TransformHierarchy.h"
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+/// Number of nodes per world transform update chunk.
+static const unsigned TRANSFORM_UPDATES_PER_CHUNK = 256;
+
+TransformHierarchy::TransformHierarchy() :
+    scene_(nullptr),
+    changed_(false),
+    orderDirty_(false)
+{
+}
+
+TransformHierarchy::~TransformHierarchy() = default;
+
+void TransformHierarchy::Initialize(Scene* scene)
+{
+    Clear();
+
+    scene_ = scene;
+    RebuildOrder();
+}
+
+void TransformHierarchy::Clear()
+{
+    // Unregister all the nodes before notifying, as the listeners may change the hierarchy
+    Vector<WeakPtr<Node> > changedNodes;
+    for (unsigned i = 0; i < nodes_.Size(); ++i)
+    {
+        Node* node = nodes_[i];
+        if (!node)
+            continue;
+
+        node->hierarchyIndex_ = M_MAX_UNSIGNED;
+        if (dirty_[i])
+            changedNodes.Push(WeakPtr<Node>(node));
+    }
+
+    scene_ = nullptr;
+    nodes_.Clear();
+    parents_.Clear();
+    worldTransforms_.Clear();
+    worldRotations_.Clear();
+    dirty_.Clear();
+    levelStarts_.Clear();
+    changed_ = false;
+    orderDirty_ = false;
+
+    for (Vector<WeakPtr<Node> >::ConstIterator i = changedNodes.Begin(); i != changedNodes.End(); ++i)
+    {
+        if (*i)
+            (*i)->NotifyListeners();
+    }
+}
+
+void TransformHierarchy::AddNode(Node* node)
+{
+    if (!node || node == scene_ || node->hierarchyIndex_ != M_MAX_UNSIGNED)
+        return;
+
+    // Append for now so that changes can be marked, the rebuild sorts it by depth
+    node->hierarchyIndex_ = nodes_.Size();
+    nodes_.Push(node);
+    parents_.Push(M_MAX_UNSIGNED);
+    worldTransforms_.Push(Matrix3x4::IDENTITY);
+    worldRotations_.Push(Quaternion::IDENTITY);
+    dirty_.Push((unsigned char)node->dirty_);
+    if (node->dirty_)
+        changed_ = true;
+    orderDirty_ = true;
+}
+
+void TransformHierarchy::RemoveNode(Node* node)
+{
+    if (!node || node->hierarchyIndex_ == M_MAX_UNSIGNED)
+        return;
+
+    unsigned index = node->hierarchyIndex_;
+    node->hierarchyIndex_ = M_MAX_UNSIGNED;
+    nodes_[index] = nullptr;
+    orderDirty_ = true;
+
+    // The listeners would not hear of the change otherwise
+    if (dirty_[index])
+    {
+        dirty_[index] = 0;
+        node->NotifyListeners();
+    }
+}
+
+void TransformHierarchy::Update(WorkQueue* queue)
+{
+    if (!scene_ || (!changed_ && !orderDirty_))
+        return;
+
+    // Changes marked from now on, including by the listeners, are left to the next update
+    changed_ = false;
+    if (orderDirty_)
+        RebuildOrder();
+
+    // Parents come before their children, so each depth level only reads the world transforms of the previous ones
+    for (unsigned level = 0; level + 1 < levelStarts_.Size(); ++level)
+    {
+        unsigned start = levelStarts_[level];
+        unsigned end = levelStarts_[level + 1];
+        if (queue && end - start > TRANSFORM_UPDATES_PER_CHUNK)
+        {
+            queue->ParallelFor(start, end, TRANSFORM_UPDATES_PER_CHUNK, [this](unsigned chunkStart, unsigned chunkEnd,
+                unsigned threadIndex)
+            {
+                UpdateWorldTransforms(chunkStart, chunkEnd);
+            });
+        }
+        else
+            UpdateWorldTransforms(start, end);
+    }
+
+    // Notify the listeners in depth order. They may change transforms or the hierarchy: nodes marked again after their
+    // turn wait for the next update, and the world transforms are read back in case they were changed before their turn
+    unsigned numNodes = nodes_.Size();
+    for (unsigned i = 0; i < numNodes; ++i)
+    {
+        if (!dirty_[i])
+            continue;
+
+        dirty_[i] = 0;
+        Node* node = nodes_[i];
+        if (!node)
+            continue;
+
+        if (node->dirty_)
+        {
+            worldTransforms_[i] = node->GetWorldTransform();
+            worldRotations_[i] = node->GetWorldRotation();
+        }
+        if (!node->listeners_.Empty())
+            node->NotifyListeners();
+    }
+}
+
+void TransformHierarchy::RebuildOrder()
+{
+    PODVector<unsigned char> oldDirty;
+    oldDirty.Swap(dirty_);
+
+    nodes_.Clear();
+    parents_.Clear();
+    worldTransforms_.Clear();
+    worldRotations_.Clear();
+    levelStarts_.Clear();
+    orderDirty_ = false;
+
+    // Breadth first from the scene, which sorts the nodes by depth
+    const Vector<SharedPtr<Node> >& rootChildren = scene_->GetChildren();
+    for (Vector<SharedPtr<Node> >::ConstIterator i = rootChildren.Begin(); i != rootChildren.End(); ++i)
+        AppendNode(*i, M_MAX_UNSIGNED, oldDirty);
+
+    levelStarts_.Push(0);
+    unsigned levelEnd = nodes_.Size();
+    for (unsigned i = 0; i < nodes_.Size(); ++i)
+    {
+        if (i == levelEnd)
+        {
+            levelStarts_.Push(i);
+            levelEnd = nodes_.Size();
+        }
+
+        const Vector<SharedPtr<Node> >& children = nodes_[i]->children_;
+        for (Vector<SharedPtr<Node> >::ConstIterator j = children.Begin(); j != children.End(); ++j)
+            AppendNode(*j, i, oldDirty);
+    }
+    levelStarts_.Push(nodes_.Size());
+}
+
+void TransformHierarchy::AppendNode(Node* node, unsigned parent, const PODVector<unsigned char>& oldDirty)
+{
+    unsigned oldIndex = node->hierarchyIndex_;
+    bool dirty = node->dirty_ || (oldIndex < oldDirty.Size() && oldDirty[oldIndex]);
+
+    node->hierarchyIndex_ = nodes_.Size();
+    nodes_.Push(node);
+    parents_.Push(parent);
+    // The world transforms of the unchanged nodes are up to date, the changed ones are computed on update
+    worldTransforms_.Push(dirty ? Matrix3x4::IDENTITY : node->worldTransform_);
+    worldRotations_.Push(dirty ? Quaternion::IDENTITY : node->worldRotation_);
+    dirty_.Push((unsigned char)dirty);
+}
+
+void TransformHierarchy::UpdateWorldTransforms(unsigned start, unsigned end)
+{
+    for (unsigned i = start; i < end; ++i)
+    {
+        if (!dirty_[i])
+            continue;
+
+        Node* node = nodes_[i];
+        unsigned parent = parents_[i];
+        if (parent == M_MAX_UNSIGNED)
+        {
+            worldTransforms_[i] = node->GetTransform();
+            worldRotations_[i] = node->rotation_;
+        }
+        else
+        {
+            worldTransforms_[i] = worldTransforms_[parent] * node->GetTransform();
+            worldRotations_[i] = worldRotations_[parent] * node->rotation_;
+        }
+
+        node->worldTransform_ = worldTransforms_[i];
+        node->worldRotation_ = worldRotations_[i];
+        node->dirty_ = false;
+    }
+}
+
+}
@@ -0,0 +1,101 @@
+//
+// Copyright (c) 2008-2019 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#pragma once
+
+#include "../Container/Vector.h"
+#include "../Math/Matrix3x4.h"
+
+#include <atomic>
+
+namespace Urho3D
+{
+
+class Node;
+class Scene;
+class WorkQueue;
+
+/// Scene node hierarchy for batched world transform updates. Keeps the scene nodes in contiguous arrays sorted by hierarchy depth, so that the world transforms of the dirty nodes are recomputed in one linear pass, split over the worker threads by depth level, and the transform listeners of the changed nodes are notified once per pass instead of on each transform change. Node::MarkDirty still marks the child nodes dirty, so that world transforms read between the passes stay correct.
+class URHO3D_API TransformHierarchy
+{
+public:
+    /// Construct.
+    TransformHierarchy();
+    /// Destruct.
+    ~TransformHierarchy();
+
+    /// Register all the nodes of a scene.
+    void Initialize(Scene* scene);
+    /// Unregister all the nodes, notifying the listeners of the changed ones.
+    void Clear();
+    /// Register a node added to the scene. Its depth order is resolved on the next update.
+    void AddNode(Node* node);
+    /// Unregister a node removed from the scene, notifying its listeners if it has changed since the last update.
+    void RemoveNode(Node* node);
+    /// Mark the depth order dirty after a node has been reparented within the scene.
+    void MarkOrderDirty() { orderDirty_ = true; }
+    /// Mark a node changed. Called by Node::MarkDirty, also from worker threads during a threaded update.
+    void MarkDirty(unsigned index)
+    {
+        dirty_[index] = 1;
+        // Check first to keep the flag's cache line shared between the threads
+        if (!changed_.load(std::memory_order_relaxed))
+            changed_.store(true, std::memory_order_relaxed);
+    }
+    /// Recompute the world transforms of the changed nodes and notify their listeners. Call only on the main thread.
+    void Update(WorkQueue* queue);
+
+    /// Return number of registered nodes, including the ones removed since the last update.
+    unsigned GetNumNodes() const { return nodes_.Size(); }
+    /// Return number of depth levels as of the last update.
+    unsigned GetNumLevels() const { return levelStarts_.Empty() ? 0 : levelStarts_.Size() - 1; }
+
+private:
+    /// Rebuild the depth order from the scene hierarchy, keeping the changed flags.
+    void RebuildOrder();
+    /// Append a node to the depth order.
+    void AppendNode(Node* node, unsigned parent, const PODVector<unsigned char>& oldDirty);
+    /// Recompute the world transforms of the changed nodes in a range of one depth level.
+    void UpdateWorldTransforms(unsigned start, unsigned end);
+
+    /// Scene.
+    Scene* scene_;
+    /// Nodes by depth order. Removed nodes leave null entries until the next update.
+    PODVector<Node*> nodes_;
+    /// Parent node indices, M_MAX_UNSIGNED for the scene's child nodes.
+    PODVector<unsigned> parents_;
+    /// World transforms.
+    PODVector<Matrix3x4> worldTransforms_;
+    /// World rotations.
+    PODVector<Quaternion> worldRotations_;
+    /// Changed flags.
+    PODVector<unsigned char> dirty_;
+    /// Start index of each depth level, and the end of the last.
+    PODVector<unsigned> levelStarts_;
+    /// Any node changed since the last update flag.
+    std::atomic<bool> changed_;
+    /// Depth order needs rebuild flag.
+    bool orderDirty_;
+};
+
+}
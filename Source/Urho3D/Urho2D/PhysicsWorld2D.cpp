@@ -287,6 +287,16 @@ void PhysicsWorld2D::Update(float timeStep)
     eventData[P_TIMESTEP] = timeStep;
     SendEvent(E_PHYSICSPRESTEP, eventData);
 
+    // Fixed timestep logic components, when no 3D physics world takes precedence
+    Scene* scene = GetScene();
+    bool updateLogic = scene && GetFixedUpdateSource() == this;
+    if (updateLogic)
+        scene->UpdateLogicComponents(LUP_FIXEDUPDATE, timeStep);
+
+    // Apply the transform changes made before the step to the physics bodies
+    if (scene)
+        scene->UpdateTransforms();
+
     physicsStepping_ = true;
     world_->Step(timeStep, velocityIterations_, positionIterations_);
     physicsStepping_ = false;
@@ -330,6 +340,8 @@ void PhysicsWorld2D::Update(float timeStep)
 
     using namespace PhysicsPostStep;
     SendEvent(E_PHYSICSPOSTSTEP, eventData);
+    if (updateLogic)
+        scene->UpdateLogicComponents(LUP_FIXEDPOSTUPDATE, timeStep);
 }
 
 void PhysicsWorld2D::DrawDebugGeometry()
@@ -75,6 +75,35 @@ function HandleCircuitFileSelected(event_type, event_data)
 end
 
 
+-----------------
+-- Circuit loading
+-----------------
+
+function CreateLoadingText()
+    loading_text = ui.root:CreateChild("Text")
+    loading_text:SetFont(cache:GetResource("Font", "Fonts/Anonymous Pro.ttf"), 15)
+    loading_text:SetAlignment(HA_CENTER, VA_CENTER)
+    loading_text.visible = false
+
+    SubscribeToEvent("CircuitLoadProgress", "HandleCircuitLoadProgress")
+    SubscribeToEvent("CircuitLoaded", "HandleCircuitLoaded")
+end
+
+function HandleCircuitLoadProgress(event_type, event_data)
+    local progress = math.floor(event_data["progress"]:GetFloat() * 100)
+    loading_text.text = "Loading " .. event_data["circuit_file"]:GetString() .. ": " ..
+        event_data["stage"]:GetString() .. " " .. progress .. "%"
+    loading_text.visible = true
+end
+
+function HandleCircuitLoaded(event_type, event_data)
+    loading_text.visible = false
+    if not event_data["success"]:GetBool() then
+        log:Write(LOG_ERROR, "Could not load circuit " .. event_data["circuit_file"]:GetString())
+    end
+end
+
+
 -----------------
 -- Application
 -----------------
@@ -83,6 +112,7 @@ function Start()
     -- Load default style
     def_style = cache:GetResource("XMLFile", "UI/DefaultStyle.xml")
 
+    CreateLoadingText()
     SubscribeToEvent("Update", "HandleUpdate")
 
     local data = VariantMap()